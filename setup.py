@@ -0,0 +1,18 @@
+# Builds the `karma` extension (source/projects/karma_py) over karma_core.
+# Metadata lives in pyproject.toml; `pip install .` compiles it.
+
+from setuptools import Extension, setup
+
+setup(
+    ext_modules=[
+        Extension(
+            "karma",
+            sources=[
+                "source/projects/karma_py/karma_py.c",
+                "source/projects/karma_core/karma_core.c",
+            ],
+            include_dirs=["source/projects/karma_core"],
+            extra_compile_args=["-O2"],
+        )
+    ],
+)
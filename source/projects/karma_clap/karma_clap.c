@@ -0,0 +1,473 @@
+// karma_clap : a CLAP plugin shell over the host-agnostic karma_core DSP.
+//
+// The same engine as karma_re~ (../karma_re_tilde), hosted as a stereo CLAP
+// audio effect so DAW rigs can run the looper without Max. Like the Max shell
+// this file owns only the host plumbing; everything else is karma_core.
+//
+//   - The plugin owns its loop buffer: KARMA_CLAP_SECONDS of stereo float at the
+//     activation sample rate (so srscale is 1), allocated in activate and kept
+//     across deactivate / activate at the same rate.
+//   - Audio is CLAP's native float32, handed to the core's float32 entry point
+//     (karma_perform32) as is: no conversion passes. The core reads each
+//     sample's inputs before it writes that sample's outputs, so in-place host
+//     buffers are fine.
+//   - Control is sample-accurate: the block is split at every CLAP event's time
+//     and the event is applied between the two halves, instead of once per
+//     block. The pieces run through the core in sub-blocks of at most
+//     KARMA_CLAP_VS frames (the core's nominal vector size).
+//   - Speed and overdub are smoothed over KARMA_CLAP_SMOOTH_MS: speed per sample
+//     through the core's speed signal input, overdub as the core's own per-call
+//     linear ramp toward the value at the end of each sub-block.
+//
+// Parameters: State (0 stop / 1 play / 2 record / 3 append -- applied on change),
+// Speed (-4 .. 4), Overdub (0 .. 1), Position and Window (the selection, as
+// phase 0 .. 1).
+//
+// Build with the header-only CLAP SDK on the include path (tests/Makefile:
+// `make clap`, checked offline by `make claptest`).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <clap/clap.h>
+
+#include "karma_core.h"       // the Max-free core (standalone build config)
+
+#define KARMA_CLAP_ID        "org.karma.karma_re"
+#define KARMA_CLAP_SECONDS   60                  // loop buffer length
+#define KARMA_CLAP_VS        64                  // frames per core call (at most)
+#define KARMA_CLAP_SMOOTH_MS 20.0                // speed / overdub ramp time
+
+enum {
+    KCLAP_P_STATE,
+    KCLAP_P_SPEED,
+    KCLAP_P_OVERDUB,
+    KCLAP_P_POSITION,
+    KCLAP_P_WINDOW,
+    KCLAP_NPARAMS
+};
+
+enum { KCLAP_STOP, KCLAP_PLAY, KCLAP_RECORD, KCLAP_APPEND };
+
+// linear ramp toward a target over a fixed number of samples
+typedef struct {
+    double  cur, target, step;
+    int64_t left;
+} kclap_smooth;
+
+typedef struct {
+    clap_plugin_t       plugin;
+    const clap_host_t  *host;
+    t_karma             core;
+
+    float   *buf;                 // frames * 2, interleaved
+    long     frames;
+    double   sr;
+
+    double   param[KCLAP_NPARAMS];
+    kclap_smooth speed, overdub;
+    int64_t  smoothlen;
+
+    float    in_s[KARMA_CLAP_VS];             // the smoothed speed, per sample
+    float    in_0[KARMA_CLAP_VS];             // (silence, with no input)
+    float    out_x[KARMA_CLAP_VS];            // (the right output, on a mono output)
+} t_karma_clap;
+
+static const double kclap_range[KCLAP_NPARAMS][3] = {     // min, max, default
+    { 0.0,  3.0, 0.0 },
+    { -4.0, 4.0, 1.0 },
+    { 0.0,  1.0, 1.0 },
+    { 0.0,  1.0, 0.0 },
+    { 0.0,  1.0, 1.0 },
+};
+static const char *const kclap_names[KCLAP_NPARAMS] = { "State", "Speed", "Overdub", "Position", "Window" };
+static const char *const kclap_states[4] = { "Stop", "Play", "Record", "Append" };
+
+// ---------------------------------------------------------------------------
+// owned buffer exposed to the core through the host interface
+// ---------------------------------------------------------------------------
+static void *kclap_buf_lock(void *ctx)     { return ((t_karma_clap *)ctx)->buf; }
+static void  kclap_buf_unlock(void *ctx)   { (void)ctx; }
+static void  kclap_buf_setdirty(void *ctx) { (void)ctx; }
+
+// ---------------------------------------------------------------------------
+// parameters
+// ---------------------------------------------------------------------------
+static void kclap_smooth_set(kclap_smooth *s, double target, int64_t len)
+{
+    s->target = target;
+    s->left = (len > 0) ? len : 0;
+    if (s->left) {
+        s->step = (target - s->cur) / (double)s->left;
+    } else {
+        s->cur = target;
+    }
+}
+
+static inline double kclap_smooth_next(kclap_smooth *s)
+{
+    if (s->left) {
+        s->cur += s->step;
+        if (--s->left == 0)
+            s->cur = s->target;
+    }
+    return s->cur;
+}
+
+static void kclap_smooth_skip(kclap_smooth *s, int64_t n)
+{
+    if (n >= s->left) {
+        s->cur = s->target;
+        s->left = 0;
+    } else {
+        s->cur += s->step * (double)n;
+        s->left -= n;
+    }
+}
+
+static void kclap_state(t_karma_clap *x, long state)
+{
+    switch (state) {
+        case KCLAP_STOP:   karma_stop(&x->core);   break;
+        case KCLAP_PLAY:   karma_play(&x->core);   break;
+        case KCLAP_RECORD: karma_record(&x->core); break;
+        case KCLAP_APPEND: karma_append(&x->core); break;
+    }
+}
+
+// one parameter change; len: smoothing length in samples (0 = jump)
+static void kclap_param_set(t_karma_clap *x, clap_id id, double value, int64_t len)
+{
+    if (id >= KCLAP_NPARAMS)
+        return;
+    value = CLAMP(value, kclap_range[id][0], kclap_range[id][1]);
+    switch (id) {
+        case KCLAP_P_STATE:
+            value = floor(value + 0.5);
+            if (value != x->param[id])
+                kclap_state(x, (long)value);
+            break;
+        case KCLAP_P_SPEED:    kclap_smooth_set(&x->speed, value, len);        break;
+        case KCLAP_P_OVERDUB:  kclap_smooth_set(&x->overdub, value, len);      break;
+        case KCLAP_P_POSITION: karma_select_start(&x->core, value);            break;
+        case KCLAP_P_WINDOW:   karma_select_size(&x->core, value);             break;
+    }
+    x->param[id] = value;
+}
+
+static void kclap_event(t_karma_clap *x, const clap_event_header_t *ev, int64_t len)
+{
+    if ((ev->space_id == CLAP_CORE_EVENT_SPACE_ID) && (ev->type == CLAP_EVENT_PARAM_VALUE)) {
+        const clap_event_param_value_t *pv = (const clap_event_param_value_t *)ev;
+        kclap_param_set(x, pv->param_id, pv->value, len);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// audio
+// ---------------------------------------------------------------------------
+// frames [start, end) of the block through the core, KARMA_CLAP_VS at a time
+static void kclap_run(t_karma_clap *x, const clap_process_t *p, uint32_t start, uint32_t end)
+{
+    const clap_audio_buffer_t *ai = p->audio_inputs_count ? &p->audio_inputs[0] : NULL;
+    const clap_audio_buffer_t *ao = &p->audio_outputs[0];
+    float *ins[3], *outs[2];
+    uint32_t n, i, c;
+
+    ins[2] = x->in_s;
+    while (start < end) {
+        n = end - start;
+        if (n > KARMA_CLAP_VS)
+            n = KARMA_CLAP_VS;
+        for (c = 0; c < 2; c++) {
+            ins[c] = (ai && ai->channel_count) ? ai->data32[(c < ai->channel_count) ? c : 0] + start : x->in_0;
+            outs[c] = (c < ao->channel_count) ? ao->data32[c] + start : x->out_x;
+        }
+        for (i = 0; i < n; i++)
+            x->in_s[i] = (float)kclap_smooth_next(&x->speed);
+        if (x->overdub.left) {
+            kclap_smooth_skip(&x->overdub, n);
+            karma_overdub(&x->core, x->overdub.cur);
+        } else if (x->core.overdubamp != x->overdub.cur) {
+            karma_overdub(&x->core, x->overdub.cur);
+        }
+
+        karma_perform32(&x->core, ins, outs, (long)n);
+
+        for (c = 2; c < ao->channel_count; c++)    // any further outputs repeat the right one
+            memcpy(ao->data32[c] + start, outs[1], n * sizeof(float));
+        start += n;
+    }
+}
+
+static clap_process_status kclap_process(const clap_plugin_t *plugin, const clap_process_t *p)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+    uint32_t nev = p->in_events->size(p->in_events), e, pos = 0, t;
+    const clap_event_header_t *ev;
+
+    if (!p->audio_outputs_count || !x->buf)
+        return CLAP_PROCESS_ERROR;
+    for (e = 0; e < nev; e++) {
+        ev = p->in_events->get(p->in_events, e);
+        t = (ev->time < p->frames_count) ? ev->time : p->frames_count;
+        if (t > pos) {
+            kclap_run(x, p, pos, t);
+            pos = t;
+        }
+        kclap_event(x, ev, x->smoothlen);
+    }
+    kclap_run(x, p, pos, p->frames_count);
+    return CLAP_PROCESS_CONTINUE;
+}
+
+// ---------------------------------------------------------------------------
+// lifecycle
+// ---------------------------------------------------------------------------
+static bool kclap_init(const clap_plugin_t *plugin)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+    clap_id i;
+
+    for (i = 0; i < KCLAP_NPARAMS; i++)
+        x->param[i] = kclap_range[i][2];
+    x->speed.cur = x->speed.target = x->param[KCLAP_P_SPEED];
+    x->overdub.cur = x->overdub.target = x->param[KCLAP_P_OVERDUB];
+    return true;
+}
+
+static void kclap_destroy(const clap_plugin_t *plugin)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+
+    free(x->buf);
+    free(x);
+}
+
+static bool kclap_activate(const clap_plugin_t *plugin, double sr, uint32_t minframes, uint32_t maxframes)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+    long frames = (long)(sr * KARMA_CLAP_SECONDS);
+    (void)minframes; (void)maxframes;
+
+    x->smoothlen = (int64_t)(sr * KARMA_CLAP_SMOOTH_MS * 0.001);
+    if (x->buf && (sr == x->sr))
+        return true;                                // same rate: keep the loop
+    free(x->buf);
+    x->buf = (float *)calloc((size_t)frames * 2, sizeof(float));
+    if (!x->buf)
+        return false;
+    x->frames = frames;
+    x->sr = sr;
+
+    karma_core_init(&x->core, 2, sr, KARMA_CLAP_VS);
+    x->core.bufio.lock      = kclap_buf_lock;
+    x->core.bufio.unlock    = kclap_buf_unlock;
+    x->core.bufio.set_dirty = kclap_buf_setdirty;
+    x->core.bufio.ctx       = x;
+    x->core.bufio.frames    = frames;
+    x->core.bufio.chans     = 2;
+    x->core.bufio.sr        = sr;
+    karma_core_set_dims(&x->core);
+    x->core.speedconnect = 1;                       // speed arrives as a signal (smoothed)
+    x->core.initinit     = 1;                       // DSP on: enables jump / stop
+    karma_overdub(&x->core, x->overdub.cur);
+    x->core.overdubprev = x->core.overdubamp;
+    karma_select_start(&x->core, x->param[KCLAP_P_POSITION]);
+    karma_select_size(&x->core, x->param[KCLAP_P_WINDOW]);
+    return true;
+}
+
+static void kclap_deactivate(const clap_plugin_t *plugin)       { (void)plugin; }
+static bool kclap_start_processing(const clap_plugin_t *plugin) { (void)plugin; return true; }
+static void kclap_stop_processing(const clap_plugin_t *plugin)  { (void)plugin; }
+static void kclap_on_main_thread(const clap_plugin_t *plugin)   { (void)plugin; }
+
+// reset: finish any ramp (the loop itself is kept)
+static void kclap_reset(const clap_plugin_t *plugin)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+
+    kclap_smooth_set(&x->speed, x->speed.target, 0);
+    kclap_smooth_set(&x->overdub, x->overdub.target, 0);
+}
+
+// ---------------------------------------------------------------------------
+// extensions: audio ports, params
+// ---------------------------------------------------------------------------
+static uint32_t kclap_ports_count(const clap_plugin_t *plugin, bool is_input)
+{
+    (void)plugin; (void)is_input;
+    return 1;
+}
+
+static bool kclap_ports_get(const clap_plugin_t *plugin, uint32_t index, bool is_input, clap_audio_port_info_t *info)
+{
+    (void)plugin;
+    if (index != 0)
+        return false;
+    info->id = 0;
+    snprintf(info->name, sizeof(info->name), "%s", is_input ? "Input" : "Output");
+    info->flags = CLAP_AUDIO_PORT_IS_MAIN;
+    info->channel_count = 2;
+    info->port_type = CLAP_PORT_STEREO;
+    info->in_place_pair = 0;
+    return true;
+}
+
+static const clap_plugin_audio_ports_t kclap_ports = { kclap_ports_count, kclap_ports_get };
+
+static uint32_t kclap_params_count(const clap_plugin_t *plugin)
+{
+    (void)plugin;
+    return KCLAP_NPARAMS;
+}
+
+static bool kclap_params_info(const clap_plugin_t *plugin, uint32_t index, clap_param_info_t *info)
+{
+    (void)plugin;
+    if (index >= KCLAP_NPARAMS)
+        return false;
+    memset(info, 0, sizeof(*info));
+    info->id = index;
+    info->flags = CLAP_PARAM_IS_AUTOMATABLE;
+    if (index == KCLAP_P_STATE)
+        info->flags |= CLAP_PARAM_IS_STEPPED | CLAP_PARAM_IS_ENUM;
+    snprintf(info->name, sizeof(info->name), "%s", kclap_names[index]);
+    info->min_value = kclap_range[index][0];
+    info->max_value = kclap_range[index][1];
+    info->default_value = kclap_range[index][2];
+    return true;
+}
+
+static bool kclap_params_value(const clap_plugin_t *plugin, clap_id id, double *value)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+
+    if (id >= KCLAP_NPARAMS)
+        return false;
+    *value = x->param[id];
+    return true;
+}
+
+static bool kclap_params_to_text(const clap_plugin_t *plugin, clap_id id, double value, char *s, uint32_t size)
+{
+    (void)plugin;
+    if (id >= KCLAP_NPARAMS)
+        return false;
+    if (id == KCLAP_P_STATE)
+        snprintf(s, size, "%s", kclap_states[(long)CLAMP(floor(value + 0.5), 0.0, 3.0)]);
+    else if (id == KCLAP_P_SPEED)
+        snprintf(s, size, "%.3fx", value);
+    else
+        snprintf(s, size, "%.3f", value);
+    return true;
+}
+
+static bool kclap_params_from_text(const clap_plugin_t *plugin, clap_id id, const char *s, double *value)
+{
+    long i;
+    (void)plugin;
+
+    if (id >= KCLAP_NPARAMS)
+        return false;
+    if (id == KCLAP_P_STATE) {
+        for (i = 0; i < 4; i++) {
+            if (!strcmp(s, kclap_states[i])) {
+                *value = (double)i;
+                return true;
+            }
+        }
+    }
+    *value = atof(s);
+    return true;
+}
+
+// events outside process (no audio running): applied at once, without ramps
+static void kclap_params_flush(const clap_plugin_t *plugin, const clap_input_events_t *in, const clap_output_events_t *out)
+{
+    t_karma_clap *x = (t_karma_clap *)plugin->plugin_data;
+    uint32_t n = in->size(in), e;
+    (void)out;
+
+    for (e = 0; e < n; e++)
+        kclap_event(x, in->get(in, e), 0);
+}
+
+static const clap_plugin_params_t kclap_params = {
+    kclap_params_count, kclap_params_info, kclap_params_value,
+    kclap_params_to_text, kclap_params_from_text, kclap_params_flush
+};
+
+static const void *kclap_get_extension(const clap_plugin_t *plugin, const char *id)
+{
+    (void)plugin;
+    if (!strcmp(id, CLAP_EXT_AUDIO_PORTS))
+        return &kclap_ports;
+    if (!strcmp(id, CLAP_EXT_PARAMS))
+        return &kclap_params;
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// factory / entry
+// ---------------------------------------------------------------------------
+static const char *const kclap_features[] = { CLAP_PLUGIN_FEATURE_AUDIO_EFFECT, CLAP_PLUGIN_FEATURE_SAMPLER, CLAP_PLUGIN_FEATURE_STEREO, NULL };
+
+static const clap_plugin_descriptor_t kclap_desc = {
+    CLAP_VERSION_INIT, KARMA_CLAP_ID, "karma_re", "karma", "", "", "", "1.0.0",
+    "Varispeed looper (karma_core)", kclap_features
+};
+
+static uint32_t kclap_factory_count(const clap_plugin_factory_t *f)
+{
+    (void)f;
+    return 1;
+}
+
+static const clap_plugin_descriptor_t *kclap_factory_desc(const clap_plugin_factory_t *f, uint32_t index)
+{
+    (void)f;
+    return (index == 0) ? &kclap_desc : NULL;
+}
+
+static const clap_plugin_t *kclap_factory_create(const clap_plugin_factory_t *f, const clap_host_t *host, const char *id)
+{
+    t_karma_clap *x;
+    (void)f;
+
+    if (!clap_version_is_compatible(host->clap_version) || strcmp(id, KARMA_CLAP_ID))
+        return NULL;
+    x = (t_karma_clap *)calloc(1, sizeof(t_karma_clap));
+    if (!x)
+        return NULL;
+    x->host = host;
+    x->plugin.desc             = &kclap_desc;
+    x->plugin.plugin_data      = x;
+    x->plugin.init             = kclap_init;
+    x->plugin.destroy          = kclap_destroy;
+    x->plugin.activate         = kclap_activate;
+    x->plugin.deactivate       = kclap_deactivate;
+    x->plugin.start_processing = kclap_start_processing;
+    x->plugin.stop_processing  = kclap_stop_processing;
+    x->plugin.reset            = kclap_reset;
+    x->plugin.process          = kclap_process;
+    x->plugin.get_extension    = kclap_get_extension;
+    x->plugin.on_main_thread   = kclap_on_main_thread;
+    return &x->plugin;
+}
+
+static const clap_plugin_factory_t kclap_factory = { kclap_factory_count, kclap_factory_desc, kclap_factory_create };
+
+static bool kclap_entry_init(const char *path) { (void)path; return true; }
+static void kclap_entry_deinit(void)           { }
+
+static const void *kclap_entry_factory(const char *id)
+{
+    return strcmp(id, CLAP_PLUGIN_FACTORY_ID) ? NULL : &kclap_factory;
+}
+
+CLAP_EXPORT const clap_plugin_entry_t clap_entry = {
+    CLAP_VERSION_INIT, kclap_entry_init, kclap_entry_deinit, kclap_entry_factory
+};
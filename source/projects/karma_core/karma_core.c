@@ -8,10 +8,287 @@
 #include "karma_state.h"   // named states for the control/perform state machine
 #include "karma_interp.h"  // buffer-read interpolation kernels (linear/cubic/spline + interp_index)
 #include "karma_ipoke.h"   // ease/ipoke write kernels (record fades, buffer declick)
+#include "karma_denormal.h" // scoped FTZ/DAZ + subnormal flush for the decaying overdub path
+#include "karma_dirty.h"    // per-vector written-frame ranges for set_dirty_range (+ undo capture, multiply)
+#include "karma_sinc.h"     // windowed-sinc read (interp 3), cutoff following speed
+#include "karma_mipmap.h"   // decimated levels read at high speed, updated from the dirty ranges
+#include "karma_shadow.h"   // the loop resampled to the system rate (srscale != 1)
+#include "karma_voices.h"   // extra read-only playheads on the loop
+#include "karma_prerec.h"   // rolling pre-record ring (karma_capture)
 
 // buffer-modify notification is a host concern; no-op in the core.
 static void karma_buf_modify(t_karma *x, void *b) { (void)x; (void)b; }
 
+// Host signals are perform64's double or, through karma_perform32, float32: the
+// perform body is instantiated once per format with f32 a compile-time constant.
+// Samples widen to double on the way in and round to float once on the way out,
+// so float32 I/O gives the double output as a float host would have converted it.
+static inline double karma_io_get(const void *p, long i, const int f32)
+{
+    return f32 ? (double)((const float *)p)[i] : ((const double *)p)[i];
+}
+
+// one sample from / to a host signal, advancing it
+static inline void karma_io_set(void *p, long i, double v, const int f32)
+{
+    if (f32)
+        ((float *)p)[i] = (float)v;
+    else
+        ((double *)p)[i] = v;
+}
+
+static inline double karma_io_read(void **p, const int f32)
+{
+    double v = karma_io_get(*p, 0, f32);
+    *p = f32 ? (void *)((float *)*p + 1) : (void *)((double *)*p + 1);
+    return v;
+}
+
+static inline void karma_io_write(void **p, double v, const int f32)
+{
+    if (f32) {
+        *(float *)*p = (float)v;
+        *p = (float *)*p + 1;
+    } else {
+        *(double *)*p = v;
+        *p = (double *)*p + 1;
+    }
+}
+
+// True when this vector's head step (speed * srscale) is one constant whole
+// number >= 0 (a speed signal that holds still counts): the head then sits on a
+// frame for every sample once it starts on one, frac is 0, and the perform loop
+// can read b[playhead] instead of interpolating (identical for finite samples).
+// Reverse steps are left out: the
+// reference measures them as frac = 1 from the next frame, where the kernels'
+// rounding is not a plain read. Only a hint -- the loop still checks frac.
+static inline t_bool karma_integral_speed(const void *inspeed, double step, double srscale, long n, const int f32)
+{
+    double s0;
+    long i;
+
+    if (inspeed) {
+        s0 = karma_io_get(inspeed, 0, f32);
+        step = s0 * srscale;
+        for (i = 1; i < n; i++)
+            if (karma_io_get(inspeed, i, f32) != s0)
+                return 0;
+    }
+    return (step >= 0.0) && (step == trunc(step));
+}
+
+// The instance's channel view of a buffer of bchans channels
+// (karma_core_set_channels), clamped to what the buffer has: returns the
+// channel count, first channel in *offset. The defaults (0, 0) are the whole
+// buffer, as in the reference. karma_view is the view of the current buffer.
+static inline int64_t karma_view_of(const t_karma *x, int64_t bchans, int64_t *offset)
+{
+    int64_t off = x->choffset, cnt;
+
+    if (off > bchans - 1) off = bchans - 1;
+    if (off < 0) off = 0;
+    cnt = bchans - off;
+    if ((x->chcount > 0) && (x->chcount < cnt))
+        cnt = x->chcount;
+    *offset = off;
+    return cnt;
+}
+
+static inline int64_t karma_view(const t_karma *x, int64_t *offset)
+{
+    return karma_view_of(x, x->bchans, offset);
+}
+
+// The perform routine's buffer writers: each runs its kernel, then records the
+// frames it touched so the host can be told exactly what changed this vector.
+static inline double dirty_commit(karma_dirty *d, float *b, int64_t pchans, int64_t nproc, int64_t frame, double *writeval, double pokesteps)
+{
+    karma_dirty_add(d, frame, frame);
+    return ipoke_commit(b, pchans, nproc, frame, writeval, pokesteps);
+}
+
+static inline void dirty_fill(karma_dirty *d, float *b, int64_t pchans, int64_t nproc, int64_t first, int64_t count, int64_t step, double *writeval, const double *delta)
+{
+    karma_dirty_span(d, first, count, step);
+    ipoke_fill(b, pchans, nproc, first, count, step, writeval, delta);
+}
+
+static inline void dirty_bufoff(karma_dirty *d, int64_t framesm1, float *b, int64_t pstride, int64_t pchans, int64_t markposition, char direction, double globalramp)
+{
+    karma_dirty_fade(d, framesm1, markposition, direction, (int64_t)ceil(globalramp));
+    ease_bufoff(framesm1, b, pstride, pchans, markposition, direction, globalramp);
+}
+
+static inline void dirty_bufon(karma_dirty *d, int64_t framesm1, float *b, int64_t pstride, int64_t pchans, int64_t markposition1, int64_t markposition2, char direction, double globalramp)
+{
+    int64_t n = (int64_t)ceil(globalramp);
+    karma_dirty_fade(d, framesm1, markposition1 - direction, -direction, n);
+    karma_dirty_fade(d, framesm1, markposition2 - direction, -direction, n);
+    karma_dirty_fade(d, framesm1, markposition2, direction, n);
+    ease_bufon(framesm1, b, pstride, pchans, markposition1, markposition2, direction, globalramp);
+}
+
+// Swap every page layer L saved with the buffer's current contents: undo when
+// the buffer holds L's output, redo when it holds what L overwrote.
+static void undo_swap_layer(karma_undo_state *u, int64_t L, karma_dirty *d)
+{
+    int64_t pos, end = undo_layer_end(u, L), k, n;
+    float  *page, *slot, t;
+
+    for (pos = u->start[L & (KARMA_UNDO_LAYERS - 1)]; pos < end; pos++) {
+        int64_t s = pos % u->npool, p = u->slotpage[s], f = p << KARMA_UNDO_SHIFT;
+        page = u->b + f * u->stride;
+        slot = u->pool + s * KARMA_UNDO_PAGE * u->chans;
+        n = undo_page_frames(u, p);
+        karma_dirty_add(d, f, f + n - 1);   // (d->undo is still unset here)
+        for (f = 0; f < n; f++, page += u->stride, slot += u->chans)
+            for (k = 0; k < u->chans; k++) { t = page[k]; page[k] = slot[k]; slot[k] = t; }
+    }
+}
+
+// Top of a vector: close the layer once recording has stopped, then act on a
+// pending reset / undo / redo. Returns true if the buffer changed.
+static t_bool undo_service(karma_undo_state *u, float *b, int64_t stride, t_bool recording, karma_dirty *d)
+{
+    char req = atomic_exchange_explicit(&u->request, UNDO_REQ_NONE, memory_order_acquire);
+    t_bool reset = atomic_exchange_explicit(&u->reset, 0, memory_order_acquire);
+    int64_t L;
+
+    u->b = b;
+    u->stride = stride;
+    if (u->open && (!recording || req || reset)) {
+        u->open = 0;
+        u->epoch++;
+    }
+    if (reset) {
+        u->first = u->applied = u->next = 0;
+        u->tail = u->head = 0;
+    }
+    if (req == UNDO_REQ_NONE)
+        return 0;
+    if (req == UNDO_REQ_UNDO) {
+        L = u->applied - 1;
+        if ((L < u->first) || u->lost[L & (KARMA_UNDO_LAYERS - 1)])
+            return 0;
+        undo_swap_layer(u, L, d);
+        u->applied--;
+    } else {
+        L = u->applied;
+        if (L >= u->next)
+            return 0;
+        undo_swap_layer(u, L, d);
+        u->applied++;
+    }
+    return 1;
+}
+
+// Top of a vector, after undo: act on a pending reset / multiply, then make one
+// more page of the extension real. Returns true if the buffer changed.
+static t_bool multiply_service(t_karma *x, karma_multiply_state *m)
+{
+    long factor = atomic_exchange_explicit(&m->request, 0, memory_order_acquire);
+    int64_t period, n, p, f, s, last, end;
+    int k;
+
+    if (atomic_exchange_explicit(&m->reset, 0, memory_order_acquire))
+        m->levels = 0;
+    if (factor) {
+        period = x->maxloop - x->minloop;
+        n = (period > 0) ? ((x->bframes - 1 - x->minloop) / period) : 0;
+        if (factor < n)
+            n = factor;
+        if (!x->loopdetermine && (x->directionorig >= 0) && (n >= 2) && (m->levels < KARMA_MULTIPLY_LEVELS)
+            && (!m->levels || ((x->minloop == m->base) && (period == m->period[m->levels]))))
+        {
+            if (!m->levels) {
+                memset(m->real, 0, (size_t)((m->npages + 31) >> 5) * sizeof(uint32_t));
+                m->base = x->minloop;
+                m->period[0] = period;
+            } else {                            // the page holding the old end is real: fill its new part now
+                end = m->base + period;
+                p = (end + 1) >> KARMA_MULTIPLY_SHIFT;
+                last = ((p + 1) << KARMA_MULTIPLY_SHIFT) - 1;
+                if (last > m->base + n * period)
+                    last = m->base + n * period;
+                if (mul_is_real(m, p)) {
+                    for (f = end + 1; f <= last; f++) {
+                        s = mul_resolve(m, m->base + 1 + (f - m->base - 1) % period);
+                        for (k = 0; k < m->chans; k++)
+                            m->b[f * m->stride + k] = m->b[s * m->stride + k];
+                    }
+                    if (end + 1 < m->dlo) m->dlo = end + 1;
+                    if (last > m->dhi) m->dhi = last;
+                }
+            }
+            m->period[++m->levels] = n * period;
+            m->cursor = (m->base + m->period[0] + 1) >> KARMA_MULTIPLY_SHIFT;
+            x->maxloop = x->minloop + n * period;
+            karma_select_size(x, x->selection);
+            karma_select_start(x, x->selstart);
+        }
+    }
+    if (m->levels) {                            // background: skip real pages, copy one
+        last = (m->base + m->period[m->levels]) >> KARMA_MULTIPLY_SHIFT;
+        for (k = 0; (k < 64) && (m->cursor <= last); k++) {
+            p = m->cursor++;
+            if (!mul_is_real(m, p)) {
+                mul_materialize(m, p);
+                break;
+            }
+        }
+        if (m->cursor > last)
+            m->levels = 0;                      // all real: a plain loop again
+    }
+    return m->dhi >= m->dlo;
+}
+
+// Top of a vector, before undo and multiply: act on a pending capture. The
+// ring's newest frames become frames 0.. of the view and the loop closes on
+// them the way an initial record ends (the loop-end path in the perform loop
+// sets the window, moves the head and declicks). Returns true if the buffer
+// changed.
+static t_bool prerec_service(t_karma *x, karma_prerec_state *q, float *b, int64_t stride, int64_t pchans, karma_dirty *d)
+{
+    double seconds = atomic_exchange_explicit(&q->request, 0.0, memory_order_acquire);
+    int64_t n, total;
+
+    if (q->chans != pchans)
+        return 0;
+    n = (int64_t)(seconds * x->ssr + 0.5);
+    if (n > q->filled)
+        n = q->filled;
+    if (n > x->bframes)
+        n = x->bframes;
+    if (n < 1)
+        return 0;
+    total = (n > KARMA_PREREC_MIN) ? n : (KARMA_PREREC_MIN + 1);
+    if (total > x->bframes)
+        total = x->bframes;
+    prerec_commit(q, b, stride, n, total);
+    karma_dirty_merge(d, 0, total - 1);
+    if (x->undo)                // a new take, as after the initial-record clear
+        atomic_store_explicit(&x->undo->reset, 1, memory_order_release);
+    if (x->mul)
+        atomic_store_explicit(&x->mul->reset, 1, memory_order_release);
+    if (x->mip)
+        x->mip->reset = 1;
+    if (x->shadow)
+        x->shadow->reset = 1;
+
+    x->minloop = 0;
+    x->maxhead = (double)(total - 1);
+    x->directionorig = 1;
+    x->recendmark = RECEND_EXIT_OVERDUB;    // any nonzero mark: compute the loop end
+    x->go = x->triginit = 1;
+    x->record = x->recordprev = x->loopdetermine = x->append = x->alternateflag = x->jumpflag = 0;
+    x->recfadeflag = x->playfadeflag = 0;
+    x->recordhead = -1;
+    x->statecontrol = SC_ZERO;
+    x->statehuman = SH_PLAY;
+    x->recordinit = x->stopallowed = 1;
+    return 1;
+}
+
 // ---- control methods (verbatim) ----
 void karma_float(t_karma *x, double speedfloat)
 {
@@ -137,7 +414,7 @@ void karma_record(t_karma *x)
     long i;
     char sc, sh;
     t_bool record, go, altflag, append, init;
-    int64_t bframes, rchans;  // !! local 'rchans' = 'nchans' not 'bchans' !!
+    int64_t bframes, rchans, rstride;  // !! local 'rchans' = 'nchans' not 'bchans' !!
     
     t_buffer_obj *buf = x->bufio.ctx;
 
@@ -177,28 +454,41 @@ void karma_record(t_karma *x)
             if (!go) {
                 init = 1;
                 if (buf) {
-                    rchans = x->bchans;     // !! nchans not bchans = only record onto channel(s) currently used by karma~...
+                    rchans = karma_view(x, &rstride);   // !! nchans not bchans = only record onto channel(s) currently used by karma~...
                     bframes = x->bframes;   // ...(leave other channels in tact)    <<-- BOLLOX
                     b = ((float*)x->bufio.lock(x->bufio.ctx));
                     if (!b)
                         goto zero;
+                    b += rstride;           // (the view's first channel...
+                    rstride = x->bchans;    // ...and the buffer's frame stride)
                     
                     for (i = 0; i < bframes; i++) {
                         if (rchans > 1) {
-                            b[i * rchans] = 0.0;
-                            b[(i * rchans) + 1] = 0.0;
+                            b[i * rstride] = 0.0;
+                            b[(i * rstride) + 1] = 0.0;
                             if (rchans > 2) {
-                                b[(i * rchans) + 2] = 0.0;
+                                b[(i * rstride) + 2] = 0.0;
                                 if (rchans > 3) {
-                                    b[(i * rchans) + 3] = 0.0;
+                                    b[(i * rstride) + 3] = 0.0;
                                 }
                             }
                         } else {
-                            b[i] = 0.0;
+                            b[i * rstride] = 0.0;
                         }
                     }
                     
-                    x->bufio.set_dirty(x->bufio.ctx);
+                    if (x->undo)            // pre-images predate the clear
+                        atomic_store_explicit(&x->undo->reset, 1, memory_order_release);
+                    if (x->mul)             // and so does the extension's source
+                        atomic_store_explicit(&x->mul->reset, 1, memory_order_release);
+                    if (x->mip)             // and every level
+                        x->mip->reset = 1;
+                    if (x->shadow)          // and the shadow
+                        x->shadow->reset = 1;
+                    if (x->bufio.set_dirty_range)
+                        x->bufio.set_dirty_range(x->bufio.ctx, 0, (long)bframes);
+                    else
+                        x->bufio.set_dirty(x->bufio.ctx);
                     x->bufio.unlock(x->bufio.ctx);
                 }
                 sc = SC_REC_INITIAL;
@@ -254,6 +544,113 @@ void karma_jump(t_karma *x, double jumpposition)
     }
 }
 
+// ---- dormant instances ----
+//
+// Stopped (not going, not recording), no message pending, every fade run out and
+// no background service with work left: a vector of the perform loop then only
+// writes zeros (and the held phase on the sync outlet), ramps the overdub amount
+// and tracks the direction. If the direction holds for the whole vector too, the
+// perform routine does just that much, without locking the buffer. (A buffer that
+// would not lock is not noticed while dormant: the sync outlet keeps the phase.)
+// It leaves the state struct alone from the second dormant vector on: the held
+// outputs are zeroed on the way in, and overdubprev is only written while an
+// overdub ramp is still running.
+static inline t_bool karma_dormant(const t_karma *x, const void *inspeed, long n, const int f32)
+{
+    const karma_undo_state *u = x->undo;
+    const karma_multiply_state *m = x->mul;
+    const karma_mipmap_state *p = x->mip;
+    const karma_shadow_state *r = x->shadow;
+    const karma_prerec_state *q = x->prerec;
+    double speed;
+    char direction;
+    long i;
+
+    if (x->go || x->record || x->recordprev || x->loopdetermine || (x->statecontrol != SC_ZERO) || x->recfadeflag
+        || (x->recordfade < x->globalramp) || x->buf_modified || !x->bufio.ctx)
+        return 0;
+    if ((u && (u->open || atomic_load_explicit(&u->reset, memory_order_acquire)
+               || atomic_load_explicit(&u->request, memory_order_acquire)))
+        || (m && (atomic_load_explicit(&m->reset, memory_order_acquire)
+                  || atomic_load_explicit(&m->request, memory_order_acquire) || m->levels))
+        || (p && (p->reset || (p->slo <= p->shi))))
+        return 0;
+    if (r && (x->interpflag != 3) && (r->reset || (r->slo <= r->shi) || (r->anchor != x->startloop) || (r->maxloop != x->maxloop)
+        || (r->directionorig != x->directionorig) || (r->interp != x->interpflag)))
+        return 0;
+    if (x->voices && voices_busy(x->voices))
+        return 0;
+    if (q && (atomic_load_explicit(&q->request, memory_order_acquire) > 0.0))
+        return 0;
+    if (!inspeed) {
+        speed = x->speedfloat;
+        return ((speed > 0) ? 1 : ((speed < 0) ? -1 : 0)) == x->directionprev;
+    }
+    for (i = 0; i < n; i++) {
+        speed = karma_io_get(inspeed, i, f32);
+        direction = (speed > 0) ? 1 : ((speed < 0) ? -1 : 0);
+        if (direction != x->directionprev)
+            return 0;
+    }
+    return 1;
+}
+
+// every sample of the nproc input channels is zero
+static inline t_bool karma_silent(void **in, int64_t nproc, long n, const int f32)
+{
+    int64_t ch;
+    long i;
+    for (ch = 0; ch < nproc; ch++)
+        for (i = 0; i < n; i++)
+            if (karma_io_get(in[ch], i, f32) != 0.0)
+                return 0;
+    return 1;
+}
+
+// The extra voices, at the end of the vector: rendered KARMA_VOICES_BLOCK
+// samples at a time into a double mix, which is added into the outputs (mapped
+// to them as the primary head's samples are).
+static void karma_voices_mix(karma_voices_state *vs, const karma_voice_loop *lp, t_bool ready,
+                             void **outs, long ochans, t_bool modout, long n, const int f32)
+{
+    double mix[4][KARMA_VOICES_BLOCK], dg;
+    int64_t k, c, live = 0;
+    long at, len, i, ch;
+    karma_voice *v;
+
+    for (k = 0; k < vs->count; k++) {
+        voice_begin(&vs->v[k], lp, ready);
+        live += vs->v[k].on || (vs->v[k].snrfade < 1.0);
+    }
+    if (live) {
+        for (at = 0; at < n; at += len) {
+            len = (n - at < KARMA_VOICES_BLOCK) ? (n - at) : KARMA_VOICES_BLOCK;
+            for (c = 0; c < lp->nproc; c++)
+                memset(mix[c], 0, (size_t)len * sizeof(double));
+            for (k = 0; k < vs->count; k++) {
+                v = &vs->v[k];
+                dg = (v->gnext - v->gprev) / n;
+                voice_render(v, lp, mix, len, v->gprev + dg * at, dg);
+            }
+            for (ch = 0; ch < ochans; ch++) {
+                if ((ch >= lp->nproc) && !modout)
+                    continue;
+                c = ch % lp->nproc;
+                for (i = 0; i < len; i++)
+                    karma_io_set(outs[ch], at + i, karma_io_get(outs[ch], at + i, f32) + mix[c][i], f32);
+            }
+        }
+    }
+    for (k = 0; k < vs->count; k++) {
+        v = &vs->v[k];
+        v->gprev = v->gnext;
+        for (c = 0; c < 4; c++) {
+            v->oprev[c] = karma_flush(v->oprev[c]);
+            v->odif[c] = karma_flush(v->odif[c]);
+        }
+    }
+}
+
 // ---- perform (one channel-generic routine) ----
 //
 // The reference shipped three near-identical perform routines (mono/stereo/quad),
@@ -264,36 +661,93 @@ void karma_jump(t_karma *x, double jumpposition)
 // read / interpolation / ipoke-write are inner loops over nproc = min(pchans,
 // ochans) channels. Output is ochans-wide; any output channel beyond the buffer's
 // channel count is silenced -- exactly as the reference's pchans<ochans branches
-// did. Verified sample-for-sample against the reference across every scenario
+// did -- unless @modout is on, when output c repeats buffer channel c % pchans
+// (each channel still interpolated once). Verified sample-for-sample against the reference across every scenario
 // (incl. the pchans<ochans cases) by the offline harness.
 //
 // The three public entry points below forward to it (preserving the API/ABI the
-// host shell calls), so nothing outside this file changes.
-static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
+// host shell calls), so nothing outside this file changes. It is written once
+// for both host sample formats (karma_io_*): karma_perform64 and karma_perform32
+// each inline it with f32 fixed.
+#if defined(_MSC_VER)
+    #define KARMA_PERFORM_INLINE static __forceinline
+#else
+    #define KARMA_PERFORM_INLINE static inline __attribute__((always_inline))
+#endif
+
+KARMA_PERFORM_INLINE void karma_perform(t_karma *x, void **ins, void **outs, long vcount, const int f32)
 {
     long    syncoutlet  = x->syncoutlet;
     long    ochans      = (long)x->ochans;
 
-    double *in[4], *out[4];
+    void   *in[4], *out[4];
     long    ch;
     for (ch = 0; ch < ochans; ch++) { in[ch] = ins[ch]; out[ch] = outs[ch]; }
-    double *inspeed = ins[ochans];              // speed (if signal connected)
-    double *outPh   = syncoutlet ? outs[ochans] : 0;   // sync (if @syncout 1)
+    void   *inspeed = ins[ochans];              // speed (if signal connected)
+    void   *outPh   = syncoutlet ? outs[ochans] : 0;   // sync (if @syncout 1)
 
     long    n = vcount;
     short   speedinlet  = x->speedconnect;
 
+    if (x->prerec) {            // the ring takes the input whatever the instance does
+        karma_prerec_state *q = x->prerec;
+        int64_t off;
+        if (q->chans == karma_view(x, &off))
+            prerec_write(q, in, (q->chans < ochans) ? q->chans : ochans, n, f32);
+    }
+
+    if (karma_dormant(x, speedinlet ? inspeed : NULL, n, f32)) {
+        double *held[4] = { &x->o1prev, &x->o2prev, &x->o3prev, &x->o4prev };
+        for (ch = 0; ch < ochans; ch++) {
+            memset(out[ch], 0, (size_t)n * (f32 ? sizeof(float) : sizeof(double)));
+            if (*held[ch] != 0.0)   // once, going dormant
+                *held[ch] = 0.0;
+        }
+        if (syncoutlet) {
+            int64_t setloopsize = x->maxloop - x->minloop;
+            double phase = (x->directionorig >= 0) ? ((x->playhead - x->minloop) / setloopsize)
+                                                   : ((x->playhead - (x->bframes - setloopsize)) / setloopsize);
+            while (n--)
+                karma_io_write(&outPh, phase, f32);
+        }
+        if (x->overdubprev != x->overdubamp) {  // the overdub ramp runs on, as in the loop below
+            karma_fpu_state fpu;
+            double amp = x->overdubprev, dif = (x->overdubamp - x->overdubprev) / vcount;
+            karma_fpu_enter(&fpu);
+            if (dif != 0.0)
+                for (n = 0; n < vcount; n++)
+                    amp = amp + dif;
+            x->overdubprev = amp;
+            karma_fpu_leave(&fpu);
+        }
+        return;
+    }
+
     double accuratehead, maxhead, jumphead, srscale, speedsrscaled, recplaydif, pokesteps;
     double speed, speedfloat, overdubamp, overdubprev, ovdbdif, selstart, selection;
     double frac, snrfade, globalramp, snrramp;
     double osamp[4], recin[4], writeval[4], coeff[4], oprev[4], odif[4];
-    t_bool go, record, recordprev, alternateflag, loopdetermine, jumpflag, append, dirt, wrapflag, triginit;
+    t_bool go, record, recordprev, alternateflag, loopdetermine, jumpflag, append, dirt, wrapflag, triginit, islooped, modout;
+    t_bool integral, onframe, quiet, kept = 0;
+    int lvl;
     char direction, directionprev, directionorig, statecontrol, playfadeflag, recfadeflag, recendmark;
-    int64_t playfade, recordfade, i, interp0, interp1, interp2, interp3, pchans, snrtype, interp, nproc;
+    int64_t playfade, recordfade, i, interp0, interp1, interp2, interp3, pchans, pstride, snrtype, interp, nproc, sinctaps;
     int64_t frames, startloop, endloop, playhead, recordhead, minloop, maxloop, setloopsize;
     int64_t initiallow, initialhigh;
+    karma_state *st;
 
     t_buffer_obj *buf = x->bufio.ctx;
+    karma_undo_state *undo = x->undo;
+    karma_multiply_state *mul = NULL;
+    karma_mipmap_state *mip = NULL;
+    karma_shadow_state *shadow = NULL;
+    t_bool mapped = 0, mipread = 0;
+    karma_dirty dirty;
+    dirty.undo = NULL;
+    dirty.mul = NULL;
+    dirty.n = 0;
+    karma_fpu_state fpu;
+    karma_fpu_enter(&fpu);      // FTZ/DAZ for this vector (restored on every exit)
     float *b = ((float*)x->bufio.lock(x->bufio.ctx));
 
     record          = x->record;
@@ -307,54 +761,94 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
         karma_buf_modify(x, buf);
         x->buf_modified  = false;
     }
+    pstride         = x->bchans;                // floats per buffer frame
+    pchans          = karma_view(x, &i);        // channels of it this instance owns...
+    b              += i;                        // ...starting at channel i
+    if (x->prerec && (atomic_load_explicit(&x->prerec->request, memory_order_acquire) > 0.0) && prerec_service(x, x->prerec, b, pstride, pchans, &dirty)) {
+        record      = recordprev = 0;
+        dirt        = 1;
+    }
+    if (x->mul && (x->mul->frames == x->bframes) && (x->mul->chans == pchans)) {
+        mul         = x->mul;
+        mul->b      = b;
+        mul->stride = pstride;
+        mul->dlo    = INT64_MAX;
+        mul->dhi    = -1;
+        dirty.mul   = mul;      // writers (undo swaps included) materialize pages first
+    }
+    if (undo && (undo->frames == x->bframes) && (undo->chans == pchans)) {
+        if (undo_service(undo, b, pstride, record || recordprev, &dirty))
+            dirt    = 1;
+        dirty.undo  = undo;     // from here on, writers save pages before touching them
+    }
+    if (mul) {
+        lvl         = mul->levels;
+        if (multiply_service(x, mul))
+            dirt    = 1;
+        mapped      = (mul->levels > 0);    // reads resolve through the extension
+        if (x->mip && (mul->levels > lvl))  // a new extension: its levels are the old content
+            mip_stale(x->mip, mul->base + mul->period[0] + 1, mul->base + mul->period[mul->levels]);
+    }
+    if (x->mip && (x->mip->frames == x->bframes) && (x->mip->chans == pchans)) {
+        mip         = x->mip;   // written ranges go up the levels at the end of the vector
+        mipread     = !mip_service(mip, b, pstride, mapped ? mul : NULL);  // (until filled: the buffer)
+    }
 
-    oprev[0] = x->o1prev; oprev[1] = x->o2prev; oprev[2] = x->o3prev; oprev[3] = x->o4prev;
-    odif[0]  = x->o1dif;  odif[1]  = x->o2dif;  odif[2]  = x->o3dif;  odif[3]  = x->o4dif;
-    writeval[0] = x->writeval1; writeval[1] = x->writeval2; writeval[2] = x->writeval3; writeval[3] = x->writeval4;
-
-    go              = x->go;
-    statecontrol    = x->statecontrol;
-    playfadeflag    = x->playfadeflag;
-    recfadeflag     = x->recfadeflag;
-    recordhead      = x->recordhead;
-    alternateflag   = x->alternateflag;
-    pchans          = x->bchans;
+    st = &x->st;                // the carried state: one block, written back at the end
+    oprev[0] = st->o1prev; oprev[1] = st->o2prev; oprev[2] = st->o3prev; oprev[3] = st->o4prev;
+    odif[0]  = st->o1dif;  odif[1]  = st->o2dif;  odif[2]  = st->o3dif;  odif[3]  = st->o4dif;
+    writeval[0] = st->writeval1; writeval[1] = st->writeval2; writeval[2] = st->writeval3; writeval[3] = st->writeval4;
+
+    go              = st->go;
+    statecontrol    = st->statecontrol;
+    playfadeflag    = st->playfadeflag;
+    recfadeflag     = st->recfadeflag;
+    recordhead      = st->recordhead;
+    alternateflag   = st->alternateflag;
     srscale         = x->srscale;
     frames          = x->bframes;
-    triginit        = x->triginit;
-    jumpflag        = x->jumpflag;
-    append          = x->append;
-    directionorig   = x->directionorig;
-    directionprev   = x->directionprev;
-    minloop         = x->minloop;
-    maxloop         = x->maxloop;
-    initiallow      = x->initiallow;
-    initialhigh     = x->initialhigh;
+    triginit        = st->triginit;
+    jumpflag        = st->jumpflag;
+    append          = st->append;
+    directionorig   = st->directionorig;
+    directionprev   = st->directionprev;
+    minloop         = st->minloop;
+    maxloop         = st->maxloop;
+    initiallow      = st->initiallow;
+    initialhigh     = st->initialhigh;
     selection       = x->selection;
-    loopdetermine   = x->loopdetermine;
-    startloop       = x->startloop;
+    loopdetermine   = st->loopdetermine;
+    startloop       = st->startloop;
     selstart        = x->selstart;
-    endloop         = x->endloop;
-    recendmark      = x->recendmark;
-    overdubamp      = x->overdubprev;
+    endloop         = st->endloop;
+    recendmark      = st->recendmark;
+    overdubamp      = st->overdubprev;
     overdubprev     = x->overdubamp;
     ovdbdif         = (overdubamp != overdubprev) ? ((overdubprev - overdubamp) / n) : 0.0;
-    recordfade      = x->recordfade;
-    playfade        = x->playfade;
-    accuratehead    = x->playhead;
+    recordfade      = st->recordfade;
+    playfade        = st->playfade;
+    accuratehead    = st->playhead;
     playhead        = trunc(accuratehead);
-    maxhead         = x->maxhead;
-    wrapflag        = x->wrapflag;
+    maxhead         = st->maxhead;
+    wrapflag        = st->wrapflag;
     jumphead        = x->jumphead;
-    pokesteps       = x->pokesteps;
-    snrfade         = x->snrfade;
+    pokesteps       = st->pokesteps;
+    snrfade         = st->snrfade;
     globalramp      = (double)x->globalramp;
     snrramp         = (double)x->snrramp;
     snrtype         = x->snrtype;
     interp          = x->interpflag;
+    sinctaps        = x->sinctaps;
     speedfloat      = x->speedfloat;
+    islooped        = (x->islooped != 0);
+    modout          = (x->moduloout != 0);
 
     nproc           = (pchans < ochans) ? pchans : ochans;  // channels actually read/recorded
+    integral        = (interp != 3) && karma_integral_speed(speedinlet ? inspeed : NULL, speedfloat * srscale, srscale, n, f32);
+    if (x->shadow && (interp != 3) && (x->shadow->frames == frames) && (x->shadow->chans == pchans) && (x->shadow->srscale == srscale)) {
+        shadow      = x->shadow;
+        shadow_service(shadow, b, pstride, mapped ? mul : NULL, startloop, maxloop, directionorig, interp, n);
+    }
 
     switch (statecontrol)   // "all-in-one 'switch' statement to catch and handle all(most) messages" - raja
     {
@@ -423,6 +917,10 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
             break;          // !!
     }
 
+    // overdubbing silence at unity: the ipoke store mostly writes back what the
+    // frame holds (checked per frame, see below)
+    quiet           = (record || recfadeflag) && !loopdetermine && !mapped && (overdubamp == 1.0) && (ovdbdif == 0.0) && karma_silent(in, nproc, n, f32);
+
     //  raja notes:
     // 'snrfade = 0.0' triggers switch&ramp (declick play)
     // 'recordhead = -1' triggers ipoke-interp cuts and accompanies buf~ fades (declick record)
@@ -430,14 +928,14 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
     while (n--)
     {
         for (ch = 0; ch < nproc; ch++)
-            recin[ch] = *in[ch]++;
-        speed = speedinlet ? *inspeed++ : speedfloat;   // signal of float ?
+            recin[ch] = karma_io_read(&in[ch], f32);
+        speed = speedinlet ? karma_io_read(&inspeed, f32) : speedfloat;   // signal of float ?
         direction = (speed > 0) ? 1 : ((speed < 0) ? -1 : 0);
 
         // declick for change of 'dir'ection
         if (directionprev != direction) {
             if (record && globalramp) {
-                ease_bufoff(frames - 1, b, pchans, recordhead, -direction, globalramp);
+                dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, recordhead, -direction, globalramp);
                 recordfade = recfadeflag = 0;
                 recordhead = -1;
             }
@@ -446,7 +944,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
 
         if ((record - recordprev) < 0) {           // samp @record-off
             if (globalramp)
-                ease_bufoff(frames - 1, b, pchans, recordhead, direction, globalramp);
+                dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, recordhead, direction, globalramp);
             //initialhigh = loopdetermine ? recordhead : initialhigh;
             recordhead = -1;
             dirt = 1;
@@ -455,7 +953,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
             if (speed < 1.0)
                 snrfade = 0.0;
             if (globalramp)
-                ease_bufoff(frames - 1, b, pchans, accuratehead, -direction, globalramp);
+                dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, accuratehead, -direction, globalramp);
         }
         recordprev = record;
 
@@ -482,7 +980,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                             }
                             if (direction < 0) {
                                 if (globalramp)
-                                    ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                    dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                             }
                         } else {
                             maxloop = CLAMP((frames - 1) - maxhead, 4096, frames - 1);
@@ -498,11 +996,11 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                             accuratehead = endloop;
                             if (direction > 0) {
                                 if (globalramp)
-                                    ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                    dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                             }
                         }
                         if (globalramp)
-                            ease_bufoff(frames - 1, b, pchans, maxhead, -direction, globalramp);
+                            dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, maxhead, -direction, globalramp);
                         recordhead = -1;
                         snrfade = 0.0;
                         triginit = 0;
@@ -515,7 +1013,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                             accuratehead = (direction < 0) ? endloop : startloop;
                         if (record) {
                             if (globalramp) {
-                                ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                 recordfade = 0;
                             }
                             recordhead = -1;
@@ -549,7 +1047,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -560,7 +1058,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -574,7 +1072,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -585,7 +1083,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -598,11 +1096,19 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                         {
                             if ((accuratehead > endloop) && (accuratehead < startloop))
                             {
+                                // one-shot: fade out like 'stop', the head reading on through the wrap
+                                if (!islooped && !record && (playfadeflag != PLAY_FADE_OUT)) {
+                                    playfade = 0;
+                                    playfadeflag = PLAY_FADE_OUT;
+                                    append = 0;
+                                    x->statehuman = SH_STOP;
+                                    x->stopallowed = 0;
+                                }
                                 accuratehead = (direction >= 0) ? startloop : endloop;
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -615,7 +1121,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                     snrfade = 0.0;
                                     if (record) {
                                         if (globalramp) {
-                                            ease_bufoff(frames - 1, b, pchans, maxloop, -direction, globalramp);
+                                            dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, maxloop, -direction, globalramp);
                                             recordfade = 0;
                                         }
                                         recfadeflag = 0;
@@ -628,7 +1134,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                     snrfade = 0.0;
                                     if (record) {
                                         if (globalramp) {
-                                            ease_bufoff(frames - 1, b, pchans, minloop, -direction, globalramp);     // 0.0  // ??
+                                            dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, minloop, -direction, globalramp);     // 0.0  // ??
                                             recordfade = 0;
                                         }
                                         recfadeflag = 0;
@@ -643,7 +1149,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                     if (record)
                                     {
                                         if (globalramp) {
-                                            ease_bufoff(frames - 1, b, pchans, ((frames - 1) - maxloop), -direction, globalramp);
+                                            dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, ((frames - 1) - maxloop), -direction, globalramp);
                                             recordfade = 0;
                                         }
                                         recfadeflag = 0;
@@ -654,7 +1160,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                                     snrfade = 0.0;
                                     if (record) {
                                         if (globalramp) {
-                                            ease_bufoff(frames - 1, b, pchans, (frames - 1), -direction, globalramp);
+                                            dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, (frames - 1), -direction, globalramp);
                                             recordfade = 0;
                                         }
                                         recfadeflag = 0;
@@ -665,11 +1171,19 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                         } else {    // (not wrapflag)
                             if ((accuratehead > endloop) || (accuratehead < startloop))
                             {
+                                // one-shot: fade out like 'stop', the head reading on through the wrap
+                                if (!islooped && !record && (playfadeflag != PLAY_FADE_OUT)) {
+                                    playfade = 0;
+                                    playfadeflag = PLAY_FADE_OUT;
+                                    append = 0;
+                                    x->statehuman = SH_STOP;
+                                    x->stopallowed = 0;
+                                }
                                 accuratehead = (direction >= 0) ? startloop : endloop;
                                 snrfade = 0.0;
                                 if (record) {
                                     if (globalramp) {
-                                        ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                        dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                         recordfade = 0;
                                     }
                                     recfadeflag = 0;
@@ -690,18 +1204,44 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                 } else {
                     frac = 0.0;
                 }                                                                                   // setloopsize  // ??
-                interp_index(playhead, &interp0, &interp1, &interp2, &interp3, direction, directionorig, maxloop, frames - 1);  // samp-indices
+                onframe = 0;
+                lvl = (mipread && !record && !dirty.n && (interp != 3)) ? mip_level(speed * srscale) : 0;   // (levels are as of the vector's start)
+                if (integral && !lvl && (frac == 0.0)) {    // on a frame: every kernel returns b[playhead]...
+                    interp1 = mapped ? mul_resolve(mul, playhead) : playhead;
+                    onframe = 1;
+                    for (ch = 0; ch < nproc; ch++) {
+                        osamp[ch] = b[interp1 * pstride + ch];
+                        if ((osamp[ch] == 0.0) && signbit(osamp[ch]))
+                            onframe = 0;            // ...except -0.0, whose sign depends on the neighbours
+                    }
+                }
+                if (!onframe && shadow && !record && !dirty.n && !lvl && (direction > 0) && (startloop == shadow->anchor) && (maxloop == shadow->maxloop))
+                    onframe = shadow_read(osamp, shadow, nproc, accuratehead);   // on the resampled grid: precomputed
+                if (!record && (interp == 3)) {     // band-limited: all channels from one set of coefficients
+                    sinc_read(osamp, b, pstride, nproc, sinctaps, accuratehead, playhead, speed * srscale,
+                              direction, directionorig, maxloop, frames - 1, mapped ? mul : NULL);
+                } else if (lvl) {                   // 2x / 4x / 8x: the matching decimated level
+                    mip_read(osamp, mip, lvl, nproc, accuratehead, playhead, direction, directionorig, maxloop, frames - 1);
+                } else if (!onframe) {
+                    interp_index(playhead, &interp0, &interp1, &interp2, &interp3, direction, directionorig, maxloop, frames - 1);  // samp-indices
+                    if (mapped) {
+                        interp0 = mul_resolve(mul, interp0);
+                        interp1 = mul_resolve(mul, interp1);
+                        interp2 = mul_resolve(mul, interp2);
+                        interp3 = mul_resolve(mul, interp3);
+                    }
 
-                for (ch = 0; ch < nproc; ch++) {
-                    if (record) {           // if recording do linear-interp else...
-                        osamp[ch] = LINEAR_INTERP(frac, b[interp1 * pchans + ch], b[interp2 * pchans + ch]);
-                    } else {                // ...cubic / spline if interpflag > 0 (default cubic)
-                        if (interp == 1)
-                            osamp[ch] = CUBIC_INTERP(frac, b[interp0 * pchans + ch], b[interp1 * pchans + ch], b[interp2 * pchans + ch], b[interp3 * pchans + ch]);
-                        else if (interp == 2)
-                            osamp[ch] = SPLINE_INTERP(frac, b[interp0 * pchans + ch], b[interp1 * pchans + ch], b[interp2 * pchans + ch], b[interp3 * pchans + ch]);
-                        else
-                            osamp[ch] = LINEAR_INTERP(frac, b[interp1 * pchans + ch], b[interp2 * pchans + ch]);
+                    for (ch = 0; ch < nproc; ch++) {
+                        if (record) {           // if recording do linear-interp else...
+                            osamp[ch] = LINEAR_INTERP(frac, b[interp1 * pstride + ch], b[interp2 * pstride + ch]);
+                        } else {                // ...cubic / spline if interpflag > 0 (default cubic)
+                            if (interp == 1)
+                                osamp[ch] = CUBIC_INTERP(frac, b[interp0 * pstride + ch], b[interp1 * pstride + ch], b[interp2 * pstride + ch], b[interp3 * pstride + ch]);
+                            else if (interp == 2)
+                                osamp[ch] = SPLINE_INTERP(frac, b[interp0 * pstride + ch], b[interp1 * pstride + ch], b[interp2 * pstride + ch], b[interp3 * pstride + ch]);
+                            else
+                                osamp[ch] = LINEAR_INTERP(frac, b[interp1 * pstride + ch], b[interp2 * pstride + ch]);
+                        }
                     }
                 }
 
@@ -780,30 +1320,34 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
             }
 
             for (ch = 0; ch < ochans; ch++) {
-                double s = (ch < nproc) ? osamp[ch] : 0.0;
+                double s = (ch < nproc) ? osamp[ch] : (modout ? osamp[ch % nproc] : 0.0);
                 oprev[ch] = s;
-                *out[ch]++ = s;
+                karma_io_write(&out[ch], s, f32);
             }
             if (syncoutlet) {
                 setloopsize = maxloop-minloop;
-                *outPh++    = (directionorig>=0) ? ((accuratehead-minloop)/setloopsize) : ((accuratehead-(frames-setloopsize))/setloopsize);
+                karma_io_write(&outPh, (directionorig>=0) ? ((accuratehead-minloop)/setloopsize) : ((accuratehead-(frames-setloopsize))/setloopsize), f32);
             }
 
             /*
              ~ipoke - originally by PA Tremblay: http://www.pierrealexandretremblay.com/welcome.html
              (modded to allow for 'selection' (window) and 'selstart' (position) to change on the fly)
              raja's razor: simplest answer to everything was:
-             recin1 = ease_record(recin1 + (b[playhead * pchans] * overdubamp), recfadeflag, globalramp, recordfade); ...
+             recin1 = ease_record(recin1 + (b[playhead * pstride] * overdubamp), recfadeflag, globalramp, recordfade); ...
              ... placed at the beginning / input of ipoke~ code to apply appropriate ramps to oldbuf + newinput (everything all-at-once) ...
              ... allows ipoke~ code to work its sample-specific math / magic accurately through the ducking / ramps even at high speed
             */
             if (record)
             {
+                int64_t rd = mapped ? mul_resolve(mul, playhead) : playhead;
                 for (ch = 0; ch < nproc; ch++) {
                     if ((recordfade < globalramp) && (globalramp > 0.0))
-                        recin[ch] = ease_record(recin[ch] + (((double)b[playhead * pchans + ch]) * overdubamp), recfadeflag, globalramp, recordfade);
+                        recin[ch] = ease_record(recin[ch] + (((double)b[rd * pstride + ch]) * overdubamp), recfadeflag, globalramp, recordfade);
                     else
-                        recin[ch] += ((double)b[playhead * pchans + ch]) * overdubamp;
+                        recin[ch] += ((double)b[rd * pstride + ch]) * overdubamp;
+#if !KARMA_FTZ
+                    recin[ch] = karma_flush(recin[ch]);     // no FTZ on this target: flush the decaying mix
+#endif
                 }
 
                 if (recordhead < 0) {
@@ -816,23 +1360,19 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                 if (recordhead == playhead) {
                     for (ch = 0; ch < nproc; ch++) writeval[ch] += recin[ch];
                     pokesteps += 1.0;
-                } else {
-                    if (pokesteps > 1.0) {              // linear-averaging for speed < 1x
-                        for (ch = 0; ch < nproc; ch++) writeval[ch] = writeval[ch] / pokesteps;
-                        pokesteps = 1.0;
-                    }
-                    for (ch = 0; ch < nproc; ch++) b[recordhead * pchans + ch] = writeval[ch];
+                } else if (quiet && (pokesteps == 1.0) && (playhead - recordhead == direction)
+                           && ipoke_unchanged(b + recordhead * pstride, nproc, writeval)) {
+                    for (ch = 0; ch < nproc; ch++) writeval[ch] = recin[ch];    // 1 frame on, nothing to store:
+                    kept = 1;                                                   // no write, no dirty range
+                } else {                                // (linear-averaging for speed < 1x)
+                    pokesteps = dirty_commit(&dirty, b, pstride, nproc, recordhead, writeval, pokesteps);
                     recplaydif = (double)(playhead - recordhead);
                     if (recplaydif > 0) {               // linear-interpolation for speed > 1x
-                        for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                        for (i = recordhead + 1; i < playhead; i++) {
-                            for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                        }
+                        ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                        dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, playhead - recordhead - 1, 1, writeval, coeff);
                     } else {
-                        for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                        for (i = recordhead - 1; i > playhead; i--) {
-                            for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                        }
+                        ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                        dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead - playhead - 1, -1, writeval, coeff);
                     }
                     for (ch = 0; ch < nproc; ch++) writeval[ch] = recin[ch];
                 }
@@ -890,7 +1430,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                         snrfade = 0.0;
                         if (record) {
                             if (globalramp) {
-                                ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                 recordfade = 0;
                             }
                             recfadeflag = 0;
@@ -904,7 +1444,7 @@ static void karma_perform(t_karma *x, double **ins, double **outs, long vcount)
                         {
                             accuratehead = maxhead;                 // !! maxhead !!
                             if (globalramp) {
-                                ease_bufon(frames - 1, b, pchans, accuratehead, recordhead, direction, globalramp);
+                                dirty_bufon(&dirty, frames - 1, b, pstride, pchans, accuratehead, recordhead, direction, globalramp);
                                 recordfade = 0;
                             }
                             alternateflag = 1;
@@ -938,7 +1478,7 @@ apned:
                             record = append;
                             if (record) {
                                 if (globalramp) {
-                                    ease_bufoff(frames - 1, b, pchans, (frames - 1), -direction, globalramp);   // maxloop ??
+                                    dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, (frames - 1), -direction, globalramp);   // maxloop ??
                                     recordhead = -1;
                                     recfadeflag = recordfade = 0;
                                 }
@@ -951,7 +1491,7 @@ apned:
                             record = append;
                             if (record) {
                                 if (globalramp) {
-                                    ease_bufoff(frames - 1, b, pchans, minloop, -direction, globalramp);     // 0.0  // ??
+                                    dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, minloop, -direction, globalramp);     // 0.0  // ??
                                     recordhead = -1;
                                     recfadeflag = recordfade = 0;
                                 }
@@ -969,7 +1509,7 @@ apned:
                         {
                             accuratehead = maxhead + accuratehead;
                             if (globalramp) {
-                                ease_bufoff(frames - 1, b, pchans, minloop, -direction, globalramp);     // 0.0  // ??
+                                dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, minloop, -direction, globalramp);     // 0.0  // ??
                                 recordhead = -1;
                                 recfadeflag = recordfade = 0;
                             }
@@ -979,7 +1519,7 @@ apned:
                         {
                             accuratehead = maxhead + (accuratehead - (frames - 1));
                             if (globalramp) {
-                                ease_bufoff(frames - 1, b, pchans, (frames - 1), -direction, globalramp);   // maxloop ??
+                                dirty_bufoff(&dirty, frames - 1, b, pstride, pchans, (frames - 1), -direction, globalramp);   // maxloop ??
                                 recordhead = -1;
                                 recfadeflag = recordfade = 0;
                             }
@@ -1057,22 +1597,26 @@ apned:
             for (ch = 0; ch < ochans; ch++) {
                 osamp[ch] = 0.0;
                 oprev[ch] = osamp[ch];
-                *out[ch]++ = osamp[ch];
+                karma_io_write(&out[ch], osamp[ch], f32);
             }
             if (syncoutlet) {
                 setloopsize = maxloop-minloop;
-                *outPh++    = (directionorig>=0) ? ((accuratehead-minloop)/setloopsize) : ((accuratehead-(frames-setloopsize))/setloopsize);
+                karma_io_write(&outPh, (directionorig>=0) ? ((accuratehead-minloop)/setloopsize) : ((accuratehead-(frames-setloopsize))/setloopsize), f32);
             }
 
             // ~ipoke - originally by PA Tremblay: http://www.pierrealexandretremblay.com/welcome.html
             // (modded to assume maximum distance recorded into buffer~ as the total length)
             if (record)
             {
+                int64_t rd = mapped ? mul_resolve(mul, playhead) : playhead;
                 for (ch = 0; ch < nproc; ch++) {
                     if ((recordfade < globalramp) && (globalramp > 0.0))
-                        recin[ch] = ease_record(recin[ch] + ((double)b[playhead * pchans + ch]) * overdubamp, recfadeflag, globalramp, recordfade);
+                        recin[ch] = ease_record(recin[ch] + ((double)b[rd * pstride + ch]) * overdubamp, recfadeflag, globalramp, recordfade);
                     else
-                        recin[ch] += ((double)b[playhead * pchans + ch]) * overdubamp;
+                        recin[ch] += ((double)b[rd * pstride + ch]) * overdubamp;
+#if !KARMA_FTZ
+                    recin[ch] = karma_flush(recin[ch]);     // no FTZ on this target: flush the decaying mix
+#endif
                 }
 
                 if (recordhead < 0) {
@@ -1085,12 +1629,8 @@ apned:
                 if (recordhead == playhead) {
                     for (ch = 0; ch < nproc; ch++) writeval[ch] += recin[ch];
                     pokesteps += 1.0;
-                } else {
-                    if (pokesteps > 1.0) {                          // linear-averaging for speed < 1x
-                        for (ch = 0; ch < nproc; ch++) writeval[ch] = writeval[ch] / pokesteps;
-                        pokesteps = 1.0;
-                    }
-                    for (ch = 0; ch < nproc; ch++) b[recordhead * pchans + ch] = writeval[ch];
+                } else {                                            // (linear-averaging for speed < 1x)
+                    pokesteps = dirty_commit(&dirty, b, pstride, nproc, recordhead, writeval, pokesteps);
                     recplaydif = (double)(playhead - recordhead);   // linear-interp for speed > 1x
                     if (direction != directionorig)
                     {
@@ -1101,35 +1641,25 @@ apned:
                                 if (recplaydif > (maxhead * 0.5))
                                 {
                                     recplaydif -= maxhead;
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead - 1); i >= 0; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
-                                    for (i = maxhead; i > playhead; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead, -1, writeval, coeff);       // (recordhead - 1) .. 0
+                                    i = maxhead;
+                                    dirty_fill(&dirty, b, pstride, nproc, i, i - playhead, -1, writeval, coeff);                  // maxhead .. (playhead + 1)
                                 } else {
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead + 1); i < playhead; i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, playhead - recordhead - 1, 1, writeval, coeff);
                                 }
                             } else {
                                 if ((-recplaydif) > (maxhead * 0.5))
                                 {
                                     recplaydif += maxhead;
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead + 1); i < (maxhead + 1); i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
-                                    for (i = 0; i < playhead; i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                                    i = ceil(maxhead);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, i - recordhead, 1, writeval, coeff);   // (recordhead + 1) .. maxhead
+                                    dirty_fill(&dirty, b, pstride, nproc, 0, playhead, 1, writeval, coeff);                      // 0 .. (playhead - 1)
                                 } else {
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead - 1); i > playhead; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead - playhead - 1, -1, writeval, coeff);
                                 }
                             }
                         } else {
@@ -1138,50 +1668,36 @@ apned:
                                 if (recplaydif > (((frames - 1) - (maxhead)) * 0.5))
                                 {
                                     recplaydif -= ((frames - 1) - (maxhead));
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead - 1); i >= maxhead; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
-                                    for (i = (frames - 1); i > playhead; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                                    i = ceil(maxhead);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead - i, -1, writeval, coeff);  // (recordhead - 1) .. maxhead
+                                    dirty_fill(&dirty, b, pstride, nproc, frames - 1, (frames - 1) - playhead, -1, writeval, coeff);
                                 } else {
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead + 1); i < playhead; i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, playhead - recordhead - 1, 1, writeval, coeff);
                                 }
                             } else {
                                 if ((-recplaydif) > (((frames - 1) - (maxhead)) * 0.5))
                                 {
                                     recplaydif += ((frames - 1) - (maxhead));
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead + 1); i < frames; i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
-                                    for (i = maxhead; i < playhead; i++) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, frames - recordhead - 1, 1, writeval, coeff);
+                                    i = maxhead;
+                                    dirty_fill(&dirty, b, pstride, nproc, i, playhead - i, 1, writeval, coeff);                  // maxhead .. (playhead - 1)
                                 } else {
-                                    for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                                    for (i = (recordhead - 1); i > playhead; i--) {
-                                        for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                                    }
+                                    ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                                    dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead - playhead - 1, -1, writeval, coeff);
                                 }
                             }
                         }
                     } else {
                         if (recplaydif > 0)
                         {
-                            for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                            for (i = (recordhead + 1); i < playhead; i++) {
-                                for (ch = 0; ch < nproc; ch++) { writeval[ch] += coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                            }
+                            ipoke_slope(coeff, recin, writeval, nproc, recplaydif, 1);
+                            dirty_fill(&dirty, b, pstride, nproc, recordhead + 1, playhead - recordhead - 1, 1, writeval, coeff);
                         } else {
-                            for (ch = 0; ch < nproc; ch++) coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
-                            for (i = (recordhead - 1); i > playhead; i--) {
-                                for (ch = 0; ch < nproc; ch++) { writeval[ch] -= coeff[ch]; b[i * pchans + ch] = writeval[ch]; }
-                            }
+                            ipoke_slope(coeff, recin, writeval, nproc, recplaydif, -1);
+                            dirty_fill(&dirty, b, pstride, nproc, recordhead - 1, recordhead - playhead - 1, -1, writeval, coeff);
                         }
                     }
                     for (ch = 0; ch < nproc; ch++) writeval[ch] = recin[ch];
@@ -1282,80 +1798,386 @@ apned:
         initialhigh = (dirt) ? maxloop : initialhigh;  // recordhead ??
     }
 
-    if (dirt) {                 // notify other buf-related jobs of write
-        x->bufio.set_dirty(x->bufio.ctx);
+    if (x->voices && (x->voices->chans == pchans) && x->voices->count) {
+        karma_voice_loop lp;
+        lp.b        = b;
+        lp.stride   = pstride;
+        lp.nproc    = nproc;
+        lp.maxloop  = maxloop;
+        lp.fm1      = frames - 1;
+        lp.mul      = mapped ? mul : NULL;
+        lp.len      = (double)(maxloop - minloop);
+        lp.base     = (directionorig >= 0) ? (double)minloop : (double)frames - lp.len;
+        lp.srscale  = srscale;
+        lp.snrstep  = (globalramp && (snrramp > 0)) ? (1.0 / snrramp) : 0.0;
+        lp.snrtype  = snrtype;
+        lp.directionorig = directionorig;
+        karma_voices_mix(x->voices, &lp, !loopdetermine && (lp.len > 0.0), outs, ochans, modout, vcount, f32);
+    }
+    if (mul && (mul->dhi >= mul->dlo)) {   // pages materialized this vector
+        karma_dirty_merge(&dirty, mul->dlo, mul->dhi);
+        dirt = 1;
+    }
+    if ((mip || shadow) && dirty.n) {   // bring the levels / shadow up to date with what was written
+        karma_dirty_finish(&dirty);
+        for (i = 0; i < dirty.n; i++) {
+            if (mip)
+                mip_update(mip, b, pstride, mapped ? mul : NULL, dirty.lo[i], dirty.hi[i]);
+            if (shadow)
+                shadow_update(shadow, b, pstride, mapped ? mul : NULL, dirty.lo[i], dirty.hi[i]);
+        }
+    }
+    if (dirt && !(kept && !dirty.n)) {  // notify other buf-related jobs of write (if anything was)
+        if (x->bufio.set_dirty_range) {
+            karma_dirty_finish(&dirty);
+            for (i = 0; i < dirty.n; i++)
+                x->bufio.set_dirty_range(x->bufio.ctx, (long)dirty.lo[i], (long)(dirty.hi[i] - dirty.lo[i] + 1));
+        } else {
+            x->bufio.set_dirty(x->bufio.ctx);
+        }
     }
     x->bufio.unlock(x->bufio.ctx);
 
     // (report-clock arming lives in the host shell, which owns the real clock;
     // the core's verbatim block here was inert no-op shims and has been removed.)
 
-    x->o1prev = oprev[0]; x->o2prev = oprev[1]; x->o3prev = oprev[2]; x->o4prev = oprev[3];
-    x->o1dif  = odif[0];  x->o2dif  = odif[1];  x->o3dif  = odif[2];  x->o4dif  = odif[3];
-    x->writeval1 = writeval[0]; x->writeval2 = writeval[1]; x->writeval3 = writeval[2]; x->writeval4 = writeval[3];
-
-    x->maxhead          = maxhead;
-    x->pokesteps        = pokesteps;
-    x->wrapflag         = wrapflag;
-    x->snrfade          = snrfade;
-    x->playhead         = accuratehead;
-    x->directionorig    = directionorig;
-    x->directionprev    = directionprev;
-    x->recordhead       = recordhead;
-    x->alternateflag    = alternateflag;
-    x->recordfade       = recordfade;
-    x->triginit         = triginit;
-    x->jumpflag         = jumpflag;
-    x->go               = go;
-    x->record           = record;
-    x->recordprev       = recordprev;
-    x->statecontrol     = statecontrol;
-    x->playfadeflag     = playfadeflag;
-    x->recfadeflag      = recfadeflag;
-    x->playfade         = playfade;
-    x->minloop          = minloop;
-    x->maxloop          = maxloop;
-    x->initiallow       = initiallow;
-    x->initialhigh      = initialhigh;
-    x->loopdetermine    = loopdetermine;
-    x->startloop        = startloop;
-    x->endloop          = endloop;
-    x->overdubprev      = overdubamp;
-    x->recendmark       = recendmark;
-    x->append           = append;
-
+    // carried state must not smuggle subnormals into the next vector
+    for (ch = 0; ch < 4; ch++) {
+        oprev[ch]    = karma_flush(oprev[ch]);
+        odif[ch]     = karma_flush(odif[ch]);
+        writeval[ch] = karma_flush(writeval[ch]);
+    }
+    st->o1prev = oprev[0]; st->o2prev = oprev[1]; st->o3prev = oprev[2]; st->o4prev = oprev[3];
+    st->o1dif  = odif[0];  st->o2dif  = odif[1];  st->o3dif  = odif[2];  st->o4dif  = odif[3];
+    st->writeval1 = writeval[0]; st->writeval2 = writeval[1]; st->writeval3 = writeval[2]; st->writeval4 = writeval[3];
+
+    st->maxhead          = maxhead;
+    st->pokesteps        = pokesteps;
+    st->wrapflag         = wrapflag;
+    st->snrfade          = snrfade;
+    st->playhead         = accuratehead;
+    st->directionorig    = directionorig;
+    st->directionprev    = directionprev;
+    st->recordhead       = recordhead;
+    st->alternateflag    = alternateflag;
+    st->recordfade       = recordfade;
+    st->triginit         = triginit;
+    st->jumpflag         = jumpflag;
+    st->go               = go;
+    st->record           = record;
+    st->recordprev       = recordprev;
+    st->statecontrol     = statecontrol;
+    st->playfadeflag     = playfadeflag;
+    st->recfadeflag      = recfadeflag;
+    st->playfade         = playfade;
+    st->minloop          = minloop;
+    st->maxloop          = maxloop;
+    st->initiallow       = initiallow;
+    st->initialhigh      = initialhigh;
+    st->loopdetermine    = loopdetermine;
+    st->startloop        = startloop;
+    st->endloop          = endloop;
+    st->overdubprev      = overdubamp;
+    st->recendmark       = recendmark;
+    st->append           = append;
+
+    karma_fpu_leave(&fpu);
     return;
 
 zero:
     while (n--) {
         for (ch = 0; ch < ochans; ch++)
-            *out[ch]++ = 0.0;
+            karma_io_write(&out[ch], 0.0, f32);
         if (syncoutlet)
-            *outPh++ = 0.0;
+            karma_io_write(&outPh, 0.0, f32);
     }
 
+    karma_fpu_leave(&fpu);
     return;
 }
 
+// ---- snapshots and buffer switches (served at the vector boundary) ----
+static void karma_core_dims(t_karma *x);
+static void karma_core_reset_loop(t_karma *x);
+
+// other buffer contents under the extensions: as after the initial-record clear
+static void karma_extensions_reset(t_karma *x)
+{
+    if (x->undo)
+        atomic_store_explicit(&x->undo->reset, 1, memory_order_release);
+    if (x->mul)
+        atomic_store_explicit(&x->mul->reset, 1, memory_order_release);
+    if (x->mip)
+        x->mip->reset = 1;
+    if (x->shadow)
+        x->shadow->reset = 1;
+}
+
+static void karma_snap_apply(t_karma *x, karma_snap *r)
+{
+    x->bufio      = r->bufio;
+    karma_core_dims(x);
+    x->st         = r->st;
+    x->speedfloat = r->speedfloat;
+    x->overdubamp = r->overdubamp;
+    x->jumphead   = r->jumphead;
+    x->selstart   = r->selstart;
+    x->selection  = r->selection;
+    x->choffset   = r->choffset;
+    x->chcount    = r->chcount;
+    x->recordinit = r->recordinit;
+    x->stopallowed = r->stopallowed;
+    x->statehuman = r->statehuman;
+    karma_extensions_reset(x);
+}
+
+// Onto w->bufio. A sounding head is kept in w first, as an extra voice on the
+// old loop would see it: the window from selstart / selection, the head in it.
+static void karma_switch_apply(t_karma *x, karma_switch *w)
+{
+    int64_t off, pchans;
+    double rp;
+
+    if (x->fading)              // a crossfade still running is cut short
+        atomic_store_explicit(&x->fading->done, 1, memory_order_release);
+    x->fading = NULL;
+    w->at   = 0;
+    w->tail = (w->fade > 0) && x->bufio.ctx && x->go && !x->loopdetermine && (x->maxloop > x->minloop);
+    if (w->tail) {
+        pchans          = karma_view(x, &off);
+        w->old          = x->bufio;
+        w->offset       = off;
+        w->nproc        = (pchans < x->ochans) ? pchans : x->ochans;
+        w->maxloop      = x->maxloop;
+        w->interp       = (x->interpflag == 3) ? 1 : x->interpflag;
+        w->len          = (double)(x->maxloop - x->minloop);
+        w->base         = (x->directionorig >= 0) ? (double)x->minloop : (double)x->bframes - w->len;
+        w->srscale      = x->srscale;
+        w->directionorig = x->directionorig;
+        w->ws           = ((x->selstart > 0.0) && (x->selstart < 1.0)) ? x->selstart * w->len : 0.0;
+        w->wl           = ((x->selection > 0.0) && (x->selection < 1.0)) ? x->selection * w->len : w->len;
+        if (w->wl < 1.0)
+            w->wl = 1.0;
+        rp              = x->playhead - w->base - w->ws;
+        rp             -= w->len * floor(rp / w->len);
+        if (rp >= w->wl)
+            rp         -= w->wl * floor(rp / w->wl);
+        w->head         = (rp < w->wl) ? rp : 0.0;
+        w->snrfade      = 1.0;
+        memset(w->oprev, 0, sizeof(w->oprev));
+        memset(w->odif, 0, sizeof(w->odif));
+    }
+    if (w->exts) {              // the host's extensions for the new buffer in, the old ones to w
+        struct karma_undo *u = x->undo;
+        struct karma_multiply *m = x->mul;
+        struct karma_mipmap *p = x->mip;
+        struct karma_shadow *r = x->shadow;
+        struct karma_prerec *q = x->prerec;
+        x->undo   = w->undo;   w->undo   = u;
+        x->mul    = w->mul;    w->mul    = m;
+        x->mip    = w->mip;    w->mip    = p;
+        x->shadow = w->shadow; w->shadow = r;
+        x->prerec = w->prerec; w->prerec = q;
+    }
+    w->made  = 1;
+    x->bufio = w->bufio;
+    karma_core_reset_loop(x);
+    karma_extensions_reset(x);
+    if (w->fade > 0)
+        x->fading = w;
+    else
+        atomic_store_explicit(&w->done, 1, memory_order_release);
+}
+
+// A switch's crossfade over this vector's first m samples: perform's output on
+// the new buffer rises and the old head's falls, added in as the extra voices'
+// mix is (voice_render, one voice, no multiply mapping).
+static void karma_switch_fade(t_karma *x, karma_switch *w, void **outs, long n, const int f32)
+{
+    double mix[4][KARMA_VOICES_BLOCK], dg = 1.0 / (double)w->fade;
+    long ochans = (long)x->ochans, m = n, at, len, i, ch;
+    t_bool modout = (x->moduloout != 0);
+    const float *b;
+    karma_voice v;
+    karma_voice_loop lp;
+    int64_t c;
+
+    if (m > w->fade - w->at)
+        m = (long)(w->fade - w->at);
+    for (ch = 0; ch < ochans; ch++)
+        for (i = 0; i < m; i++)
+            karma_io_set(outs[ch], i, karma_io_get(outs[ch], i, f32) * ((double)(w->at + i) * dg), f32);
+    b = w->tail ? (const float *)w->old.lock(w->old.ctx) : NULL;
+    if (b) {
+        if (w->at == 0) {       // the carried playhead was the last sample played: step past it
+            w->head += w->speed * w->srscale;
+            if ((w->head >= w->wl) || (w->head < 0.0))
+                w->head -= w->wl * floor(w->head / w->wl);
+            if (w->head >= w->wl)
+                w->head = 0.0;
+        }
+        memset(&v, 0, sizeof(v));
+        v.speed     = w->speed;
+        v.interp    = w->interp;
+        v.head      = w->head;
+        v.ws        = w->ws;
+        v.wl        = w->wl;
+        v.snrfade   = w->snrfade;
+        v.on        = 1;
+        memcpy(v.oprev, w->oprev, sizeof(v.oprev));
+        memcpy(v.odif, w->odif, sizeof(v.odif));
+        lp.b        = b + w->offset;
+        lp.stride   = w->old.chans;
+        lp.nproc    = w->nproc;
+        lp.maxloop  = w->maxloop;
+        lp.fm1      = w->old.frames - 1;
+        lp.mul      = NULL;
+        lp.base     = w->base;
+        lp.len      = w->len;
+        lp.srscale  = w->srscale;
+        lp.snrstep  = (x->globalramp && (x->snrramp > 0)) ? (1.0 / x->snrramp) : 0.0;
+        lp.snrtype  = x->snrtype;
+        lp.directionorig = w->directionorig;
+        for (at = 0; at < m; at += len) {
+            len = (m - at < KARMA_VOICES_BLOCK) ? (m - at) : KARMA_VOICES_BLOCK;
+            for (c = 0; c < lp.nproc; c++)
+                memset(mix[c], 0, (size_t)len * sizeof(double));
+            voice_render(&v, &lp, mix, len, 1.0 - (double)(w->at + at) * dg, -dg);
+            for (ch = 0; ch < ochans; ch++) {
+                if ((ch >= lp.nproc) && !modout)
+                    continue;
+                c = ch % lp.nproc;
+                for (i = 0; i < len; i++)
+                    karma_io_set(outs[ch], at + i, karma_io_get(outs[ch], at + i, f32) + mix[c][i], f32);
+            }
+        }
+        w->old.unlock(w->old.ctx);
+        w->head     = v.head;
+        w->snrfade  = v.snrfade;
+        for (c = 0; c < 4; c++) {
+            w->oprev[c] = karma_flush(v.oprev[c]);
+            w->odif[c]  = karma_flush(v.odif[c]);
+        }
+    }
+    w->at += m;
+    if (w->at >= w->fade) {
+        x->fading = NULL;
+        atomic_store_explicit(&w->done, 1, memory_order_release);
+    }
+}
+
+static inline void karma_vector_begin(t_karma *x, void **ins, const int f32)
+{
+    karma_snap *r = atomic_load_explicit(&x->recall, memory_order_relaxed);    // no RMW on quiet vectors
+    karma_switch *w = atomic_load_explicit(&x->swreq, memory_order_relaxed);
+
+    if (r && (r = atomic_exchange_explicit(&x->recall, NULL, memory_order_acq_rel))) {
+        karma_snap_apply(x, r);
+        atomic_store_explicit(&r->done, 1, memory_order_release);
+    }
+    if (w && (w = atomic_exchange_explicit(&x->swreq, NULL, memory_order_acq_rel)))
+        karma_switch_apply(x, w);
+    if (x->fading)              // (the speed inlet may be an output's vector)
+        x->fading->speed = x->speedconnect ? karma_io_get(ins[x->ochans], 0, f32) : x->speedfloat;
+}
+
+static inline void karma_vector_end(t_karma *x, void **outs, long n, const int f32)
+{
+    karma_snap *r = atomic_load_explicit(&x->snapreq, memory_order_relaxed);
+
+    if (x->fading)
+        karma_switch_fade(x, x->fading, outs, n, f32);
+    if (r && (r = atomic_exchange_explicit(&x->snapreq, NULL, memory_order_acq_rel))) {
+        karma_core_snap_now(x, r);
+        atomic_store_explicit(&r->done, 1, memory_order_release);
+    }
+}
+
+// post r in slot q; a request still pending there is done unserved, and returned
+static karma_snap *karma_snap_post(_Atomic(karma_snap *) *q, karma_snap *r)
+{
+    karma_snap *old;
+
+    atomic_store_explicit(&r->done, 0, memory_order_relaxed);
+    old = atomic_exchange_explicit(q, r, memory_order_acq_rel);
+    if (!old || (old == r))
+        return NULL;
+    atomic_store_explicit(&old->done, 1, memory_order_release);
+    return old;
+}
+
+karma_snap *karma_core_snap(t_karma *x, karma_snap *r)
+{
+    return karma_snap_post(&x->snapreq, r);
+}
+
+void karma_core_snap_now(const t_karma *x, karma_snap *r)
+{
+    r->bufio      = x->bufio;
+    r->st         = x->st;
+    r->speedfloat = x->speedfloat;
+    r->overdubamp = x->overdubamp;
+    r->jumphead   = x->jumphead;
+    r->selstart   = x->selstart;
+    r->selection  = x->selection;
+    r->choffset   = x->choffset;
+    r->chcount    = x->chcount;
+    r->recordinit = x->recordinit;
+    r->stopallowed = x->stopallowed;
+    r->statehuman = x->statehuman;
+}
+
+karma_snap *karma_core_recall(t_karma *x, karma_snap *r)
+{
+    return karma_snap_post(&x->recall, r);
+}
+
+karma_switch *karma_core_switch(t_karma *x, karma_switch *w)
+{
+    karma_switch *old;
+
+    w->made = 0;
+    atomic_store_explicit(&w->done, 0, memory_order_relaxed);
+    old = atomic_exchange_explicit(&x->swreq, w, memory_order_acq_rel);
+    if (!old || (old == w))
+        return NULL;
+    atomic_store_explicit(&old->done, 1, memory_order_release);    // never made
+    return old;
+}
+
+static void karma_perform64(t_karma *x, double **ins, double **outs, long vcount)
+{
+    karma_vector_begin(x, (void **)ins, 0);
+    karma_perform(x, (void **)ins, (void **)outs, vcount, 0);
+    karma_vector_end(x, (void **)outs, vcount, 0);
+}
+
+void karma_perform32(t_karma *x, float **ins, float **outs, long vcount)
+{
+    karma_vector_begin(x, (void **)ins, 1);
+    karma_perform(x, (void **)ins, (void **)outs, vcount, 1);
+    karma_vector_end(x, (void **)outs, vcount, 1);
+}
+
 // Public entry points -- thin forwarders to the channel-generic routine above.
 // (dsp64 / nins / nouts / flgs / usr are vestigial Max perform-signature params;
 // the channel count comes from x->ochans.)
 void karma_mono_perform(t_karma *x, t_object *dsp64, double **ins, long nins, double **outs, long nouts, long vcount, long flgs, void *usr)
 {
     (void)dsp64; (void)nins; (void)nouts; (void)flgs; (void)usr;
-    karma_perform(x, ins, outs, vcount);
+    karma_perform64(x, ins, outs, vcount);
 }
 
 void karma_stereo_perform(t_karma *x, t_object *dsp64, double **ins, long nins, double **outs, long nouts, long vcount, long flgs, void *usr)
 {
     (void)dsp64; (void)nins; (void)nouts; (void)flgs; (void)usr;
-    karma_perform(x, ins, outs, vcount);
+    karma_perform64(x, ins, outs, vcount);
 }
 
 void karma_quad_perform(t_karma *x, t_object *dsp64, double **ins, long nins, double **outs, long nouts, long vcount, long flgs, void *usr)
 {
     (void)dsp64; (void)nins; (void)nouts; (void)flgs; (void)usr;
-    karma_perform(x, ins, outs, vcount);
+    karma_perform64(x, ins, outs, vcount);
 }
 
 // ---- init / configure (mirrors karma_new defaults + karma_buf_setup) ----
@@ -1367,18 +2189,309 @@ void karma_core_init(t_karma *x, long ochans, double ssr, double vs)
     x->playfade = x->recordfade = 257;
     x->ssr = ssr; x->vs = vs; x->vsnorm = (ssr > 0) ? (vs / ssr) : 0.0;
     x->overdubprev = x->overdubamp = x->speedfloat = 1.0;
-    x->snrtype = x->interpflag = 1;
+    x->islooped = x->snrtype = x->interpflag = 1;
+    x->sinctaps = 16;
     x->initiallow = x->initialhigh = -1;
     x->ochans = (ochans <= 1) ? 1 : ((ochans == 2) ? 2 : 4);
     x->initskip = 1;
+    karma_sinc_init();
 }
 
-void karma_core_set_dims(t_karma *x)
+karma_undo_state *karma_undo_new(long frames, long chans, long pool_pages)
+{
+    karma_undo_state *u;
+
+    if ((frames <= 0) || (chans <= 0) || (pool_pages <= 0))
+        return NULL;
+    u = (karma_undo_state *)calloc(1, sizeof(karma_undo_state));
+    if (!u)
+        return NULL;
+    u->frames   = frames;
+    u->chans    = chans;
+    u->npages   = (frames + KARMA_UNDO_PAGE - 1) >> KARMA_UNDO_SHIFT;
+    u->npool    = pool_pages;
+    u->epoch    = 1;            // stamps start at 0: nothing saved yet
+    u->pool     = (float *)malloc((size_t)(pool_pages * KARMA_UNDO_PAGE * chans) * sizeof(float));
+    u->slotpage = (int64_t *)malloc((size_t)pool_pages * sizeof(int64_t));
+    u->stamp    = (int64_t *)calloc((size_t)u->npages, sizeof(int64_t));
+    if (!u->pool || !u->slotpage || !u->stamp) {
+        karma_undo_free(u);
+        return NULL;
+    }
+    return u;
+}
+
+void karma_undo_free(karma_undo_state *u)
+{
+    if (!u)
+        return;
+    free(u->pool);
+    free(u->slotpage);
+    free(u->stamp);
+    free(u);
+}
+
+void karma_undo(t_karma *x)
+{
+    if (x->undo)
+        atomic_store_explicit(&x->undo->request, UNDO_REQ_UNDO, memory_order_release);
+}
+
+void karma_redo(t_karma *x)
+{
+    if (x->undo)
+        atomic_store_explicit(&x->undo->request, UNDO_REQ_REDO, memory_order_release);
+}
+
+karma_multiply_state *karma_multiply_new(long frames, long chans)
+{
+    karma_multiply_state *m;
+
+    if ((frames <= 0) || (chans <= 0))
+        return NULL;
+    m = (karma_multiply_state *)calloc(1, sizeof(karma_multiply_state));
+    if (!m)
+        return NULL;
+    m->frames = frames;
+    m->chans  = chans;
+    m->npages = (frames + (1 << KARMA_MULTIPLY_SHIFT) - 1) >> KARMA_MULTIPLY_SHIFT;
+    m->real   = (uint32_t *)calloc((size_t)((m->npages + 31) >> 5), sizeof(uint32_t));
+    if (!m->real) {
+        karma_multiply_free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void karma_multiply_free(karma_multiply_state *m)
+{
+    if (!m)
+        return;
+    free(m->real);
+    free(m);
+}
+
+karma_mipmap_state *karma_mipmap_new(long frames, long chans)
+{
+    karma_mipmap_state *m;
+    int L;
+
+    if ((frames <= 0) || (chans <= 0))
+        return NULL;
+    m = (karma_mipmap_state *)calloc(1, sizeof(karma_mipmap_state));
+    if (!m)
+        return NULL;
+    m->frames = m->len[0] = frames;
+    m->chans  = chans;
+    for (L = 1; L <= KARMA_MIPMAP_LEVELS; L++) {
+        m->len[L]   = ((frames - 1) >> L) + 1;
+        m->level[L] = (float *)calloc((size_t)(m->len[L] * chans), sizeof(float));
+        if (!m->level[L]) {
+            karma_mipmap_free(m);
+            return NULL;
+        }
+    }
+    m->slo = 0;                 // filled in the background once attached
+    m->shi = frames - 1;
+    return m;
+}
+
+void karma_mipmap_free(karma_mipmap_state *m)
+{
+    int L;
+
+    if (!m)
+        return;
+    for (L = 1; L <= KARMA_MIPMAP_LEVELS; L++)
+        free(m->level[L]);
+    free(m);
+}
+
+karma_shadow_state *karma_shadow_new(long frames, long chans, double srscale)
+{
+    karma_shadow_state *r;
+
+    if ((frames <= 0) || (chans <= 0) || !(srscale > 0.0))
+        return NULL;
+    r = (karma_shadow_state *)calloc(1, sizeof(karma_shadow_state));
+    if (!r)
+        return NULL;
+    r->frames  = frames;
+    r->chans   = chans;
+    r->srscale = srscale;
+    r->inv     = 1.0 / srscale;
+    r->len     = (int64_t)((double)(frames - 1) * r->inv) + 1;
+    r->s       = (float *)calloc((size_t)(r->len * chans), sizeof(float));
+    if (!r->s) {
+        karma_shadow_free(r);
+        return NULL;
+    }
+    r->reset   = 1;             // built in the background once attached
+    return r;
+}
+
+void karma_shadow_free(karma_shadow_state *r)
+{
+    if (!r)
+        return;
+    free(r->s);
+    free(r);
+}
+
+karma_voices_state *karma_voices_new(long count, long chans)
+{
+    karma_voices_state *vs;
+    long k;
+
+    if ((count <= 0) || (chans <= 0))
+        return NULL;
+    vs = (karma_voices_state *)calloc(1, sizeof(karma_voices_state));
+    if (!vs)
+        return NULL;
+    vs->v = (karma_voice *)calloc((size_t)count, sizeof(karma_voice));
+    if (!vs->v) {
+        karma_voices_free(vs);
+        return NULL;
+    }
+    vs->count = count;
+    vs->chans = chans;
+    for (k = 0; k < count; k++) {
+        vs->v[k].speed   = 1.0;
+        vs->v[k].size    = 1.0;
+        vs->v[k].gain    = vs->v[k].gprev = vs->v[k].gnext = 1.0;
+        atomic_init(&vs->v[k].jump, -1.0);
+        vs->v[k].interp  = 1;
+        vs->v[k].snrfade = 1.0;
+    }
+    return vs;
+}
+
+void karma_voices_free(karma_voices_state *vs)
+{
+    if (!vs)
+        return;
+    free(vs->v);
+    free(vs);
+}
+
+karma_prerec_state *karma_prerec_new(double seconds, double sr, long chans)
+{
+    karma_prerec_state *q;
+    int64_t len = (int64_t)ceil(seconds * sr);
+
+    if ((len <= 0) || (chans <= 0))
+        return NULL;
+    q = (karma_prerec_state *)calloc(1, sizeof(karma_prerec_state));
+    if (!q)
+        return NULL;
+    q->r = (float *)calloc((size_t)(len * chans), sizeof(float));
+    if (!q->r) {
+        karma_prerec_free(q);
+        return NULL;
+    }
+    q->len = len;
+    q->chans = chans;
+    return q;
+}
+
+void karma_prerec_free(karma_prerec_state *q)
+{
+    if (!q)
+        return;
+    free(q->r);
+    free(q);
+}
+
+void karma_capture(t_karma *x, double seconds)
+{
+    if (!x->prerec)
+        object_error((t_object *)x, "capture needs a pre-record ring (karma_prerec_new)");
+    else if (seconds <= 0.0)
+        object_error((t_object *)x, "capture needs a length in seconds");
+    else
+        atomic_store_explicit(&x->prerec->request, seconds, memory_order_release);
+}
+
+static karma_voice *karma_voice_at(t_karma *x, long voice)
+{
+    if (!x->voices) {
+        object_error((t_object *)x, "voices need a voices state (karma_voices_new)");
+        return NULL;
+    }
+    if ((voice < 0) || (voice >= x->voices->count)) {
+        object_error((t_object *)x, "no voice %ld", voice);
+        return NULL;
+    }
+    return &x->voices->v[voice];
+}
+
+void karma_voice_play(t_karma *x, long voice)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        v->play = 1;
+}
+
+void karma_voice_stop(t_karma *x, long voice)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        v->play = 0;
+}
+
+void karma_voice_speed(t_karma *x, long voice, double speed)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        v->speed = speed;
+}
+
+void karma_voice_window(t_karma *x, long voice, double start, double size)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v) {
+        v->start = CLAMP(start, 0., 1.);
+        v->size  = CLAMP(size, 0., 1.);
+    }
+}
+
+void karma_voice_jump(t_karma *x, long voice, double position)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        atomic_store_explicit(&v->jump, CLAMP(position, 0., 1.), memory_order_release);
+}
+
+void karma_voice_interp(t_karma *x, long voice, long mode)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        v->interp = CLAMP(mode, 0, 2);
+}
+
+void karma_voice_gain(t_karma *x, long voice, double gain)
+{
+    karma_voice *v = karma_voice_at(x, voice);
+    if (v)
+        v->gain = gain;
+}
+
+void karma_multiply(t_karma *x, long factor)
+{
+    if (!x->mul) {
+        object_error((t_object *)x, "multiply needs a multiply state (karma_multiply_new)");
+    } else if (factor < 2) {
+        object_error((t_object *)x, "multiply factor must be 2 or more");
+    } else if (!x->recordinit || x->loopdetermine || (x->directionorig < 0)) {
+        object_error((t_object *)x, "can't multiply before a forward loop has been recorded, or during 'initial-loop'");
+    } else {
+        atomic_store_explicit(&x->mul->request, factor, memory_order_release);
+    }
+}
+
+// the buffer's dimensions and what follows from them (set_dims and a recall)
+static void karma_core_dims(t_karma *x)
 {
-    if (!x->bufio.ctx) return;
-    x->directionorig = 0;
-    x->maxhead = x->playhead = 0.0;
-    x->recordhead = -1;
     x->bchans  = x->bufio.chans;
     x->bframes = x->bufio.frames;
     x->bmsr    = x->bufio.sr * 0.001;
@@ -1386,12 +2499,66 @@ void karma_core_set_dims(t_karma *x)
     x->nchans  = (x->bchans < x->ochans) ? x->bchans : x->ochans;
     x->srscale = x->bsr / x->ssr;
     x->bvsnorm = x->vsnorm * (x->bsr / (double)x->bframes);
+}
+
+// the loop on x->bufio from scratch: set_dims and a switch
+static void karma_core_reset_loop(t_karma *x)
+{
+    x->directionorig = 0;
+    x->maxhead = x->playhead = 0.0;
+    x->recordhead = -1;
+    karma_core_dims(x);
     x->minloop = x->startloop = 0.0;
     x->maxloop = x->endloop   = (x->bframes - 1);
     x->selstart  = 0.0;
     x->selection = 1.0;
 }
 
+void karma_core_set_dims(t_karma *x)
+{
+    karma_switch *w;
+
+    if (!x->bufio.ctx) return;
+    w = atomic_exchange_explicit(&x->swreq, NULL, memory_order_acq_rel);
+    if (w)                      // superseded: this buffer from now on
+        atomic_store_explicit(&w->done, 1, memory_order_release);
+    if (x->fading)
+        atomic_store_explicit(&x->fading->done, 1, memory_order_release);
+    x->fading = NULL;
+    karma_core_reset_loop(x);
+}
+
+void karma_core_set_channels(t_karma *x, long offset, long count)
+{
+    if ((offset == x->choffset) && (count == x->chcount))
+        return;
+    x->choffset = (offset < 0) ? 0 : offset;
+    x->chcount  = (count < 0) ? 0 : count;
+    // saved pages / materialized extension belong to the old view's channels
+    if (x->undo)
+        atomic_store_explicit(&x->undo->reset, 1, memory_order_release);
+    if (x->mul)
+        atomic_store_explicit(&x->mul->reset, 1, memory_order_release);
+    if (x->mip)
+        x->mip->reset = 1;
+    if (x->shadow)
+        x->shadow->reset = 1;
+}
+
+long karma_core_view_chans(const t_karma *x)
+{
+    int64_t off;
+
+    return (x->bchans > 0) ? (long)karma_view(x, &off) : 0;
+}
+
+long karma_core_switch_chans(const t_karma *x, const karma_switch *w)
+{
+    int64_t off;
+
+    return (w->bufio.chans > 0) ? (long)karma_view_of(x, w->bufio.chans, &off) : 0;
+}
+
 // Set loop start/end (the pure part of the reference karma_buf_values_internal:
 // no buffer~ query, no UI warnings). points_flag: 0 = phase 0..1, 1 = samples,
 // 2 = milliseconds. low/high < 0 mean "unset" -> defaults (0 / full). The host
@@ -13,6 +13,7 @@
 #define KARMA_CORE_H
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 // --- scalar types the copied code expects (Max-free equivalents) -----------
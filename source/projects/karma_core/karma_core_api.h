@@ -19,48 +19,151 @@
 #define KARMA_CORE_API_H
 
 #include <stdint.h>     // int64_t
+#include <stdatomic.h>  // the requests handed to perform at a vector boundary
 
 // --- host buffer interface -------------------------------------------------
 // The core never allocates or names the sample buffer; the host supplies it
 // (a Max buffer~, a malloc'd array, etc.) through these callbacks.
+//
+// set_dirty_range is optional (NULL after karma_core_init). When set, the core
+// reports each vector's writes as up to 4 disjoint frame ranges (start, count),
+// called in ascending order before unlock, instead of calling set_dirty. Ranges
+// cover every written frame and may include a few untouched ones in between.
 typedef struct {
     void  *(*lock)(void *ctx);    // -> float* interleaved samples (or NULL)
     void   (*unlock)(void *ctx);
     void   (*set_dirty)(void *ctx);
+    void   (*set_dirty_range)(void *ctx, long start, long count);
     void   *ctx;
     long    frames;               // frames per channel
     long    chans;                // channels
     double  sr;                   // sample rate
 } karma_buffer_iface;
 
+struct karma_undo;              // copy-on-write layer history (karma_undo.h)
+struct karma_multiply;          // virtual loop-multiply extension (karma_multiply.h)
+struct karma_mipmap;            // decimated copies for high-speed playback (karma_mipmap.h)
+struct karma_shadow;            // the loop resampled to the system rate (karma_shadow.h)
+struct karma_voices;            // extra read-only playheads (karma_voices.h)
+struct karma_prerec;            // rolling pre-record ring (karma_prerec.h)
+
+// --- perform state ---------------------------------------------------------
+// Everything karma_perform carries from one vector to the next -- exactly the
+// fields it stores back. It loads them as one block at the top of a vector and
+// stores them as one at the end. The block leads t_karma and is padded to a
+// multiple of 64 bytes. That is a size, not an alignment: t_karma is wherever
+// the host puts it (inside a Max object after its t_pxobject, in a Python or
+// CLAP instance), so the block may straddle one more line than its size says.
+// Only a host that allocates t_karma 64-aligned, as bench_core does, gets the
+// per-vector state on whole lines of its own. The fields are reached by name
+// as before (x->playhead), the block as a whole as x->st.
+#define KARMA_STATE_FIELDS \
+    double  o1prev, o2prev, o3prev, o4prev; \
+    double  o1dif, o2dif, o3dif, o4dif; \
+    double  writeval1, writeval2, writeval3, writeval4; \
+    double  playhead, maxhead, snrfade, overdubprev; \
+    int64_t recordhead, minloop, maxloop, startloop, endloop; \
+    int64_t pokesteps, recordfade, playfade, initiallow, initialhigh; \
+    char    statecontrol, playfadeflag, recfadeflag, recendmark, directionorig, directionprev; \
+    t_bool  go, record, recordprev, loopdetermine, alternateflag; \
+    t_bool  append, triginit, wrapflag, jumpflag;
+
+typedef struct karma_state {
+    KARMA_STATE_FIELDS
+} karma_state;
+
+// --- snapshot of an instance ------------------------------------------------
+// What karma_core_snap takes and karma_core_recall restores: the perform state
+// block plus the control fields that place the loop (speed, overdub, window),
+// and -- for a recall -- the buffer to run on from then on. Attributes (@interp,
+// @ramp, ...) are the host's and are left alone. done is set (release) once
+// the request is served or displaced; read it with an acquire load.
+typedef struct karma_snap {
+    karma_buffer_iface bufio;       // recall: the buffer from the swap on
+    karma_state st;
+    double  speedfloat, overdubamp, jumphead, selstart, selection;
+    int64_t choffset, chcount;
+    t_bool  recordinit, stopallowed;
+    char    statehuman;
+    atomic_bool done;
+} karma_snap;
+
+// --- buffer switch ------------------------------------------------------------
+// A buffer for karma_core_switch to move an instance onto, host-owned. The
+// host fills the fields up to prerec; the rest is the outgoing buffer's head,
+// carried by perform through the crossfade. done is set by the audio thread
+// (release) once the old buffer is no longer read; read it with an acquire load.
+// With exts set, the switch exchanges the five extensions: the instance runs
+// on w's from then on, and w holds the ones it had.
+typedef struct karma_switch {
+    karma_buffer_iface bufio;       // the buffer to switch to
+    long    fade;                   // crossfade from the old buffer, in samples (0: a cut)
+    t_bool  exts;                   // hand over the extensions below (0: keep the instance's)
+    struct karma_undo     *undo;    // sized for bufio and karma_core_switch_chans (NULL: none)
+    struct karma_multiply *mul;
+    struct karma_mipmap   *mip;
+    struct karma_shadow   *shadow;
+    struct karma_prerec   *prerec;
+    atomic_bool done;
+    t_bool  made;                   // with done: the switch was made (0: dropped by set_dims)
+    // carried by perform
+    karma_buffer_iface old;
+    int64_t at;                     // samples of the fade done
+    int64_t offset, nproc, maxloop, interp;
+    double  base, len, srscale;     // the old loop, as the extra voices see theirs
+    double  head, ws, wl, snrfade;  // the old head, in its window
+    double  oprev[4], odif[4];
+    double  speed;                  // this vector's (read before perform writes)
+    char    directionorig;
+    t_bool  tail;                   // the old head was sounding: fade it out
+} karma_switch;
+
 // --- core state ------------------------------------------------------------
 // Same fields as the reference t_karma, minus its Max-object members
-// (k_ob / buf / bufname / messout / tclock), plus the buffer interface.
+// (k_ob / buf / bufname / messout / tclock), plus the buffer interface and the
+// optional undo history, multiply state, mip-map pyramid, resampled shadow,
+// extra voices and pre-record ring.
+// Ordered by use: the perform state, then what perform only reads (buffer
+// interface, attributes, control inputs), then configuration and control-only
+// fields it never touches.
 typedef struct karma_core {
+    union {
+        karma_state st;                             // the block (load / store)
+        struct { KARMA_STATE_FIELDS };              // its fields by name
+        char    st_lines[(sizeof(karma_state) + 63) & ~(size_t)63];
+    };
+
+    // read by perform every vector
     karma_buffer_iface bufio;
+    struct karma_undo *undo;      // host-owned (karma_undo_new), NULL = no undo
+    struct karma_multiply *mul;   // host-owned (karma_multiply_new), NULL = no multiply
+    struct karma_mipmap *mip;     // host-owned (karma_mipmap_new), NULL = always read the buffer
+    struct karma_shadow *shadow;  // host-owned (karma_shadow_new), NULL = always read the buffer
+    struct karma_voices *voices;  // host-owned (karma_voices_new), NULL = the primary head only
+    struct karma_prerec *prerec;  // host-owned (karma_prerec_new), NULL = no capture
+    _Atomic(karma_snap *) snapreq;// pending karma_core_snap (filled at the end of a vector)
+    _Atomic(karma_snap *) recall; // pending karma_core_recall (swapped in at the start of one)
+    _Atomic(karma_switch *) swreq;// pending karma_core_switch (served at the start of a vector)
+    karma_switch *fading;         // the switch whose crossfade is running, NULL = none
 
-    double  ssr, bsr, bmsr, srscale, vs, vsnorm, bvsnorm;
-    double  o1prev, o2prev, o3prev, o4prev;
-    double  o1dif, o2dif, o3dif, o4dif;
-    double  writeval1, writeval2, writeval3, writeval4;
-    double  playhead, maxhead, jumphead, selstart, selection;
-    double  snrfade, overdubamp, overdubprev, speedfloat;
+    double  srscale, speedfloat, overdubamp, jumphead, selstart, selection;
 
-    long    syncoutlet;
-
-    int64_t bframes, bchans, ochans, nchans;
-    int64_t interpflag, recordhead, minloop, maxloop, startloop, endloop;
-    int64_t pokesteps, recordfade, playfade, globalramp, snrramp, snrtype;
-    int64_t initiallow, initialhigh;
+    int64_t bframes, bchans, ochans;
+    int64_t choffset, chcount;  // channel view (karma_core_set_channels), 0/0 = whole buffer
+    int64_t interpflag, globalramp, snrramp, snrtype;
+    int64_t sinctaps;           // @sinctaps: kernel length for @interp 3 (8, 16 or 32)
+    int64_t islooped;           // @loop: 1 (default) loops, 0 plays the window once
+    int64_t moduloout;          // @modout: 1 = output c plays buffer channel c % chans
 
+    long    syncoutlet;
     short   speedconnect;
+    t_bool  buf_modified;
 
-    char    statecontrol, statehuman;
-    char    playfadeflag, recfadeflag, recendmark, directionorig, directionprev;
-
-    t_bool  stopallowed, go, record, recordprev, loopdetermine, alternateflag;
-    t_bool  append, triginit, wrapflag, jumpflag;
-    t_bool  recordinit, initinit, initskip, buf_modified;
+    // configuration / control only
+    double  ssr, bsr, bmsr, vs, vsnorm, bvsnorm;
+    int64_t nchans;
+    char    statehuman;
+    t_bool  stopallowed, recordinit, initinit, initskip;
 } t_karma;
 
 // --- lifecycle / configuration ---------------------------------------------
@@ -70,6 +173,16 @@ void karma_core_set_dims(t_karma *x);   // mirrors karma_buf_setup, reads x->buf
 // mean "unset" -> defaults (0 / full buffer). (resetloop = call with the stored
 // initiallow/initialhigh in samples.)
 void karma_core_set_loop(t_karma *x, double low, double high, long points_flag);
+// Confine the instance to channels [offset, offset + count) of the buffer, so
+// several instances can share one wide buffer, each on its own channels. count
+// 0 = the rest of the buffer; both are clamped to the buffer's channel count
+// every vector. Reads, record/overdub, fades, the initial-record clear, undo
+// and multiply all stay inside the view. Changing it drops undo history and
+// any multiply extension, and rebuilds the mip-map and shadow.
+// karma_core_view_chans = the view's current width (what karma_undo_new /
+// karma_multiply_new / karma_mipmap_new / karma_shadow_new should be sized for).
+void karma_core_set_channels(t_karma *x, long offset, long count);
+long karma_core_view_chans(const t_karma *x);
 
 // --- control (names mirror the reference messages) -------------------------
 void karma_float(t_karma *x, double speedfloat);
@@ -82,7 +195,121 @@ void karma_jump(t_karma *x, double jumpposition);
 void karma_select_start(t_karma *x, double positionstart);
 void karma_select_size(t_karma *x, double duration);
 
+// --- undo / redo (copy-on-write overdub layers) ----------------------------
+// Optional: the host allocates a history for the buffer's frames and the view's
+// channels, with a pool of pool_pages pages of 1024 frames (all those channels),
+// and assigns it to x->undo; it is ignored while those differ. undo / redo
+// take effect at the start of the next perform vector. NULL on allocation failure.
+struct karma_undo *karma_undo_new(long frames, long chans, long pool_pages);
+void karma_undo_free(struct karma_undo *u);
+void karma_undo(t_karma *x);
+void karma_redo(t_karma *x);
+
+// --- loop multiply (virtual extension, materialized on write) ---------------
+// Optional: the host allocates a multiply state for the buffer's frames and the
+// view's channels and assigns it to x->mul (ignored while they differ). multiply
+// makes the recorded forward loop factor times as long -- clamped to what fits
+// in the buffer -- at the start of the next perform vector, without copying:
+// the repetitions read the original until they are written or the background
+// fill reaches them. NULL on allocation failure.
+struct karma_multiply *karma_multiply_new(long frames, long chans);
+void karma_multiply_free(struct karma_multiply *m);
+void karma_multiply(t_karma *x, long factor);
+
+// --- mip-map pyramid (decimated reads at high speed) -------------------------
+// Optional: the host allocates a pyramid for the buffer's frames and the view's
+// channels and assigns it to x->mip (ignored while they differ). Playback at
+// |speed| >= 2 (linear / cubic / spline, not while recording) then reads the
+// 2x / 4x / 8x low-passed level that matches the speed. The levels follow every
+// write incrementally; a new pyramid is filled in the background over its first
+// vectors. NULL on allocation failure.
+struct karma_mipmap *karma_mipmap_new(long frames, long chans);
+void karma_mipmap_free(struct karma_mipmap *m);
+
+// --- resampled shadow (buffer rate != system rate) ----------------------------
+// Optional: when the buffer's sample rate differs from the system's, the host
+// can allocate a shadow for the buffer's frames, the view's channels and the
+// instance's srscale (bsr / ssr, after karma_core_set_dims) and assign it to
+// x->shadow (ignored while any of those differ). Forward playback from the
+// window start at whole speeds then reads precomputed samples instead of
+// interpolating (linear / cubic / spline; equal to float precision). It is
+// built in the background and follows every write. NULL on allocation failure.
+struct karma_shadow *karma_shadow_new(long frames, long chans, double srscale);
+void karma_shadow_free(struct karma_shadow *r);
+
+// --- extra voices (read-only playheads on the loop) --------------------------
+// Optional: the host allocates count voices for the view's channels and assigns
+// them to x->voices (ignored while the channels differ). Each voice reads the
+// loop the primary head records, with its own speed, window, interpolation,
+// gain and declick, and is added into the instance's outputs. A voice plays
+// only once started, and is silent while no loop exists (during the initial
+// record). Defaults: speed 1, the whole loop, cubic, gain 1. start / size /
+// position are fractions of the loop (position: of the voice's window); mode
+// is 0 linear, 1 cubic or 2 spline. Each control takes effect at the next
+// vector. NULL on allocation failure.
+struct karma_voices *karma_voices_new(long count, long chans);
+void karma_voices_free(struct karma_voices *v);
+void karma_voice_play(t_karma *x, long voice);
+void karma_voice_stop(t_karma *x, long voice);
+void karma_voice_speed(t_karma *x, long voice, double speed);
+void karma_voice_window(t_karma *x, long voice, double start, double size);
+void karma_voice_jump(t_karma *x, long voice, double position);
+void karma_voice_interp(t_karma *x, long voice, long mode);
+void karma_voice_gain(t_karma *x, long voice, double gain);
+
+// --- pre-record ring (capture what was just played) ----------------------------
+// Optional: the host allocates a ring of seconds at the system rate sr for the
+// view's channels and assigns it to x->prerec (ignored while they differ). The
+// instance then writes its input into it every vector, stopped or not.
+// capture makes the last seconds of it (as much as the ring holds) the loop at
+// the start of the next vector: copied to the start of the buffer, closed as
+// an initial record of that length would be, and played. NULL on allocation
+// failure.
+struct karma_prerec *karma_prerec_new(double seconds, double sr, long chans);
+void karma_prerec_free(struct karma_prerec *q);
+void karma_capture(t_karma *x, double seconds);
+
+// --- snapshots (state swapped at a vector boundary) --------------------------
+// karma_core_snap asks for the instance's state as of the end of its next
+// vector; karma_core_recall hands it one (r->bufio included) to run from at the
+// start of its next vector, in one step: the host never sees half of either.
+// Both return at once; r must stay valid until r->done, and a recalled r's
+// buffer for as long as the instance runs on it. One request of each kind is
+// pending at a time: posting another while one waits displaces it, and the
+// older is returned, done but unserved (NULL: nothing displaced). A recall
+// drops undo history and any multiply extension, and rebuilds the mip-map and
+// shadow. With DSP off, karma_core_snap_now reads the state directly.
+// karma_snapshot.h puts these and the buffer into files.
+karma_snap *karma_core_snap(t_karma *x, karma_snap *r);
+void karma_core_snap_now(const t_karma *x, karma_snap *r);
+karma_snap *karma_core_recall(t_karma *x, karma_snap *r);
+
+// --- buffer switching (at a vector boundary) ---------------------------------
+// karma_core_set_dims repoints the instance at once, so it is for DSP off.
+// With DSP running, fill w->bufio (and w->fade) off the audio thread and call
+// karma_core_switch: at the start of the next vector the instance moves onto
+// that buffer in one step, its loop reset as set_dims does (transport kept),
+// its undo history and any multiply extension dropped and the mip-map and
+// shadow rebuilt. With a fade, the new buffer's output rises linearly over
+// that many samples while the old head plays on in the old buffer (read as
+// stored, at the instance's speed and interpolation -- cubic for sinc) and
+// falls. The old buffer must stay valid until w->done; a switch during a
+// crossfade cuts the older one short. A switch posted over one still pending
+// displaces it: the older is returned done, and not made (NULL: nothing
+// displaced). karma_core_set_dims drops a pending switch and fade. Extensions
+// sized for the old buffer are ignored on a new one of another size. So that
+// they go on working, allocate ones for w->bufio (frames, its
+// karma_core_switch_chans, srscale w->bufio.sr / x->ssr) -- or pass the
+// instance's own where the size does not change -- and set w->exts. Once
+// w->done, free each of w's that the instance does not run on (w->undo !=
+// x->undo): its old ones if w->made, else the new ones it never took.
+karma_switch *karma_core_switch(t_karma *x, karma_switch *w);
+long karma_core_switch_chans(const t_karma *x, const karma_switch *w);
+
 // --- per-vector DSP ---------------------------------------------------------
+// In place is safe: any output vector may be the same memory as any input
+// vector. Each sample's inputs (and the speed signal) are read before that
+// sample's outputs are written, and nothing is read back afterwards.
 void karma_mono_perform(t_karma *x, t_object *dsp64, double **ins, long nins,
                         double **outs, long nouts, long vcount, long flgs, void *usr);
 void karma_stereo_perform(t_karma *x, t_object *dsp64, double **ins, long nins,
@@ -90,4 +317,10 @@ void karma_stereo_perform(t_karma *x, t_object *dsp64, double **ins, long nins,
 void karma_quad_perform(t_karma *x, t_object *dsp64, double **ins, long nins,
                         double **outs, long nouts, long vcount, long flgs, void *usr);
 
+// The same routine on float32 host audio, for hosts that are not Max (no
+// conversion passes): ins = ochans inputs + the speed signal, outs = ochans
+// outputs (+ the sync phase with @syncout). Math is double inside; each output
+// sample is the double routine's, rounded to float.
+void karma_perform32(t_karma *x, float **ins, float **outs, long vcount);
+
 #endif // KARMA_CORE_API_H
@@ -0,0 +1,79 @@
+// karma_denormal.h -- keep subnormals out of the buffer and the carried state.
+//
+// An overdub below unity decays the loop geometrically (recin + b * overdubamp
+// every pass), and the switch-and-ramp / ipoke state follows it down. Left alone
+// the samples eventually turn subnormal and every multiply touching them takes
+// the slow microcode path -- a CPU spike minutes into a quiet overdub.
+//
+// Two layers of protection:
+//   - karma_fpu_enter / karma_fpu_leave scope flush-to-zero + denormals-are-zero
+//     around one perform call (x86 SSE MXCSR, AArch64 FPCR.FZ), restoring the
+//     host's mode on exit. Arithmetic then never produces or consumes subnormals.
+//   - karma_flush() zeroes anything below the smallest normal float. The core
+//     applies it to the state carried between vectors, and -- on targets with no
+//     FTZ control (KARMA_FTZ == 0) -- to the overdub mix before it is written.
+//
+// Both are value-preserving for every normal float, so the sample-exact
+// differential against the reference is unaffected.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_DENORMAL_H
+#define KARMA_DENORMAL_H
+
+#include <float.h>      // FLT_MIN
+#include <math.h>       // fabs
+#include <stdint.h>     // uint64_t
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+    #include <xmmintrin.h>
+    #define KARMA_FTZ 1
+    #define KARMA_MXCSR_FTZ_DAZ 0x8040u     // FTZ (bit 15) | DAZ (bit 6)
+#elif defined(__aarch64__)
+    #define KARMA_FTZ 1
+    #define KARMA_FPCR_FZ (1ull << 24)
+#else
+    #define KARMA_FTZ 0
+#endif
+
+typedef struct {
+    uint64_t saved;     // host FP control word, restored by karma_fpu_leave
+} karma_fpu_state;
+
+static inline void karma_fpu_enter(karma_fpu_state *s)
+{
+#if KARMA_FTZ && defined(KARMA_MXCSR_FTZ_DAZ)
+    unsigned int csr = _mm_getcsr();
+    s->saved = csr;
+    if ((csr & KARMA_MXCSR_FTZ_DAZ) != KARMA_MXCSR_FTZ_DAZ)
+        _mm_setcsr(csr | KARMA_MXCSR_FTZ_DAZ);
+#elif KARMA_FTZ
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    s->saved = fpcr;
+    if (!(fpcr & KARMA_FPCR_FZ))
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | KARMA_FPCR_FZ));
+#else
+    s->saved = 0;
+#endif
+}
+
+static inline void karma_fpu_leave(const karma_fpu_state *s)
+{
+#if KARMA_FTZ && defined(KARMA_MXCSR_FTZ_DAZ)
+    if (_mm_getcsr() != (unsigned int)s->saved)
+        _mm_setcsr((unsigned int)s->saved);
+#elif KARMA_FTZ
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(s->saved));
+#else
+    (void)s;
+#endif
+}
+
+// zero anything too small to survive as a normal float (the buffer's format)
+static inline double karma_flush(double v)
+{
+    return (fabs(v) < (double)FLT_MIN) ? 0.0 : v;
+}
+
+#endif // KARMA_DENORMAL_H
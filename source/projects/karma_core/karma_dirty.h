@@ -0,0 +1,135 @@
+// karma_dirty.h -- per-vector tracking of the buffer frames the core wrote.
+//
+// The reference marks the whole buffer~ dirty after every vector that records,
+// so every waveform~ / buffer~ consumer rescans everything. The core instead
+// collects the frame ranges it actually touched (ipoke writes, span fills and
+// the declick fades) into a small list and hands them to the host's
+// set_dirty_range callback, which can redraw / persist / replicate only those.
+//
+// The list holds at most KARMA_DIRTY_MAX inclusive [lo, hi] ranges. A write
+// that touches or abuts a range extends it (the common case: the record head
+// advancing one span per sample); a disjoint write takes a new slot, and when
+// the slots run out it is merged into the nearest range. Ranges therefore
+// always cover every written frame -- possibly a few unwritten ones between
+// merged writes, never fewer.
+//
+// Every writer reports its range here *before* writing, so when an undo history
+// is attached (karma_undo.h) this is also where the pages' pre-images are saved,
+// and when a multiplied loop's extension is still virtual (karma_multiply.h)
+// where the pages about to change are materialized first.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_DIRTY_H
+#define KARMA_DIRTY_H
+
+#include "karma_undo.h"
+#include "karma_multiply.h"
+
+#define KARMA_DIRTY_MAX 4
+
+typedef struct {
+    karma_undo_state *undo;             // capture pages before first write (or NULL)
+    karma_multiply_state *mul;          // materialize pages before first write (or NULL)
+    int     n;                          // ranges in use
+    int64_t lo[KARMA_DIRTY_MAX];        // first frame (inclusive)
+    int64_t hi[KARMA_DIRTY_MAX];        // last frame (inclusive)
+} karma_dirty;
+
+// list only: no capture / materialize (for frames already written)
+static inline void karma_dirty_merge(karma_dirty *d, int64_t lo, int64_t hi)
+{
+    int k, best;
+    int64_t gap, bestgap;
+
+    if (lo > hi)
+        return;
+    for (k = d->n - 1; k >= 0; k--) {                   // most recent first
+        if ((lo <= d->hi[k] + 1) && (hi >= d->lo[k] - 1)) {
+            if (lo < d->lo[k]) d->lo[k] = lo;
+            if (hi > d->hi[k]) d->hi[k] = hi;
+            return;
+        }
+    }
+    if (d->n < KARMA_DIRTY_MAX) {
+        d->lo[d->n] = lo;
+        d->hi[d->n] = hi;
+        d->n++;
+        return;
+    }
+    best = 0;                                           // full: grow the nearest
+    bestgap = INT64_MAX;
+    for (k = 0; k < d->n; k++) {
+        gap = (lo > d->hi[k]) ? (lo - d->hi[k]) : (d->lo[k] - hi);
+        if (gap < bestgap) { bestgap = gap; best = k; }
+    }
+    if (lo < d->lo[best]) d->lo[best] = lo;
+    if (hi > d->hi[best]) d->hi[best] = hi;
+}
+
+static inline void karma_dirty_add(karma_dirty *d, int64_t lo, int64_t hi)
+{
+    if (lo > hi)
+        return;
+    if (d->mul)
+        karma_multiply_touch(d->mul, lo, hi);
+    if (d->undo)
+        karma_undo_touch(d->undo, lo, hi);
+    karma_dirty_merge(d, lo, hi);
+}
+
+// sort by start and coalesce anything that came to overlap or abut as ranges
+// grew; returns the final count
+static inline int karma_dirty_finish(karma_dirty *d)
+{
+    int i, j, m;
+    int64_t lo, hi;
+
+    for (i = 1; i < d->n; i++) {                        // n <= 4: insertion sort
+        lo = d->lo[i]; hi = d->hi[i];
+        for (j = i - 1; (j >= 0) && (d->lo[j] > lo); j--) {
+            d->lo[j + 1] = d->lo[j];
+            d->hi[j + 1] = d->hi[j];
+        }
+        d->lo[j + 1] = lo; d->hi[j + 1] = hi;
+    }
+    for (i = 1, m = 0; i < d->n; i++) {
+        if (d->lo[i] <= d->hi[m] + 1) {
+            if (d->hi[i] > d->hi[m]) d->hi[m] = d->hi[i];
+        } else {
+            m++;
+            d->lo[m] = d->lo[i]; d->hi[m] = d->hi[i];
+        }
+    }
+    if (d->n)
+        d->n = m + 1;
+    return d->n;
+}
+
+// frames [first .. first + (count - 1) * step], either direction
+static inline void karma_dirty_span(karma_dirty *d, int64_t first, int64_t count, int64_t step)
+{
+    if (count <= 0)
+        return;
+    if (step > 0)
+        karma_dirty_add(d, first, first + count - 1);
+    else
+        karma_dirty_add(d, first - count + 1, first);
+}
+
+// frames [mark, mark + direction * (count - 1)] clipped to the buffer, as
+// ease_bufoff / ease_bufon skip out-of-range positions
+static inline void karma_dirty_fade(karma_dirty *d, int64_t framesm1, int64_t mark, int64_t direction, int64_t count)
+{
+    int64_t lo, hi;
+
+    if (count <= 0)
+        return;
+    lo = (direction >= 0) ? mark : mark - (count - 1);
+    hi = (direction >= 0) ? mark + (count - 1) : mark;
+    if (lo < 0) lo = 0;
+    if (hi > framesm1) hi = framesm1;
+    karma_dirty_add(d, lo, hi);
+}
+
+#endif // KARMA_DIRTY_H
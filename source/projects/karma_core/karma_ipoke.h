@@ -1,9 +1,11 @@
 // karma_ipoke.h -- the record/ipoke write engine and its ease/fade kernels.
 //
 // These are the buffer-write side of the DSP: the per-sample record easing
-// (ease_record), the switch-and-ramp declick (ease_switchramp), and the two
+// (ease_record), the switch-and-ramp declick (ease_switchramp), the two
 // buffer-fade helpers (ease_bufoff / ease_bufon) that declick the buffer at
-// record on/off and loop boundaries. They operate only on primitive arguments
+// record on/off and loop boundaries, and the ipoke frame writers (ipoke_commit /
+// ipoke_slope / ipoke_fill) that store the pending value and interpolate across
+// the frames a fast record head skips. They operate only on primitive arguments
 // (the host buffer pointer, channel count, frame indices), never on t_karma, so
 // they are pure and unit-testable in isolation.
 //
@@ -14,6 +16,18 @@
 #ifndef KARMA_IPOKE_H
 #define KARMA_IPOKE_H
 
+// The frame writers store a whole 2- or 4-channel frame per SIMD op where the
+// target has it. Each frame still depends on the previous one (writeval
+// accumulates), so the win is the frame-wide add/convert/store, not a wider
+// sweep; double->float rounding is identical to the scalar path.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define KARMA_IPOKE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define KARMA_IPOKE_NEON 1
+#endif
+
 // easing function for recording (with ipoke)
 static inline double ease_record(double y1, char updwn, double globalramp, int64_t playfade)  // !! rewrite !!
 {
@@ -51,8 +65,9 @@ static inline double ease_switchramp(double y1, double snrfade, int64_t snrtype)
     return  y1;
 }
 
-// easing function for buffer read
-static inline void ease_bufoff(int64_t framesm1, float *b, int64_t pchans, int64_t markposition, char direction, double globalramp)
+// easing function for buffer read (pstride floats per frame; fades the first
+// pchans channels from b, at most 4 as in the reference)
+static inline void ease_bufoff(int64_t framesm1, float *b, int64_t pstride, int64_t pchans, int64_t markposition, char direction, double globalramp)
 {
     long i, fadpos;
 
@@ -62,19 +77,19 @@ static inline void ease_bufoff(int64_t framesm1, float *b, int64_t pchans, int64
 
         if ( !((fadpos < 0) || (fadpos > framesm1)) )
         {
-            b[fadpos * pchans] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+            b[fadpos * pstride] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
             if (pchans > 1)
             {
-                b[(fadpos * pchans) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                b[(fadpos * pstride) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                 if (pchans > 2)
                 {
-                    b[(fadpos * pchans) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                    b[(fadpos * pstride) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                     if (pchans > 3)
                     {
-                        b[(fadpos * pchans) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                        b[(fadpos * pstride) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
                     }
                 }
             }
@@ -85,7 +100,7 @@ static inline void ease_bufoff(int64_t framesm1, float *b, int64_t pchans, int64
 }
 
 // easing function for buffer write
-static inline void ease_bufon(int64_t framesm1, float *b, int64_t pchans, int64_t markposition1, int64_t markposition2, char direction, double globalramp)
+static inline void ease_bufon(int64_t framesm1, float *b, int64_t pstride, int64_t pchans, int64_t markposition1, int64_t markposition2, char direction, double globalramp)
 {
     long i, fadpos1, fadpos2, fadpos3;
 
@@ -97,19 +112,19 @@ static inline void ease_bufon(int64_t framesm1, float *b, int64_t pchans, int64_
 
         if ( !((fadpos1 < 0) || (fadpos1 > framesm1)) )
         {
-            b[fadpos1 * pchans] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+            b[fadpos1 * pstride] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
             if (pchans > 1)
             {
-                b[(fadpos1 * pchans) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                b[(fadpos1 * pstride) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                 if (pchans > 2)
                 {
-                    b[(fadpos1 * pchans) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                    b[(fadpos1 * pstride) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                     if (pchans > 3)
                     {
-                        b[(fadpos1 * pchans) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                        b[(fadpos1 * pstride) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
                     }
                 }
             }
@@ -117,19 +132,19 @@ static inline void ease_bufon(int64_t framesm1, float *b, int64_t pchans, int64_
 
         if ( !((fadpos2 < 0) || (fadpos2 > framesm1)) )
         {
-            b[fadpos2 * pchans] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+            b[fadpos2 * pstride] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
             if (pchans > 1)
             {
-                b[(fadpos2 * pchans) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                b[(fadpos2 * pstride) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                 if (pchans > 2)
                 {
-                    b[(fadpos2 * pchans) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                    b[(fadpos2 * pstride) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                     if (pchans > 3)
                     {
-                        b[(fadpos2 * pchans) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                        b[(fadpos2 * pstride) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
                     }
                 }
             }
@@ -137,19 +152,19 @@ static inline void ease_bufon(int64_t framesm1, float *b, int64_t pchans, int64_
 
         if ( !((fadpos3 < 0) || (fadpos3 > framesm1)) )
         {
-            b[fadpos3 * pchans] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+            b[fadpos3 * pstride] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
             if (pchans > 1)
             {
-                b[(fadpos3 * pchans) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                b[(fadpos3 * pstride) + 1] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                 if (pchans > 2)
                 {
-                    b[(fadpos3 * pchans) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                    b[(fadpos3 * pstride) + 2] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
 
                     if (pchans > 3)
                     {
-                        b[(fadpos3 * pchans) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
+                        b[(fadpos3 * pstride) + 3] *= 0.5 * ( 1.0 - cos( (((double)i) / globalramp) * PI));
                     }
                 }
             }
@@ -159,4 +174,163 @@ static inline void ease_bufon(int64_t framesm1, float *b, int64_t pchans, int64_
     return;
 }
 
+// store one frame's nproc channels (double -> float) at f
+static inline void ipoke_store_frame(float *f, int64_t nproc, const double *w)
+{
+    int64_t ch;
+#if defined(KARMA_IPOKE_SSE2)
+    if (nproc == 2) {
+        _mm_storel_pi((__m64 *)f, _mm_cvtpd_ps(_mm_loadu_pd(w)));
+        return;
+    }
+    if (nproc == 4) {
+        _mm_storeu_ps(f, _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(w)), _mm_cvtpd_ps(_mm_loadu_pd(w + 2))));
+        return;
+    }
+#elif defined(KARMA_IPOKE_NEON)
+    if (nproc == 2) {
+        vst1_f32(f, vcvt_f32_f64(vld1q_f64(w)));
+        return;
+    }
+    if (nproc == 4) {
+        vst1q_f32(f, vcombine_f32(vcvt_f32_f64(vld1q_f64(w)), vcvt_f32_f64(vld1q_f64(w + 2))));
+        return;
+    }
+#endif
+    for (ch = 0; ch < nproc; ch++)
+        f[ch] = (float)w[ch];
+}
+
+// write the pending ipoke value at `frame`, first averaging it over the samples
+// the head lingered there (linear-averaging for speed < 1x). Returns the new
+// pokesteps (reset to 1 once averaged).
+static inline double ipoke_commit(float *b, int64_t pchans, int64_t nproc, int64_t frame, double *writeval, double pokesteps)
+{
+    int64_t ch;
+    if (pokesteps > 1.0) {
+        for (ch = 0; ch < nproc; ch++)
+            writeval[ch] = writeval[ch] / pokesteps;
+        pokesteps = 1.0;
+    }
+    ipoke_store_frame(b + frame * pchans, nproc, writeval);
+    return pokesteps;
+}
+
+// true if storing w at f (as ipoke_store_frame would) leaves the frame bit for
+// bit as it is -- an overdub at unity of silence onto what was just read there
+static inline t_bool ipoke_unchanged(const float *f, int64_t nproc, const double *w)
+{
+    int64_t ch;
+    float v;
+#if defined(KARMA_IPOKE_SSE2)
+    if (nproc == 2) {
+        __m128i d = _mm_cmpeq_epi32(_mm_castps_si128(_mm_cvtpd_ps(_mm_loadu_pd(w))), _mm_loadl_epi64((const __m128i *)f));
+        return (_mm_movemask_epi8(d) & 0xff) == 0xff;
+    }
+    if (nproc == 4) {
+        __m128 s = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(w)), _mm_cvtpd_ps(_mm_loadu_pd(w + 2)));
+        return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_castps_si128(s), _mm_loadu_si128((const __m128i *)f))) == 0xffff;
+    }
+#elif defined(KARMA_IPOKE_NEON)
+    if (nproc == 2)
+        return vminv_u32(vceq_u32(vreinterpret_u32_f32(vcvt_f32_f64(vld1q_f64(w))), vld1_u32((const uint32_t *)f))) != 0;
+    if (nproc == 4)
+        return vminvq_u32(vceqq_u32(vreinterpretq_u32_f32(vcombine_f32(vcvt_f32_f64(vld1q_f64(w)), vcvt_f32_f64(vld1q_f64(w + 2)))),
+                                    vld1q_u32((const uint32_t *)f))) != 0;
+#endif
+    for (ch = 0; ch < nproc; ch++) {
+        v = (float)w[ch];
+        if (memcmp(&v, f + ch, sizeof(float)))
+            return 0;
+    }
+    return 1;
+}
+
+// per-frame increment for ipoke_fill: the slope from writeval to recin over
+// recplaydif frames, negated when filling backwards (step < 0). x - c == x + (-c)
+// exactly, so the fill can always add.
+static inline void ipoke_slope(double *delta, const double *recin, const double *writeval, int64_t nproc, double recplaydif, int64_t step)
+{
+    int64_t ch;
+    for (ch = 0; ch < nproc; ch++) {
+        delta[ch] = (recin[ch] - writeval[ch]) / recplaydif;
+        if (step < 0)
+            delta[ch] = -delta[ch];
+    }
+}
+
+// linear-interpolation for speed > 1x: fill `count` frames starting at `first`,
+// stepping by `step` (+1 forwards / -1 backwards), each frame advancing writeval
+// by delta. A fill that wraps the loop is split by the caller into two calls,
+// the second continuing from the writeval the first left behind.
+static inline void ipoke_fill(float *b, int64_t pchans, int64_t nproc, int64_t first, int64_t count, int64_t step, double *writeval, const double *delta)
+{
+    float  *f      = b + first * pchans;
+    int64_t stride = step * pchans;
+    int64_t ch, k;
+
+    if (count <= 0)
+        return;
+#if defined(KARMA_IPOKE_SSE2)
+    if (nproc == 2) {
+        __m128d w = _mm_loadu_pd(writeval), d = _mm_loadu_pd(delta);
+        for (k = 0; k < count; k++, f += stride) {
+            w = _mm_add_pd(w, d);
+            _mm_storel_pi((__m64 *)f, _mm_cvtpd_ps(w));
+        }
+        _mm_storeu_pd(writeval, w);
+        return;
+    }
+    if (nproc == 4) {
+        __m128d w01 = _mm_loadu_pd(writeval), w23 = _mm_loadu_pd(writeval + 2);
+        __m128d d01 = _mm_loadu_pd(delta),    d23 = _mm_loadu_pd(delta + 2);
+        for (k = 0; k < count; k++, f += stride) {
+            w01 = _mm_add_pd(w01, d01);
+            w23 = _mm_add_pd(w23, d23);
+            _mm_storeu_ps(f, _mm_movelh_ps(_mm_cvtpd_ps(w01), _mm_cvtpd_ps(w23)));
+        }
+        _mm_storeu_pd(writeval, w01);
+        _mm_storeu_pd(writeval + 2, w23);
+        return;
+    }
+#elif defined(KARMA_IPOKE_NEON)
+    if (nproc == 2) {
+        float64x2_t w = vld1q_f64(writeval), d = vld1q_f64(delta);
+        for (k = 0; k < count; k++, f += stride) {
+            w = vaddq_f64(w, d);
+            vst1_f32(f, vcvt_f32_f64(w));
+        }
+        vst1q_f64(writeval, w);
+        return;
+    }
+    if (nproc == 4) {
+        float64x2_t w01 = vld1q_f64(writeval), w23 = vld1q_f64(writeval + 2);
+        float64x2_t d01 = vld1q_f64(delta),    d23 = vld1q_f64(delta + 2);
+        for (k = 0; k < count; k++, f += stride) {
+            w01 = vaddq_f64(w01, d01);
+            w23 = vaddq_f64(w23, d23);
+            vst1q_f32(f, vcombine_f32(vcvt_f32_f64(w01), vcvt_f32_f64(w23)));
+        }
+        vst1q_f64(writeval, w01);
+        vst1q_f64(writeval + 2, w23);
+        return;
+    }
+#endif
+    if (nproc == 1) {
+        double w = writeval[0], d = delta[0];
+        for (k = 0; k < count; k++, f += stride) {
+            w += d;
+            *f = (float)w;
+        }
+        writeval[0] = w;
+        return;
+    }
+    for (k = 0; k < count; k++, f += stride) {
+        for (ch = 0; ch < nproc; ch++) {
+            writeval[ch] += delta[ch];
+            f[ch] = (float)writeval[ch];
+        }
+    }
+}
+
 #endif // KARMA_IPOKE_H
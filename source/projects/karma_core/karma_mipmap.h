@@ -0,0 +1,173 @@
+// karma_mipmap.h -- decimated copies of the buffer for very high playback speeds.
+//
+// At 4x, 8x and more every output sample reads frames far apart: the reads miss
+// the cache and everything above the output's Nyquist folds back. The pyramid
+// keeps KARMA_MIPMAP_LEVELS low-passed, decimated copies beside the buffer --
+// level L holds every 2^L-th frame of level L-1 run through a 5-tap binomial
+// (1 4 6 4 1) / 16, centred on the frame it keeps -- and the perform routine
+// plays from the level matching |speed| (2x -> 1, 4x -> 2, 8x and up -> 3) with
+// a cubic read there instead of the buffer.
+//
+// It is kept current incrementally: the ranges every buffer writer reports
+// (karma_dirty.h) are pushed up the levels at the end of the vector, each level
+// recomputing only the frames whose taps changed. Content changed wholesale --
+// a fresh attach, the initial-record clear, a new channel view, a multiplied
+// loop's extension -- is marked stale instead and rebuilt in the background,
+// KARMA_MIPMAP_BG frames per vector; until nothing is stale, reads use the
+// buffer. Levels are read through a multiplied loop's mapping as they are built
+// (so they hold what the buffer reads as), and never while recording.
+//
+// Like undo and multiply the state is host-owned and sized for the buffer's
+// frames and the view's channels; the audio thread only ever touches it from
+// the perform routine.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_MIPMAP_H
+#define KARMA_MIPMAP_H
+
+#include "karma_interp.h"   // CUBIC_INTERP
+#include "karma_multiply.h" // mul_resolve
+
+#define KARMA_MIPMAP_LEVELS 3                   // 2x, 4x, 8x
+#define KARMA_MIPMAP_BG     4096                // stale buffer frames rebuilt per vector
+
+typedef struct karma_mipmap {
+    float   *level[KARMA_MIPMAP_LEVELS + 1];    // [L] = len[L] frames of chans floats ([0]: the buffer)
+    int64_t  len[KARMA_MIPMAP_LEVELS + 1];
+    int64_t  frames, chans;
+    int64_t  slo, shi;          // buffer frames not yet in the levels (slo > shi: none)
+    volatile t_bool reset;      // everything stale (buffer cleared / view changed under it)
+} karma_mipmap_state;
+
+static inline void mip_stale(karma_mipmap_state *m, int64_t lo, int64_t hi)
+{
+    if (lo > hi)
+        return;
+    if (m->slo > m->shi) {
+        m->slo = lo;
+        m->shi = hi;
+    } else {
+        if (lo < m->slo) m->slo = lo;
+        if (hi > m->shi) m->shi = hi;
+    }
+}
+
+// level-1 frames j..jhi from the buffer (b: the view's first channel)
+static void mip_build1(karma_mipmap_state *m, const float *b, int64_t stride, const karma_multiply_state *mul, int64_t j, int64_t jhi)
+{
+    int64_t t[5], fm1 = m->frames - 1, c, k;
+    float *d;
+
+    for (; j <= jhi; j++) {
+        for (k = 0; k < 5; k++) {
+            t[k] = CLAMP(2 * j - 2 + k, 0, fm1);
+            if (mul)
+                t[k] = mul_resolve(mul, t[k]);
+            t[k] *= stride;
+        }
+        d = m->level[1] + j * m->chans;
+        for (c = 0; c < m->chans; c++)
+            d[c] = (b[t[0] + c] + 4.0f * b[t[1] + c] + 6.0f * b[t[2] + c] + 4.0f * b[t[3] + c] + b[t[4] + c]) * 0.0625f;
+    }
+}
+
+// level-L frames j..jhi from level L-1 (L >= 2)
+static void mip_build(karma_mipmap_state *m, int L, int64_t j, int64_t jhi)
+{
+    const float *s = m->level[L - 1];
+    int64_t t[5], lm1 = m->len[L - 1] - 1, c, k;
+    float *d;
+
+    for (; j <= jhi; j++) {
+        for (k = 0; k < 5; k++)
+            t[k] = CLAMP(2 * j - 2 + k, 0, lm1) * m->chans;
+        d = m->level[L] + j * m->chans;
+        for (c = 0; c < m->chans; c++)
+            d[c] = (s[t[0] + c] + 4.0f * s[t[1] + c] + 6.0f * s[t[2] + c] + 4.0f * s[t[3] + c] + s[t[4] + c]) * 0.0625f;
+    }
+}
+
+// buffer frames lo..hi changed: recompute every level frame whose taps cover them
+static void mip_update(karma_mipmap_state *m, const float *b, int64_t stride, const karma_multiply_state *mul, int64_t lo, int64_t hi)
+{
+    int L;
+
+    for (L = 1; L <= KARMA_MIPMAP_LEVELS; L++) {
+        lo = (lo - 1) >> 1;                     // 2j + 2 >= lo
+        hi = (hi + 2) >> 1;                     // 2j - 2 <= hi
+        if (lo < 0) lo = 0;
+        if (hi > m->len[L] - 1) hi = m->len[L] - 1;
+        if (lo > hi)
+            return;
+        if (L == 1)
+            mip_build1(m, b, stride, mul, lo, hi);
+        else
+            mip_build(m, L, lo, hi);
+    }
+}
+
+// Top of a vector: act on a pending reset, then rebuild one more stretch of
+// whatever is stale. Returns true while reads must still use the buffer.
+static t_bool mip_service(karma_mipmap_state *m, const float *b, int64_t stride, const karma_multiply_state *mul)
+{
+    int64_t hi;
+
+    if (m->reset) {
+        m->reset = 0;
+        m->slo = 0;
+        m->shi = m->frames - 1;
+    }
+    if (m->slo > m->shi)
+        return 0;
+    hi = m->slo + KARMA_MIPMAP_BG - 1;
+    if (hi > m->shi)
+        hi = m->shi;
+    mip_update(m, b, stride, mul, m->slo, hi);
+    m->slo = hi + 1;
+    return m->slo <= m->shi;
+}
+
+static const double mip_scale[KARMA_MIPMAP_LEVELS + 1] = { 1.0, 0.5, 0.25, 0.125 };
+
+// the level for a head step (0 = read the buffer)
+static inline int mip_level(double step)
+{
+    step = fabs(step);
+    return (step < 2.0) ? 0 : ((step < 4.0) ? 1 : ((step < 8.0) ? 2 : 3));
+}
+
+// osamp[0 .. nproc-1] at the play position (as sinc_read: accuratehead forward,
+// one frame behind it in reverse), cubic in level L; neighbours wrap within the
+// loop's span of the level
+static inline void mip_read(double *osamp, const karma_mipmap_state *m, int L, int64_t nproc, double accuratehead, int64_t playhead,
+                            char direction, char directionorig, int64_t maxloop, int64_t framesm1)
+{
+    const float *s = m->level[L];
+    double pos, q, f;
+    int64_t i[4], j, lo, hi, span, c, k;
+
+    pos = (direction < 0) ? (accuratehead - 1.0) : ((direction > 0) ? accuratehead : (double)playhead);
+    lo = (directionorig >= 0) ? 0 : (framesm1 - maxloop);
+    hi = (directionorig >= 0) ? maxloop : framesm1;
+    lo = (lo + ((int64_t)1 << L) - 1) >> L;
+    hi = hi >> L;
+    span = hi - lo + 1;
+    q = pos * mip_scale[L];
+    j = (int64_t)q;
+    if (q < (double)j)                          // (truncation: floor for pos < 0)
+        j--;
+    f = q - (double)j;
+    for (k = 0; k < 4; k++) {
+        i[k] = j - 1 + k;
+        if (span > 0) {
+            if (i[k] < lo) i[k] += span;
+            else if (i[k] > hi) i[k] -= span;
+        }
+        i[k] = CLAMP(i[k], 0, m->len[L] - 1) * m->chans;
+    }
+    for (c = 0; c < nproc; c++)
+        osamp[c] = CUBIC_INTERP(f, s[i[0] + c], s[i[1] + c], s[i[2] + c], s[i[3] + c]);
+}
+
+#endif // KARMA_MIPMAP_H
@@ -0,0 +1,120 @@
+// karma_multiply.h -- loop multiply as a logical extension of the buffer.
+//
+// Multiplying a loop by N makes it N times as long, each repetition a copy of
+// the original. Doing that copy up front is one huge memcpy at message time.
+// Instead the loop end moves out at once and the *extension* -- the frames past
+// the original loop -- is virtual: a read there resolves (period by period)
+// back to the source content. A 1024-frame page of the extension becomes real
+// ("materialized": copied from what it resolves to) only when something is
+// about to write it -- an overdub, a declick fade, an undo swap -- and a page
+// whose content is about to be overwritten first materializes every
+// unmaterialized page that resolves into it, so writing one repetition never
+// leaks into the others. Meanwhile the perform routine materializes one more
+// page per vector in the background; once the whole extension is real the
+// mapping is dropped and the buffer holds exactly what a copy would have.
+//
+// Multiplying a multiplied loop stacks a level (up to KARMA_MULTIPLY_LEVELS),
+// as long as the loop still starts where the first level put it and ends where
+// the last one did. Forward (directionorig >= 0) loops only.
+//
+// Like undo (karma_undo.h), the state is host-owned and sized for the buffer,
+// multiply is a request the perform routine services at the top of its next
+// vector (an atomic, taken and cleared in one step), and materialization is
+// driven from karma_dirty_add.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_MULTIPLY_H
+#define KARMA_MULTIPLY_H
+
+#include <stdatomic.h>
+
+#define KARMA_MULTIPLY_SHIFT    10                      // 1024-frame pages
+#define KARMA_MULTIPLY_LEVELS   4
+
+typedef struct karma_multiply {
+    float    *b;                // first channel of the view, this vector (set by perform)
+    int64_t   stride;           // floats per buffer frame (>= chans; set by perform)
+    uint32_t *real;             // per page bit: its extension frames are materialized
+    int64_t   frames, chans, npages;
+    int64_t   base;             // minloop the levels were built on
+    int64_t   period[KARMA_MULTIPLY_LEVELS + 1];    // loop length before level 1, after level k
+    int       levels;           // 0 = no extension
+    int64_t   cursor;           // background materialization: next page to check
+    int64_t   dlo, dhi;         // frames materialized this vector (dlo > dhi: none)
+    atomic_long     request;    // factor posted by the control thread (0 = none)
+    atomic_bool     reset;      // drop the extension (buffer cleared under it)
+} karma_multiply_state;
+
+static inline t_bool mul_is_real(const karma_multiply_state *m, int64_t page)
+{
+    return (m->real[page >> 5] >> (page & 31)) & 1;
+}
+
+// frame whose sample frame f currently holds (f itself unless f lies in an
+// unmaterialized page of the extension)
+static inline int64_t mul_resolve(const karma_multiply_state *m, int64_t f)
+{
+    int k = m->levels;
+
+    if ((f <= m->base + m->period[0]) || (f > m->base + m->period[k]))
+        return f;
+    while (k > 0) {
+        if (f <= m->base + m->period[k - 1]) {          // below this level's extension
+            k--;
+        } else if (mul_is_real(m, f >> KARMA_MULTIPLY_SHIFT)) {
+            return f;
+        } else {
+            f = m->base + 1 + (f - m->base - 1) % m->period[k - 1];
+            k--;
+        }
+    }
+    return f;
+}
+
+static void mul_materialize(karma_multiply_state *m, int64_t page)
+{
+    int64_t first = page << KARMA_MULTIPLY_SHIFT, last = first + (1 << KARMA_MULTIPLY_SHIFT) - 1, f, c, s;
+    int64_t lo = m->base + m->period[0] + 1, hi = m->base + m->period[m->levels];
+
+    if (first < lo) first = lo;
+    if (last > hi) last = hi;
+    for (f = first; f <= last; f++) {
+        s = mul_resolve(m, f);
+        for (c = 0; c < m->chans; c++)
+            m->b[f * m->stride + c] = m->b[s * m->stride + c];
+    }
+    m->real[page >> 5] |= (uint32_t)1 << (page & 31);
+    if (first < m->dlo) m->dlo = first;
+    if (last > m->dhi) m->dhi = last;
+}
+
+static inline void mul_materialize_range(karma_multiply_state *m, int64_t lo, int64_t hi)
+{
+    int64_t p, last;
+
+    if (lo <= m->base + m->period[0]) lo = m->base + m->period[0] + 1;
+    if (hi > m->base + m->period[m->levels]) hi = m->base + m->period[m->levels];
+    if (lo > hi)
+        return;
+    for (p = lo >> KARMA_MULTIPLY_SHIFT, last = hi >> KARMA_MULTIPLY_SHIFT; p <= last; p++)
+        if (!mul_is_real(m, p))
+            mul_materialize(m, p);
+}
+
+// called with every range about to be written (frames lo..hi inclusive): the
+// range itself, then every frame that can resolve into it (f + j * period[0])
+static inline void karma_multiply_touch(karma_multiply_state *m, int64_t lo, int64_t hi)
+{
+    int64_t end = m->base + m->period[m->levels], j;
+
+    if (!m->levels || (hi <= m->base) || (lo > end))
+        return;
+    if (lo <= m->base) lo = m->base + 1;
+    if (hi > end) hi = end;
+    mul_materialize_range(m, lo, hi);
+    for (j = m->period[0]; lo + j <= end; j += m->period[0])
+        mul_materialize_range(m, lo + j, hi + j);
+}
+
+#endif // KARMA_MULTIPLY_H
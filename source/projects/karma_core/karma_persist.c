@@ -0,0 +1,343 @@
+// karma_persist.c -- background, incremental persistence of the loop buffer.
+// See karma_persist.h for the threading and crash-safety model.
+
+#include "karma_core.h"
+#include "karma_persist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #define persist_seek(f, off)    _fseeki64((f), (off), SEEK_SET)
+    #define persist_fsync(f)        _commit(_fileno(f))
+    typedef CRITICAL_SECTION        persist_mutex;
+    typedef HANDLE                  persist_thread;
+#else
+    #include <pthread.h>
+    #include <time.h>
+    #include <unistd.h>
+    #define persist_seek(f, off)    fseeko((f), (off_t)(off), SEEK_SET)
+    #define persist_fsync(f)        fsync(fileno(f))
+    typedef pthread_mutex_t         persist_mutex;
+    typedef pthread_t               persist_thread;
+#endif
+
+#define PERSIST_HEADER  58          // RIFF + fmt (18, IEEE float) + fact + data headers
+
+typedef struct {
+    long start, count;
+} persist_range;
+
+struct karma_persist {
+    karma_buffer_iface  io;
+    FILE               *f;
+    long                period_ms;
+    int64_t             frames, chans;
+
+    // audio thread -> writer; head written only by the producer, tail only by the writer
+    persist_range       ring[KARMA_PERSIST_RING];
+    atomic_size_t       head, tail;
+    atomic_int          resync;
+    atomic_int          running;
+
+    // writer-side only (under `lock`)
+    persist_mutex       lock;
+    persist_thread      thread;
+    persist_range      *work;       // KARMA_PERSIST_RING drained ranges
+    float              *bounce;     // KARMA_PERSIST_CHUNK frames
+    double              lastdrain;
+    karma_persist_stats stats;
+    int                 failed;
+};
+
+// ---- platform helpers -------------------------------------------------------
+static double persist_now_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER c, q;
+    QueryPerformanceCounter(&c);
+    QueryPerformanceFrequency(&q);
+    return (double)c.QuadPart * 1000.0 / (double)q.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1000.0 + (double)t.tv_nsec * 1e-6;
+#endif
+}
+
+static void persist_sleep_ms(long ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&t, NULL);
+#endif
+}
+
+static void persist_lock(persist_mutex *m)
+{
+#ifdef _WIN32
+    EnterCriticalSection(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+static void persist_unlock(persist_mutex *m)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+// ---- file -------------------------------------------------------------------
+static void put16(unsigned char *d, uint32_t v) { d[0] = v & 0xff; d[1] = (v >> 8) & 0xff; }
+static void put32(unsigned char *d, uint32_t v) { put16(d, v & 0xffff); put16(d + 2, v >> 16); }
+
+static int persist_write_header(FILE *f, int64_t frames, int64_t chans, double sr)
+{
+    unsigned char h[PERSIST_HEADER];
+    uint64_t datasize = (uint64_t)frames * (uint64_t)chans * 4;
+    uint32_t rate = (uint32_t)(sr + 0.5);
+
+    if (datasize > (0xffffffffull - PERSIST_HEADER))
+        return -1;                                  // RIFF can't address it
+    memcpy(h, "RIFF", 4);       put32(h + 4, (uint32_t)(datasize + PERSIST_HEADER - 8));
+    memcpy(h + 8, "WAVE", 4);
+    memcpy(h + 12, "fmt ", 4);  put32(h + 16, 18);
+    put16(h + 20, 3);                               // WAVE_FORMAT_IEEE_FLOAT
+    put16(h + 22, (uint32_t)chans);
+    put32(h + 24, rate);
+    put32(h + 28, rate * (uint32_t)chans * 4);      // byte rate
+    put16(h + 32, (uint32_t)chans * 4);             // block align
+    put16(h + 34, 32);
+    put16(h + 36, 0);                               // cbSize
+    memcpy(h + 38, "fact", 4);  put32(h + 42, 4);   put32(h + 46, (uint32_t)frames);
+    memcpy(h + 50, "data", 4);  put32(h + 54, (uint32_t)datasize);
+
+    if (persist_seek(f, 0) || fwrite(h, 1, sizeof(h), f) != sizeof(h))
+        return -1;
+    return 0;
+}
+
+static int persist_write_range(karma_persist *p, int64_t start, int64_t count)
+{
+    while (count > 0) {
+        int64_t n = (count < KARMA_PERSIST_CHUNK) ? count : KARMA_PERSIST_CHUNK;
+        size_t  samples = (size_t)(n * p->chans);
+        float  *b = (float *)p->io.lock(p->io.ctx);
+
+        if (!b)
+            return -1;
+        memcpy(p->bounce, b + start * p->chans, samples * sizeof(float));
+        p->io.unlock(p->io.ctx);
+
+        if (persist_seek(p->f, PERSIST_HEADER + start * p->chans * 4) ||
+            fwrite(p->bounce, sizeof(float), samples, p->f) != samples)
+            return -1;
+        start += n;
+        count -= n;
+    }
+    return 0;
+}
+
+static int range_cmp(const void *a, const void *b)
+{
+    long sa = ((const persist_range *)a)->start, sb = ((const persist_range *)b)->start;
+    return (sa > sb) - (sa < sb);
+}
+
+// Drain the ring, merge, write, sync. Writer thread or karma_persist_flush.
+static int persist_pump(karma_persist *p)
+{
+    size_t h, t;
+    long   i, n = 0, m;
+    int    err = 0, resync;
+    double drained, done;
+
+    persist_lock(&p->lock);
+    resync = atomic_exchange_explicit(&p->resync, 0, memory_order_acq_rel) || p->failed;
+    h = atomic_load_explicit(&p->head, memory_order_acquire);
+    t = atomic_load_explicit(&p->tail, memory_order_relaxed);
+    for (; t != h; t++)
+        p->work[n++] = p->ring[t & (KARMA_PERSIST_RING - 1)];
+    atomic_store_explicit(&p->tail, t, memory_order_release);
+    drained = persist_now_ms();
+
+    if (resync) {
+        p->work[0].start = 0;
+        p->work[0].count = (long)p->frames;
+        n = 1;
+        p->stats.resyncs++;
+    } else if (n > 1) {
+        qsort(p->work, (size_t)n, sizeof(persist_range), range_cmp);
+        for (i = 1, m = 0; i < n; i++) {
+            long end = p->work[m].start + p->work[m].count;
+            if (p->work[i].start <= end) {
+                long iend = p->work[i].start + p->work[i].count;
+                if (iend > end)
+                    p->work[m].count = iend - p->work[m].start;
+            } else {
+                p->work[++m] = p->work[i];
+            }
+        }
+        n = m + 1;
+    }
+
+    for (i = 0; (i < n) && !err; i++) {
+        int64_t s = p->work[i].start, c = p->work[i].count;
+        if (s < 0) { c += s; s = 0; }
+        if (s + c > p->frames) c = p->frames - s;
+        if (c <= 0)
+            continue;
+        err = persist_write_range(p, s, c);
+        p->stats.frames += (uint64_t)c;
+    }
+    if (n) {
+        if (!err && (fflush(p->f) || persist_fsync(p->f)))
+            err = -1;
+        done = persist_now_ms();
+        p->stats.passes++;
+        p->stats.ranges += (uint64_t)n;
+        if (p->lastdrain > 0.0 && (done - p->lastdrain) > p->stats.max_lag_ms)
+            p->stats.max_lag_ms = done - p->lastdrain;  // a note just after the last drain waited this long
+    }
+    p->lastdrain = drained;
+    p->failed = (err != 0);                             // retry the whole buffer next pass
+    persist_unlock(&p->lock);
+    return err;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI persist_main(LPVOID arg)
+#else
+static void *persist_main(void *arg)
+#endif
+{
+    karma_persist *p = (karma_persist *)arg;
+
+    while (atomic_load_explicit(&p->running, memory_order_acquire)) {
+        persist_sleep_ms(p->period_ms);
+        persist_pump(p);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// ---- public -----------------------------------------------------------------
+karma_persist *karma_persist_open(const char *path, const karma_buffer_iface *io, long period_ms)
+{
+    karma_persist *p;
+
+    if (!path || !io || !io->lock || !io->unlock || (io->frames <= 0) || (io->chans <= 0))
+        return NULL;
+    p = (karma_persist *)calloc(1, sizeof(karma_persist));
+    if (!p)
+        return NULL;
+    p->io        = *io;
+    p->frames    = io->frames;
+    p->chans     = io->chans;
+    p->period_ms = (period_ms > 0) ? period_ms : 1;
+    p->work      = (persist_range *)malloc(KARMA_PERSIST_RING * sizeof(persist_range));
+    p->bounce    = (float *)malloc((size_t)(KARMA_PERSIST_CHUNK * p->chans) * sizeof(float));
+    p->f         = fopen(path, "w+b");
+    atomic_init(&p->head, 0);
+    atomic_init(&p->tail, 0);
+    atomic_init(&p->resync, 1);                     // first pass writes everything
+    atomic_init(&p->running, 1);
+#ifdef _WIN32
+    InitializeCriticalSection(&p->lock);
+#else
+    pthread_mutex_init(&p->lock, NULL);
+#endif
+    if (!p->work || !p->bounce || !p->f ||
+        persist_write_header(p->f, p->frames, p->chans, io->sr) ||
+        persist_pump(p))
+        goto fail;
+#ifdef _WIN32
+    p->thread = CreateThread(NULL, 0, persist_main, p, 0, NULL);
+    if (!p->thread)
+        goto fail;
+#else
+    if (pthread_create(&p->thread, NULL, persist_main, p))
+        goto fail;
+#endif
+    return p;
+
+fail:
+    if (p->f) fclose(p->f);
+#ifdef _WIN32
+    DeleteCriticalSection(&p->lock);
+#else
+    pthread_mutex_destroy(&p->lock);
+#endif
+    free(p->work);
+    free(p->bounce);
+    free(p);
+    return NULL;
+}
+
+void karma_persist_note(karma_persist *p, long start, long count)
+{
+    size_t h, t;
+
+    if (!p || (count <= 0) || (start >= p->frames))
+        return;
+    if ((start <= 0) && ((int64_t)start + count >= p->frames)) {
+        atomic_store_explicit(&p->resync, 1, memory_order_release);     // whole buffer: any thread
+        return;
+    }
+    h = atomic_load_explicit(&p->head, memory_order_relaxed);
+    t = atomic_load_explicit(&p->tail, memory_order_acquire);
+    if ((h - t) >= KARMA_PERSIST_RING) {                                // writer fell behind
+        atomic_store_explicit(&p->resync, 1, memory_order_release);
+        return;
+    }
+    p->ring[h & (KARMA_PERSIST_RING - 1)].start = start;
+    p->ring[h & (KARMA_PERSIST_RING - 1)].count = count;
+    atomic_store_explicit(&p->head, h + 1, memory_order_release);
+}
+
+int karma_persist_flush(karma_persist *p)
+{
+    return p ? persist_pump(p) : -1;
+}
+
+void karma_persist_close(karma_persist *p)
+{
+    if (!p)
+        return;
+    atomic_store_explicit(&p->running, 0, memory_order_release);
+#ifdef _WIN32
+    WaitForSingleObject(p->thread, INFINITE);
+    CloseHandle(p->thread);
+#else
+    pthread_join(p->thread, NULL);
+#endif
+    persist_pump(p);
+    fclose(p->f);
+#ifdef _WIN32
+    DeleteCriticalSection(&p->lock);
+#else
+    pthread_mutex_destroy(&p->lock);
+#endif
+    free(p->work);
+    free(p->bounce);
+    free(p);
+}
+
+void karma_persist_get_stats(karma_persist *p, karma_persist_stats *out)
+{
+    persist_lock(&p->lock);
+    *out = p->stats;
+    persist_unlock(&p->lock);
+}
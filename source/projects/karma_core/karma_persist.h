@@ -0,0 +1,64 @@
+// karma_persist.h -- background, incremental persistence of the loop buffer.
+//
+// A standalone companion to the core: it mirrors a host buffer into a WAV file
+// (32-bit float, interleaved, the buffer's channel count and length) and keeps
+// that file up to date by streaming only the frame ranges the core reports
+// through karma_buffer_iface.set_dirty_range.
+//
+// Threads:
+//   - audio thread: karma_persist_note() from the host's set_dirty_range
+//     callback. Lock-free, allocation-free, never blocks: it appends to a
+//     preallocated single-producer ring; if the ring is full it raises a
+//     resync flag and the writer rewrites the whole buffer instead.
+//     A note covering the whole buffer (the core's clear on a fresh initial
+//     record, made from the control thread) only raises that flag, so it is
+//     safe from any thread.
+//   - writer thread (owned by the component, started by karma_persist_open):
+//     every period_ms it drains the ring, merges the ranges, copies them out of
+//     the buffer under iface lock/unlock and writes them in place, then syncs.
+//
+// Crash safety: the WAV header is written once, for the final size, before any
+// data, and data is only ever overwritten in place -- the file is a valid,
+// playable WAV at every instant. A crash loses at most the last period_ms (plus
+// one write) of changes; a sample is either its old or new value, never torn.
+//
+// The copy reads the live buffer while the audio thread may be writing it; any
+// frame written after it was copied is re-reported and rewritten next period,
+// so the file converges to the buffer once recording stops.
+//
+// Needs C11 atomics and pthreads (POSIX) or Win32 threads. Little-endian hosts.
+// Include AFTER karma_core_api.h (for karma_buffer_iface).
+
+#ifndef KARMA_PERSIST_H
+#define KARMA_PERSIST_H
+
+#define KARMA_PERSIST_RING      4096    // pending range notes (power of two)
+#define KARMA_PERSIST_CHUNK     16384   // frames copied per lock of the buffer
+
+typedef struct karma_persist karma_persist;
+
+typedef struct {
+    uint64_t passes;            // writer wake-ups that found work
+    uint64_t ranges;            // merged ranges written
+    uint64_t frames;            // frames written (incl. resyncs)
+    uint64_t resyncs;           // whole-buffer rewrites (overflow / clear)
+    double   max_lag_ms;        // worst note -> on-disk bound observed
+} karma_persist_stats;
+
+// Create (or truncate) `path`, write the whole buffer, start the writer thread.
+// `io` is copied; frames / chans / sr must describe the buffer for the life of
+// the persister (reopen after a resize). Returns NULL on I/O or thread failure.
+karma_persist *karma_persist_open(const char *path, const karma_buffer_iface *io, long period_ms);
+
+// Audio thread (see above): frames [start, start + count) changed.
+void karma_persist_note(karma_persist *p, long start, long count);
+
+// Control thread: write everything pending now and sync. Returns 0 on success.
+int  karma_persist_flush(karma_persist *p);
+
+// Stop the writer, do a final flush, close the file and free.
+void karma_persist_close(karma_persist *p);
+
+void karma_persist_get_stats(karma_persist *p, karma_persist_stats *out);
+
+#endif // KARMA_PERSIST_H
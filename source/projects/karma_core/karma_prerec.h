@@ -0,0 +1,95 @@
+// karma_prerec.h -- a rolling pre-record ring, for capturing what was just played.
+//
+// karma_record starts from the moment it is called, so a phrase that was only
+// worth keeping after it was played is gone. With a ring attached, the instance
+// writes its input into it every vector, whatever it is doing (stopped and
+// dormant included), and karma_capture(x, seconds) turns the last that many
+// seconds into the loop: at the top of the next vector, under the lock, the
+// ring's newest frames are copied once to the start of the buffer's view and
+// the loop closes on them exactly as an initial record that ran that long and
+// ended there would (forward, from frame 0, the window and the loop-end declick
+// applied by the same code), and it plays on.
+//
+// The ring is planar, one float run per channel, so the always-on write is a
+// straight copy of each input vector (a memcpy for float32 hosts, a convert for
+// double ones) with at most one wrap -- no per-sample indexing. The capture is
+// the one copy, bounded by the ring's length; like the initial record's clear,
+// it drops undo history and any multiply extension and rebuilds the mip-map
+// and shadow. A capture shorter than KARMA_PREREC_MIN frames (the shortest loop
+// the loop end makes) is padded with silence to it.
+//
+// Host-owned and sized in seconds at the system rate for the view's channels
+// (ignored while the channels differ).
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_PREREC_H
+#define KARMA_PREREC_H
+
+#include <stdatomic.h>
+
+#define KARMA_PREREC_MIN    4096                // shortest loop (the loop end's clamp)
+
+typedef struct karma_prerec {
+    float   *r;                 // chans runs of len floats
+    int64_t  len, chans;
+    int64_t  pos;               // next frame written
+    int64_t  filled;            // frames written so far (up to len)
+    _Atomic double  request;    // seconds to capture (0: none pending), posted by the control thread
+} karma_prerec_state;
+
+// the vector's inputs (channels 0..nproc-1; the rest stay silent) into the ring
+static inline void prerec_write(karma_prerec_state *q, void **in, int64_t nproc, long n, const int f32)
+{
+    int64_t pos = q->pos, m, k, c;
+    long i = 0;
+    float *d;
+    const double *s;
+
+    while (i < n) {
+        m = q->len - pos;
+        if (m > n - i)
+            m = n - i;
+        for (c = 0; c < nproc; c++) {
+            d = q->r + c * q->len + pos;
+            if (f32) {
+                memcpy(d, (const float *)in[c] + i, (size_t)m * sizeof(float));
+            } else {
+                s = (const double *)in[c] + i;
+                for (k = 0; k < m; k++)
+                    d[k] = (float)s[k];
+            }
+        }
+        pos += m;
+        if (pos == q->len)
+            pos = 0;
+        i += (long)m;
+    }
+    q->pos = pos;
+    q->filled = (q->filled + n < q->len) ? (q->filled + n) : q->len;
+}
+
+// the ring's newest n frames (n <= filled) to frames 0..n-1 of the buffer (b: the
+// view's first channel), silence on to frame total-1
+static void prerec_commit(const karma_prerec_state *q, float *b, int64_t stride, int64_t n, int64_t total)
+{
+    int64_t j = q->pos - n, f, c;
+    float *d;
+
+    if (j < 0)
+        j += q->len;
+    for (f = 0; f < total; f++) {               // frame by frame: the buffer is written in order
+        d = b + f * stride;
+        if (f < n) {
+            for (c = 0; c < q->chans; c++)
+                d[c] = q->r[c * q->len + j];
+            if (++j == q->len)
+                j = 0;
+        } else {
+            for (c = 0; c < q->chans; c++)
+                d[c] = 0.0f;
+        }
+    }
+}
+
+#endif // KARMA_PREREC_H
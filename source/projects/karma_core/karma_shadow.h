@@ -0,0 +1,168 @@
+// karma_shadow.h -- the loop resampled to the system rate, for buffers at another.
+//
+// When the buffer's rate differs from the system's (srscale != 1) the head
+// steps srscale frames per sample even at speed 1, so every sample of playback
+// interpolates. The shadow is that playback computed ahead of time: shadow frame
+// k holds what the instance's own kernel (linear / cubic / spline, the loop's
+// wrap rule and any multiply mapping included) returns at buffer position
+// anchor + k * srscale, anchor being the window start every forward pass begins
+// from. While the head stays on that grid -- forward, from the window start, at
+// speed 1 (or any whole speed) -- a sample is one read of the shadow instead of
+// four of the buffer and a kernel. Anywhere else (a jump, a window wrapped past
+// the loop end, fractional speeds, reverse, recording) playback reads the
+// buffer as before; the two agree to float precision.
+//
+// Like the mip-map (karma_mipmap.h) it follows every write: the per-vector
+// dirty ranges recompute the shadow frames whose taps they cover at the end of
+// the vector. Anything it depends on wholesale -- the anchor, the loop, the
+// interpolation mode, a fresh attach, the initial-record clear, a new channel
+// view -- marks it all stale, and it is rebuilt in the background,
+// KARMA_SHADOW_BG frames per sample of the vector, reads in the stale span
+// using the buffer. The rebuild stays on the audio thread: it must see this
+// vector's writes and multiply pages, which another thread could read half
+// done. The budget tracks the vector, so a rebuild costs a fixed few times the
+// vector's own reads at any vector size (256 frames at 64: a 10 s loop at
+// 48k is current again in about 2.5 s).
+//
+// Host-owned and sized for the buffer's frames, the view's channels and the
+// srscale it will play at (ignored while any of those differ).
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_SHADOW_H
+#define KARMA_SHADOW_H
+
+#include "karma_interp.h"   // kernels + interp_index
+#include "karma_multiply.h" // mul_resolve
+
+#define KARMA_SHADOW_BG     4                   // stale shadow frames rebuilt per sample of the vector
+#define KARMA_SHADOW_EPS    1e-4                // how far off the grid (in frames) still reads it
+
+typedef struct karma_shadow {
+    float   *s;                 // len frames of chans floats
+    int64_t  len, frames, chans;
+    double   srscale, inv;      // buffer frames per shadow frame, and 1 / that
+    int64_t  slo, shi;          // stale shadow frames (slo > shi: none)
+    int64_t  anchor, maxloop, interp;   // what the content was built for
+    int64_t  kend;              // last frame inside the loop (forward playback wraps before it's passed)
+    char     directionorig;
+    volatile t_bool reset;      // everything stale (buffer cleared / view changed under it)
+} karma_shadow_state;
+
+// shadow frames k..khi from the buffer (b: the view's first channel)
+static void shadow_build(karma_shadow_state *r, const float *b, int64_t stride, const karma_multiply_state *mul, int64_t k, int64_t khi)
+{
+    int64_t i0, i1, i2, i3, ph, c, fm1 = r->frames - 1;
+    double pos, frac;
+    float *d;
+
+    for (; k <= khi; k++) {
+        pos = (double)r->anchor + (double)k * r->srscale;
+        ph = (int64_t)pos;
+        frac = pos - (double)ph;
+        d = r->s + k * r->chans;
+        if (k > r->kend) {                      // past the loop: never played from the grid
+            for (c = 0; c < r->chans; c++)
+                d[c] = 0.0f;
+            continue;
+        }
+        interp_index(ph, &i0, &i1, &i2, &i3, 1, r->directionorig, r->maxloop, fm1);
+        if (mul) {
+            i0 = mul_resolve(mul, i0);
+            i1 = mul_resolve(mul, i1);
+            i2 = mul_resolve(mul, i2);
+            i3 = mul_resolve(mul, i3);
+        }
+        i0 *= stride; i1 *= stride; i2 *= stride; i3 *= stride;
+        for (c = 0; c < r->chans; c++) {
+            if (r->interp == 1)
+                d[c] = (float)CUBIC_INTERP(frac, b[i0 + c], b[i1 + c], b[i2 + c], b[i3 + c]);
+            else if (r->interp == 2)
+                d[c] = (float)SPLINE_INTERP(frac, b[i0 + c], b[i1 + c], b[i2 + c], b[i3 + c]);
+            else
+                d[c] = (float)LINEAR_INTERP(frac, b[i1 + c], b[i2 + c]);
+        }
+    }
+}
+
+// shadow frames whose positions lie in buffer frames [lo, hi] (unclamped)
+static inline void shadow_span(const karma_shadow_state *r, int64_t lo, int64_t hi, int64_t *klo, int64_t *khi)
+{
+    *klo = (int64_t)ceil(((double)lo - (double)r->anchor) * r->inv);
+    *khi = (int64_t)floor(((double)hi + 1.0 - (double)r->anchor) * r->inv);
+}
+
+// buffer frames lo..hi changed: recompute every shadow frame whose taps cover
+// them -- positions within [lo - 2, hi + 1], and when the loop's wrap brings
+// taps from one end of the loop to the other, the positions at both ends
+static void shadow_update(karma_shadow_state *r, const float *b, int64_t stride, const karma_multiply_state *mul, int64_t lo, int64_t hi)
+{
+    int64_t fm1 = r->frames - 1, wlo, whi, k0, k1;
+
+    shadow_span(r, lo - 2, hi + 1, &k0, &k1);
+    if (k0 < 0) k0 = 0;
+    if (k1 > r->len - 1) k1 = r->len - 1;
+    if (k0 <= k1)
+        shadow_build(r, b, stride, mul, k0, k1);
+    wlo = (r->directionorig >= 0) ? 0 : (fm1 - r->maxloop);
+    whi = (r->directionorig >= 0) ? r->maxloop : fm1;
+    if ((lo <= wlo + 2) || (hi >= whi - 2)) {
+        shadow_span(r, wlo - 2, wlo + 2, &k0, &k1);
+        if (k0 < 0) k0 = 0;
+        if (k1 > r->len - 1) k1 = r->len - 1;
+        if (k0 <= k1)
+            shadow_build(r, b, stride, mul, k0, k1);
+        shadow_span(r, whi - 3, whi + 2, &k0, &k1);
+        if (k0 < 0) k0 = 0;
+        if (k1 > r->len - 1) k1 = r->len - 1;
+        if (k0 <= k1)
+            shadow_build(r, b, stride, mul, k0, k1);
+    }
+}
+
+// Top of a vector: everything is stale if a reset is pending or what the
+// content was built for changed; then rebuild one more stretch of it (n: the
+// vector's samples).
+static void shadow_service(karma_shadow_state *r, const float *b, int64_t stride, const karma_multiply_state *mul,
+                           int64_t anchor, int64_t maxloop, char directionorig, int64_t interp, long n)
+{
+    int64_t hi;
+
+    if (r->reset || (anchor != r->anchor) || (maxloop != r->maxloop) || (directionorig != r->directionorig) || (interp != r->interp)) {
+        r->reset = 0;
+        r->anchor = anchor;
+        r->maxloop = maxloop;
+        r->directionorig = directionorig;
+        r->interp = interp;
+        r->kend = (int64_t)floor(((double)((directionorig >= 0) ? maxloop : (r->frames - 1)) - (double)anchor) * r->inv);
+        if (r->kend > r->len - 1)
+            r->kend = r->len - 1;
+        r->slo = 0;
+        r->shi = r->len - 1;
+    }
+    if (r->slo > r->shi)
+        return;
+    hi = r->slo + KARMA_SHADOW_BG * (int64_t)n - 1;
+    if (hi > r->shi)
+        hi = r->shi;
+    shadow_build(r, b, stride, mul, r->slo, hi);
+    r->slo = hi + 1;
+}
+
+// osamp[0 .. nproc-1] from the shadow if accuratehead is on its grid and that
+// frame is current; false: read the buffer
+static inline t_bool shadow_read(double *osamp, const karma_shadow_state *r, int64_t nproc, double accuratehead)
+{
+    double q = (accuratehead - (double)r->anchor) * r->inv;
+    int64_t k = (int64_t)(q + 0.5), c;
+    const float *s;
+
+    if ((q < -0.5) || (k > r->kend) || (fabs(q - (double)k) > KARMA_SHADOW_EPS) || ((k >= r->slo) && (k <= r->shi)))
+        return 0;
+    s = r->s + k * r->chans;
+    for (c = 0; c < nproc; c++)
+        osamp[c] = s[c];
+    return 1;
+}
+
+#endif // KARMA_SHADOW_H
@@ -0,0 +1,236 @@
+// karma_sinc.h -- band-limited windowed-sinc interpolation (interp mode 3).
+//
+// Linear / cubic / spline (karma_interp.h) alias audibly under heavy varispeed.
+// This is a Kaiser-windowed sinc of KARMA_SINC_TAPS_MIN..MAX taps (8, 16 or 32),
+// tabulated once as a half kernel at KARMA_SINC_PHASES points per tap and read
+// with linear interpolation between table points -- any fractional position is
+// one lookup per tap, the continuous form of a polyphase bank. Above 1x the
+// cutoff follows 1 / |step|: the kernel is stretched over proportionally more
+// frames (up to KARMA_SINC_STRETCH times the taps) so the same table is also the
+// anti-aliasing low-pass. Coefficients are normalized to unity DC gain.
+//
+// Per output sample the coefficients are computed once for all channels; the
+// dot product then runs over whole frames (SSE2 / NEON for 2 and 4 channels,
+// like the ipoke kernels). Frame indices wrap within the loop by the same rule
+// interp_index uses for its four neighbours.
+//
+// karma_sinc_init builds the tables (control thread: karma_core_init calls it;
+// idempotent). Include AFTER karma_core.h (standalone build) like the other
+// kernel headers.
+
+#ifndef KARMA_SINC_H
+#define KARMA_SINC_H
+
+#include "karma_ipoke.h"    // KARMA_IPOKE_SSE2 / KARMA_IPOKE_NEON
+#include "karma_multiply.h" // mul_resolve
+
+#define KARMA_SINC_TAPS_MIN 8
+#define KARMA_SINC_TAPS_MAX 32
+#define KARMA_SINC_PHASES   512                 // table points per tap
+#define KARMA_SINC_STRETCH  4                   // cutoff follows speed down to 1/4
+#define KARMA_SINC_MAXN     (KARMA_SINC_TAPS_MAX * KARMA_SINC_STRETCH)
+#define KARMA_SINC_BETA     8.0                 // Kaiser window shape
+#define KARMA_SINC_ROLLOFF  0.9                 // passband edge, fraction of Nyquist
+
+// half kernels for 8, 16 and 32 taps: x = i / PHASES for i = 0 .. taps/2 * PHASES,
+// then zeros for one more tap (the outermost coefficient of a stretched kernel
+// can land up to one tap past the window) plus a guard point
+static float   sinc_half[3][(KARMA_SINC_TAPS_MAX / 2 + 1) * KARMA_SINC_PHASES + 2];
+static t_bool  sinc_ready;
+
+static inline int sinc_slot(int64_t taps)
+{
+    return (taps <= 8) ? 0 : ((taps <= 16) ? 1 : 2);
+}
+
+static double sinc_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, q = 0.25 * x * x;
+    int k;
+
+    for (k = 1; k < 64; k++) {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-17)
+            break;
+    }
+    return sum;
+}
+
+static void karma_sinc_init(void)
+{
+    int s, i, half, n;
+    double x, r, w, norm = sinc_bessel_i0(KARMA_SINC_BETA);
+
+    if (sinc_ready)
+        return;
+    for (s = 0; s < 3; s++) {
+        half = (KARMA_SINC_TAPS_MIN << s) / 2;
+        n = half * KARMA_SINC_PHASES;
+        for (i = 0; i <= n; i++) {
+            x = (double)i / KARMA_SINC_PHASES;
+            r = x / half;
+            w = sinc_bessel_i0(KARMA_SINC_BETA * sqrt((r < 1.0) ? (1.0 - r * r) : 0.0)) / norm;
+            sinc_half[s][i] = (float)(((i == 0) ? 1.0 : (sin(PI * KARMA_SINC_ROLLOFF * x) / (PI * KARMA_SINC_ROLLOFF * x))) * w);
+        }
+        for (i = n; i < n + KARMA_SINC_PHASES + 2; i++)
+            sinc_half[s][i] = 0.0f;             // window edge on
+    }
+    sinc_ready = 1;
+}
+
+// the kernel at table position u = distance * PHASES (0 <= u < (half + 1) * PHASES)
+static inline double sinc_lookup(const float *h, double u)
+{
+    int i = (int)u;
+
+    return h[i] + (u - (double)i) * (h[i + 1] - h[i]);
+}
+
+// coefficients for the frames k0 .. k0 + n - 1 around a position d (0 <= d < 1)
+// past frame 0, at head step |step|; returns n and sets *k0
+static inline int sinc_coeffs(double *c, int64_t taps, double d, double step, int *k0)
+{
+    const float *h = sinc_half[sinc_slot(taps)];
+    int64_t half = (taps <= 8) ? 4 : ((taps <= 16) ? 8 : 16);
+    double fc = (step > 1.0) ? (1.0 / step) : 1.0, sum = 0.0, scale, x;
+    int n, k;
+
+    if (fc < 1.0 / KARMA_SINC_STRETCH)
+        fc = 1.0 / KARMA_SINC_STRETCH;
+    n = 2 * (int)ceil((double)half / fc);
+    *k0 = -(n / 2 - 1);
+    scale = fc * KARMA_SINC_PHASES;
+    x = (double)*k0 - d;
+    for (k = 0; k < n; k++, x += 1.0) {
+        c[k] = sinc_lookup(h, fabs(x) * scale);
+        sum += c[k];
+    }
+    sum = 1.0 / sum;
+    for (k = 0; k < n; k++)
+        c[k] *= sum;
+    return n;
+}
+
+// a frame index outside the loop, brought back in (interp_index's rule; clamped
+// to the buffer for loops shorter than the kernel)
+static inline int64_t sinc_wrap(int64_t i, char directionorig, int64_t maxloop, int64_t framesm1)
+{
+    if (directionorig >= 0) {
+        if (i < 0)
+            i = (maxloop + 1) + i;
+        else if (i > maxloop)
+            i = i - (maxloop + 1);
+    } else {
+        if (i < (framesm1 - maxloop))
+            i = framesm1 - ((framesm1 - maxloop) - i);
+        else if (i > framesm1)
+            i = (framesm1 - maxloop) + (i - framesm1);
+    }
+    return CLAMP(i, 0, framesm1);
+}
+
+// out[ch] = sum over k of c[k] * b[idx[k] * pstride + ch], ch < nproc
+static inline void sinc_dot(double *out, const float *b, int64_t pstride, int64_t nproc, const int64_t *idx, const double *c, int n)
+{
+    const float *f;
+    int64_t ch;
+    int k;
+
+#if defined(KARMA_IPOKE_SSE2)
+    if (nproc == 2) {
+        __m128d acc = _mm_setzero_pd();
+        for (k = 0; k < n; k++) {
+            f = b + idx[k] * pstride;
+            acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(c[k]), _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)f)))));
+        }
+        _mm_storeu_pd(out, acc);
+        return;
+    }
+    if (nproc == 4) {
+        __m128d a01 = _mm_setzero_pd(), a23 = _mm_setzero_pd(), ck;
+        __m128 v;
+        for (k = 0; k < n; k++) {
+            f = b + idx[k] * pstride;
+            v = _mm_loadu_ps(f);
+            ck = _mm_set1_pd(c[k]);
+            a01 = _mm_add_pd(a01, _mm_mul_pd(ck, _mm_cvtps_pd(v)));
+            a23 = _mm_add_pd(a23, _mm_mul_pd(ck, _mm_cvtps_pd(_mm_movehl_ps(v, v))));
+        }
+        _mm_storeu_pd(out, a01);
+        _mm_storeu_pd(out + 2, a23);
+        return;
+    }
+#elif defined(KARMA_IPOKE_NEON)
+    if (nproc == 2) {
+        float64x2_t acc = vdupq_n_f64(0.0);
+        for (k = 0; k < n; k++) {
+            f = b + idx[k] * pstride;
+            acc = vfmaq_n_f64(acc, vcvt_f64_f32(vld1_f32(f)), c[k]);
+        }
+        vst1q_f64(out, acc);
+        return;
+    }
+    if (nproc == 4) {
+        float64x2_t a01 = vdupq_n_f64(0.0), a23 = vdupq_n_f64(0.0);
+        float32x4_t v;
+        for (k = 0; k < n; k++) {
+            f = b + idx[k] * pstride;
+            v = vld1q_f32(f);
+            a01 = vfmaq_n_f64(a01, vcvt_f64_f32(vget_low_f32(v)), c[k]);
+            a23 = vfmaq_n_f64(a23, vcvt_high_f64_f32(v), c[k]);
+        }
+        vst1q_f64(out, a01);
+        vst1q_f64(out + 2, a23);
+        return;
+    }
+#endif
+    for (ch = 0; ch < nproc; ch++)
+        out[ch] = 0.0;
+    for (k = 0; k < n; k++) {
+        f = b + idx[k] * pstride;
+        for (ch = 0; ch < nproc; ch++)
+            out[ch] += c[k] * (double)f[ch];
+    }
+}
+
+// osamp[0 .. nproc-1] at the play position: accuratehead forward, one frame
+// behind it in reverse (where the reference's frac = 1 - (accuratehead - playhead)
+// reads from), playhead when stopped. mul: resolve through a multiplied loop's
+// virtual extension (or NULL).
+static inline void sinc_read(double *osamp, const float *b, int64_t pstride, int64_t nproc, int64_t taps, double accuratehead, int64_t playhead, double step,
+                             char direction, char directionorig, int64_t maxloop, int64_t framesm1, const karma_multiply_state *mul)
+{
+    double c[KARMA_SINC_MAXN];
+    int64_t idx[KARMA_SINC_MAXN], base, lo, hi;
+    double d;
+    int n, k, k0;
+
+    if (direction > 0) {
+        base = playhead;
+        d = accuratehead - playhead;
+    } else if (direction < 0) {
+        base = playhead - 1;
+        d = accuratehead - playhead;
+    } else {
+        base = playhead;
+        d = 0.0;
+    }
+    n = sinc_coeffs(c, taps, d, fabs(step), &k0);
+    base += k0;
+    lo = (directionorig >= 0) ? 0 : (framesm1 - maxloop);
+    hi = (directionorig >= 0) ? maxloop : framesm1;
+    if (!mul && (base >= lo) && (base + n - 1 <= hi)) {     // inside the loop: no wrap
+        for (k = 0; k < n; k++)
+            idx[k] = base + k;
+    } else {
+        for (k = 0; k < n; k++) {
+            idx[k] = sinc_wrap(base + k, directionorig, maxloop, framesm1);
+            if (mul)
+                idx[k] = mul_resolve(mul, idx[k]);
+        }
+    }
+    sinc_dot(osamp, b, pstride, nproc, idx, c, n);
+}
+
+#endif // KARMA_SINC_H
@@ -0,0 +1,260 @@
+// karma_snapshot.c -- snapshot files: an instance's state plus its buffer.
+// See karma_snapshot.h for the format and the threading model.
+
+#include "karma_core.h"
+#include "karma_snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define snapshot_seek(f, off)   _fseeki64((f), (off), SEEK_SET)
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define snapshot_seek(f, off)   fseeko((f), (off_t)(off), SEEK_SET)
+#endif
+
+#define SNAPSHOT_HEADER 64
+static const char snapshot_magic[8] = { 'K', 'A', 'R', 'M', 'A', 'S', 'N', 'P' };
+
+// the state record: karma_snap without the buffer interface and the flag
+typedef struct {
+    karma_state st;
+    double  speedfloat, overdubamp, jumphead, selstart, selection;
+    int64_t choffset, chcount;
+    t_bool  recordinit, stopallowed;
+    char    statehuman;
+} snapshot_record;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version, recsize;
+    uint64_t frames, chans;
+    double   sr;
+    uint64_t dataoff;
+    char     pad[SNAPSHOT_HEADER - 48];
+} snapshot_header;
+
+struct karma_snapshot {
+    karma_snap  snap;
+    float      *data;               // the mapped buffer section (NULL once copied out)
+    void       *map;
+    size_t      maplen;
+#ifdef _WIN32
+    HANDLE      file, mapping;
+#endif
+};
+
+static uint64_t snapshot_dataoff(void)
+{
+    return ((SNAPSHOT_HEADER + sizeof(snapshot_record)) + KARMA_SNAPSHOT_ALIGN - 1) & ~(uint64_t)(KARMA_SNAPSHOT_ALIGN - 1);
+}
+
+// ---- the mapped buffer's interface --------------------------------------------
+static void *snapshot_lock(void *ctx)   { return ((karma_snapshot *)ctx)->data; }
+static void  snapshot_unlock(void *ctx) { (void)ctx; }
+static void  snapshot_dirty(void *ctx)  { (void)ctx; }
+
+// ---- save ---------------------------------------------------------------------
+int karma_core_save(const karma_snap *r, const char *path)
+{
+    snapshot_header h;
+    snapshot_record rec;
+    const karma_buffer_iface *io = &r->bufio;
+    int64_t frames = io->frames, chans = io->chans, start, n;
+    float *bounce, *b;
+    FILE *f;
+    int err = 0;
+
+    if (!path || !io->lock || !io->unlock || (frames <= 0) || (chans <= 0))
+        return -1;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, snapshot_magic, sizeof(h.magic));
+    h.version = KARMA_SNAPSHOT_VERSION;
+    h.recsize = (uint32_t)sizeof(snapshot_record);
+    h.frames  = (uint64_t)frames;
+    h.chans   = (uint64_t)chans;
+    h.sr      = io->sr;
+    h.dataoff = snapshot_dataoff();
+    memset(&rec, 0, sizeof(rec));   // (padding included: the same state, the same bytes)
+    rec.st          = r->st;
+    rec.speedfloat  = r->speedfloat;
+    rec.overdubamp  = r->overdubamp;
+    rec.jumphead    = r->jumphead;
+    rec.selstart    = r->selstart;
+    rec.selection   = r->selection;
+    rec.choffset    = r->choffset;
+    rec.chcount     = r->chcount;
+    rec.recordinit  = r->recordinit;
+    rec.stopallowed = r->stopallowed;
+    rec.statehuman  = r->statehuman;
+
+    bounce = (float *)malloc((size_t)(KARMA_SNAPSHOT_CHUNK * chans) * sizeof(float));
+    f = fopen(path, "wb");
+    if (!bounce || !f || (fwrite(&h, sizeof(h), 1, f) != 1) || (fwrite(&rec, sizeof(rec), 1, f) != 1)
+        || snapshot_seek(f, h.dataoff))
+        err = -1;
+    for (start = 0; !err && (start < frames); start += n) {
+        n = (frames - start < KARMA_SNAPSHOT_CHUNK) ? (frames - start) : KARMA_SNAPSHOT_CHUNK;
+        b = (float *)io->lock(io->ctx);
+        if (!b) {
+            err = -1;
+            break;
+        }
+        memcpy(bounce, b + start * chans, (size_t)(n * chans) * sizeof(float));
+        io->unlock(io->ctx);
+        if (fwrite(bounce, sizeof(float), (size_t)(n * chans), f) != (size_t)(n * chans))
+            err = -1;
+    }
+    if (f && fclose(f))
+        err = -1;
+    free(bounce);
+    if (err)
+        remove(path);
+    return err;
+}
+
+// ---- load ---------------------------------------------------------------------
+static int snapshot_map(karma_snapshot *s, const char *path)
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    s->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (s->file == INVALID_HANDLE_VALUE)
+        return -1;
+    if (!GetFileSizeEx(s->file, &size) || (size.QuadPart < SNAPSHOT_HEADER))
+        return -1;
+    s->mapping = CreateFileMappingA(s->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!s->mapping)
+        return -1;
+    s->map = MapViewOfFile(s->mapping, FILE_MAP_COPY, 0, 0, 0);
+    s->maplen = (size_t)size.QuadPart;
+    return s->map ? 0 : -1;
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    void *m;
+
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) || (st.st_size < SNAPSHOT_HEADER)) {
+        close(fd);
+        return -1;
+    }
+    m = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);                      // (the mapping keeps the file)
+    if (m == MAP_FAILED)
+        return -1;
+    s->map = m;
+    s->maplen = (size_t)st.st_size;
+    return 0;
+#endif
+}
+
+static void snapshot_unmap(karma_snapshot *s)
+{
+#ifdef _WIN32
+    if (s->map) UnmapViewOfFile(s->map);
+    if (s->mapping) CloseHandle(s->mapping);
+    if (s->file && (s->file != INVALID_HANDLE_VALUE)) CloseHandle(s->file);
+    s->mapping = s->file = NULL;
+#else
+    if (s->map) munmap(s->map, s->maplen);
+#endif
+    s->map = NULL;
+    s->data = NULL;
+}
+
+karma_snapshot *karma_core_load(const char *path, const karma_buffer_iface *io)
+{
+    karma_snapshot *s;
+    snapshot_header h;
+    snapshot_record rec;
+    int64_t frames, chans, start, n;
+    float *b;
+
+    if (!path)
+        return NULL;
+    s = (karma_snapshot *)calloc(1, sizeof(karma_snapshot));
+    if (!s)
+        return NULL;
+    if (snapshot_map(s, path))
+        goto fail;
+    memcpy(&h, s->map, sizeof(h));
+    if (memcmp(h.magic, snapshot_magic, sizeof(h.magic)) || (h.version != KARMA_SNAPSHOT_VERSION)
+        || (h.recsize != sizeof(snapshot_record)) || (h.dataoff != snapshot_dataoff())
+        || !h.frames || !h.chans || (h.frames > (uint64_t)LONG_MAX) || (h.chans > 64)
+        || (h.dataoff + h.frames * h.chans * sizeof(float) > (uint64_t)s->maplen))
+        goto fail;
+    memcpy(&rec, (const char *)s->map + SNAPSHOT_HEADER, sizeof(rec));
+    frames  = (int64_t)h.frames;
+    chans   = (int64_t)h.chans;
+    s->data = (float *)((char *)s->map + h.dataoff);
+
+    s->snap.st          = rec.st;
+    s->snap.speedfloat  = rec.speedfloat;
+    s->snap.overdubamp  = rec.overdubamp;
+    s->snap.jumphead    = rec.jumphead;
+    s->snap.selstart    = rec.selstart;
+    s->snap.selection   = rec.selection;
+    s->snap.choffset    = rec.choffset;
+    s->snap.chcount     = rec.chcount;
+    s->snap.recordinit  = rec.recordinit;
+    s->snap.stopallowed = rec.stopallowed;
+    s->snap.statehuman  = rec.statehuman;
+
+    if (io) {                       // into the host's buffer, then let the file go
+        if ((io->frames != frames) || (io->chans != chans) || !io->lock || !io->unlock)
+            goto fail;
+        for (start = 0; start < frames; start += n) {
+            n = (frames - start < KARMA_SNAPSHOT_CHUNK) ? (frames - start) : KARMA_SNAPSHOT_CHUNK;
+            b = (float *)io->lock(io->ctx);
+            if (!b)
+                goto fail;
+            memcpy(b + start * chans, s->data + start * chans, (size_t)(n * chans) * sizeof(float));
+            if (io->set_dirty_range)
+                io->set_dirty_range(io->ctx, (long)start, (long)n);
+            else if (io->set_dirty)
+                io->set_dirty(io->ctx);
+            io->unlock(io->ctx);
+        }
+        s->snap.bufio = *io;
+        snapshot_unmap(s);
+    } else {                        // run on the mapping: read ahead, don't wait for it
+#ifndef _WIN32
+        posix_madvise((char *)s->map + h.dataoff, (size_t)(frames * chans) * sizeof(float), POSIX_MADV_WILLNEED);
+#endif
+        s->snap.bufio.lock      = snapshot_lock;
+        s->snap.bufio.unlock    = snapshot_unlock;
+        s->snap.bufio.set_dirty = snapshot_dirty;
+        s->snap.bufio.set_dirty_range = NULL;
+        s->snap.bufio.ctx       = s;
+        s->snap.bufio.frames    = (long)frames;
+        s->snap.bufio.chans     = (long)chans;
+        s->snap.bufio.sr        = h.sr;
+    }
+    return s;
+
+fail:
+    karma_snapshot_free(s);
+    return NULL;
+}
+
+karma_snap *karma_snapshot_snap(karma_snapshot *s)
+{
+    return &s->snap;
+}
+
+void karma_snapshot_free(karma_snapshot *s)
+{
+    if (!s)
+        return;
+    snapshot_unmap(s);
+    free(s);
+}
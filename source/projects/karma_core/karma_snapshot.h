@@ -0,0 +1,56 @@
+// karma_snapshot.h -- snapshot files: an instance's state plus its buffer.
+//
+// A standalone companion to the core, like karma_persist: it writes what
+// karma_core_snap took (the perform state, the loop's placement and the whole
+// buffer the instance runs on) to a versioned binary file, and prepares such a
+// file for karma_core_recall -- off the audio thread, so the recall itself is
+// the core's one-step swap at the next vector boundary.
+//
+// File (little-endian, native float): a 64-byte header (magic, version, the
+// state record's size, frames, channels, sample rate, data offset), the state
+// record, then the buffer as interleaved float32 at an offset aligned to
+// KARMA_SNAPSHOT_ALIGN -- so the buffer section maps straight from the file.
+// A file from another version or build layout (record size) is refused.
+//
+// karma_core_load with io NULL maps the file copy-on-write and the instance runs
+// on the mapping: nothing is read up front (pages come in as the loop plays,
+// with a read-ahead hint), and recording into it never changes the file. With
+// an io (a Max buffer~, a host's array) of the same frames and channels the
+// buffer section is copied into it instead, and the instance is recalled onto
+// that buffer -- one no instance is playing while the copy runs (a spare, or the
+// instance's own with its DSP off), or it hears the copy arrive.
+//
+// Threads: karma_core_save / karma_core_load / karma_snapshot_free on any
+// thread but the audio thread. A snapshot handed to karma_core_recall must
+// outlive the instance's use of its buffer (until it is recalled onto another).
+//
+// Needs mmap (POSIX) or file mappings (Win32). Little-endian hosts.
+// Include AFTER karma_core_api.h (for karma_snap).
+
+#ifndef KARMA_SNAPSHOT_H
+#define KARMA_SNAPSHOT_H
+
+#define KARMA_SNAPSHOT_VERSION  1
+#define KARMA_SNAPSHOT_ALIGN    65536   // buffer section offset (any page size / Win32 granularity)
+#define KARMA_SNAPSHOT_CHUNK    16384   // frames copied per lock of a buffer
+
+typedef struct karma_snapshot karma_snapshot;
+
+// Write r (taken by karma_core_snap, once r->done, or karma_core_snap_now with
+// DSP off) and the buffer r->bufio describes to `path`. The buffer is read under
+// its lock a chunk at a time; frames written meanwhile may be either version.
+// Returns 0 on success.
+int karma_core_save(const karma_snap *r, const char *path);
+
+// Read and check `path`, map or copy its buffer (see above) and return a
+// snapshot whose karma_snapshot_snap() is ready for karma_core_recall. NULL on
+// I/O failure, a bad or foreign file, or an io of other dimensions.
+karma_snapshot *karma_core_load(const char *path, const karma_buffer_iface *io);
+
+karma_snap *karma_snapshot_snap(karma_snapshot *s);
+
+// Unmap and free. Only once no instance runs on its buffer (or it was loaded
+// into an io) and no recall of it is pending.
+void karma_snapshot_free(karma_snapshot *s);
+
+#endif // KARMA_SNAPSHOT_H
@@ -0,0 +1,128 @@
+// karma_undo.h -- copy-on-write layer history for undo / redo.
+//
+// The buffer is split into pages of KARMA_UNDO_PAGE frames. A *layer* is one
+// stretch of recording (it opens at the first write and closes at the first
+// vector that starts with record and recordprev both off). The first time a
+// layer is about to write a page, the page's current contents (all of the
+// instance's channels) are copied into a slot of a pool the host preallocated
+// -- the audio thread never allocates. Undo then swaps each page the top layer touched with its
+// saved copy, which leaves the layer's own output in the slot for redo: both
+// are O(pages touched), and memory use follows what was actually overdubbed,
+// capped by the pool.
+//
+// The pool is a circular log. When it fills, the oldest layers are dropped
+// (no longer undoable) to make room; a single layer bigger than the whole pool
+// is marked lost and will not undo. Recording after an undo discards the redo
+// history, and so does the whole-buffer clear of a fresh initial record.
+//
+// Undo restores audio only: loop points set by an initial record stay put.
+//
+// Capture is driven from karma_dirty_add, which every buffer writer in the
+// perform routine calls before it writes; undo / redo / reset are requests
+// the control thread posts and the perform routine services at the start of
+// its next vector (like jump / stop), so the history is only ever touched from
+// the audio thread. The requests are C11 atomics: posted with release, taken
+// (and cleared in the same step) with acquire, so none is lost between the two.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_UNDO_H
+#define KARMA_UNDO_H
+
+#include <stdatomic.h>
+
+#define KARMA_UNDO_SHIFT    10                          // 1024-frame pages
+#define KARMA_UNDO_PAGE     (1 << KARMA_UNDO_SHIFT)
+#define KARMA_UNDO_LAYERS   32                          // history depth (power of two)
+
+enum {
+    UNDO_REQ_NONE   = 0,
+    UNDO_REQ_UNDO   = 1,
+    UNDO_REQ_REDO   = 2
+};
+
+typedef struct karma_undo {
+    float   *b;                 // first channel of the view, this vector (set by perform)
+    int64_t  stride;            // floats per buffer frame (>= chans; set by perform)
+    float   *pool;              // npool slots of KARMA_UNDO_PAGE * chans floats
+    int64_t *slotpage;          // buffer page saved in each slot
+    int64_t *stamp;             // per buffer page: epoch of the layer that saved it
+    int64_t  frames, chans, npages, npool;
+    int64_t  tail, head;        // live log positions [tail, head); slot = pos % npool
+    int64_t  start[KARMA_UNDO_LAYERS];  // log position where layer L begins (L % LAYERS)
+    t_bool   lost[KARMA_UNDO_LAYERS];   // layer L ran out of pool
+    int64_t  first, applied, next;      // layers [first, next); [first, applied) are in the buffer
+    int64_t  epoch;             // stamp of the open (or next) layer; bumped at close
+    t_bool   open;              // a layer is recording
+    atomic_char     request;    // UNDO_REQ_*, posted by the control thread
+    atomic_bool     reset;      // drop all history (buffer cleared under it)
+} karma_undo_state;
+
+// log position one past layer L
+static inline int64_t undo_layer_end(const karma_undo_state *u, int64_t L)
+{
+    return (L + 1 < u->next) ? u->start[(L + 1) & (KARMA_UNDO_LAYERS - 1)] : u->head;
+}
+
+static inline int64_t undo_page_frames(const karma_undo_state *u, int64_t page)
+{
+    int64_t n = u->frames - (page << KARMA_UNDO_SHIFT);
+    return (n < KARMA_UNDO_PAGE) ? n : KARMA_UNDO_PAGE;
+}
+
+static void undo_capture(karma_undo_state *u, int64_t page)
+{
+    int64_t L;
+
+    if (!u->open) {                                     // first write of a new layer
+        if (u->applied < u->next) {                     // recording after undo: drop redo
+            u->head = u->start[u->applied & (KARMA_UNDO_LAYERS - 1)];
+            u->next = u->applied;
+        }
+        if (u->next - u->first == KARMA_UNDO_LAYERS) {  // history full: forget the oldest
+            u->first++;
+            u->tail = u->start[u->first & (KARMA_UNDO_LAYERS - 1)];
+        }
+        L = u->next++;
+        u->start[L & (KARMA_UNDO_LAYERS - 1)] = u->head;
+        u->lost[L & (KARMA_UNDO_LAYERS - 1)] = 0;
+        u->applied = u->next;
+        u->open = 1;
+    }
+    L = u->next - 1;
+    u->stamp[page] = u->epoch;
+
+    while ((u->head - u->tail == u->npool) && (u->first < L)) {    // pool full: drop oldest
+        u->first++;
+        u->tail = u->start[u->first & (KARMA_UNDO_LAYERS - 1)];
+    }
+    if (u->head - u->tail == u->npool) {
+        u->lost[L & (KARMA_UNDO_LAYERS - 1)] = 1;
+        return;
+    }
+    int64_t slot = u->head % u->npool, n = undo_page_frames(u, page), f;
+    float *dst = u->pool + slot * KARMA_UNDO_PAGE * u->chans;
+    const float *src = u->b + (page << KARMA_UNDO_SHIFT) * u->stride;
+
+    if (u->stride == u->chans)                          // the whole buffer is ours
+        memcpy(dst, src, (size_t)(n * u->chans) * sizeof(float));
+    else                                                // a channel view of a wider one
+        for (f = 0; f < n; f++)
+            memcpy(dst + f * u->chans, src + f * u->stride, (size_t)u->chans * sizeof(float));
+    u->slotpage[slot] = page;
+    u->head++;
+}
+
+// called with every range about to be written (frames lo..hi inclusive)
+static inline void karma_undo_touch(karma_undo_state *u, int64_t lo, int64_t hi)
+{
+    int64_t p = (lo < 0) ? 0 : (lo >> KARMA_UNDO_SHIFT), last = hi >> KARMA_UNDO_SHIFT;
+
+    if (last >= u->npages)
+        last = u->npages - 1;
+    for (; p <= last; p++)
+        if (u->stamp[p] != u->epoch)
+            undo_capture(u, p);
+}
+
+#endif // KARMA_UNDO_H
@@ -0,0 +1,303 @@
+// karma_voices.h -- extra read-only playheads on the instance's loop.
+//
+// Layering a loop used to take one karma instance per layer, each on the same
+// buffer with its own lock, state machine and per-sample record logic that a
+// pure reader never uses. A voice is only the reader: a head with its own
+// speed, window (start and size as fractions of the loop), interpolation
+// (linear / cubic / spline) and switch-and-ramp declick. It reads whatever
+// loop the primary head recorded -- minloop / maxloop / directionorig as they
+// stand at the end of each vector, the multiply extension included -- and is
+// silent while there is none (during the initial record).
+//
+// All voices run at the end of the instance's perform vector, under the lock it
+// already holds. They render in blocks of KARMA_VOICES_BLOCK samples, voice by
+// voice, into one double mix per channel. Perform adds that mix to its outputs.
+// A voice's reads in a block are a few neighbouring frames apart, so they stay
+// in cache from one sample to the next.
+//
+// A voice declicks every discontinuity with the instance's snrramp / snrtype:
+// play and stop, a jump, a window change, the wrap of a window shorter than
+// the loop, and the loop appearing or going away under it. Gain ramps
+// linearly across a vector.
+//
+// Host-owned and sized for the view's channels (ignored while they differ);
+// the controls (karma_voice_*) take effect at the next vector.
+//
+// Include AFTER karma_core.h (standalone build) like the other kernel headers.
+
+#ifndef KARMA_VOICES_H
+#define KARMA_VOICES_H
+
+#include "karma_interp.h"   // kernels + interp_index
+#include "karma_ipoke.h"    // ease_switchramp, KARMA_IPOKE_SSE2 / KARMA_IPOKE_NEON
+#include "karma_multiply.h" // mul_resolve
+#include <stdatomic.h>
+
+#define KARMA_VOICES_BLOCK  64                  // samples rendered per voice per pass
+
+typedef struct karma_voice {
+    // set by the control thread
+    volatile double speed, start, size, gain;   // start / size: fractions of the loop
+    _Atomic double  jump;                       // position in the window to jump to (< 0: none)
+    volatile int64_t interp;                    // 0 linear, 1 cubic, 2 spline
+    volatile t_bool play;
+    // carried by perform
+    double  head;                               // frames into the window
+    double  ws, wl;                             // the window it is playing (frames)
+    double  gprev, gnext, snrfade;              // gain: last vector's end, this one's
+    double  oprev[4], odif[4];
+    t_bool  on;                                 // sounding last vector
+} karma_voice;
+
+typedef struct karma_voices {
+    int64_t      count, chans;
+    karma_voice *v;
+} karma_voices_state;
+
+// the loop the voices read this vector
+typedef struct karma_voice_loop {
+    const float *b;                             // the view's first channel
+    int64_t stride, nproc, maxloop, fm1;
+    const karma_multiply_state *mul;            // NULL: no mapping
+    double  base, len;                          // loop start frame and length
+    double  srscale, snrstep;                   // snrstep: 1 / snrramp (0: no declick)
+    int64_t snrtype;
+    char    directionorig;
+} karma_voice_loop;
+
+// any voice sounding or ramping out (the instance can't go dormant)
+static inline t_bool voices_busy(const karma_voices_state *vs)
+{
+    int64_t k;
+
+    for (k = 0; k < vs->count; k++)
+        if (vs->v[k].play || vs->v[k].on || (vs->v[k].snrfade < 1.0))
+            return 1;
+    return 0;
+}
+
+// Top of a vector: take the controls. A voice that starts or stops, jumps or
+// changes window restarts its ramp; ready = the loop exists.
+static void voice_begin(karma_voice *v, const karma_voice_loop *lp, t_bool ready)
+{
+    double ws, wl, j;
+    t_bool on = v->play && ready;
+
+    ws = v->start;
+    wl = v->size;
+    ws = (ws > 0.0) ? ((ws < 1.0) ? ws * lp->len : 0.0) : 0.0;
+    wl = (wl > 0.0) ? ((wl < 1.0) ? wl * lp->len : lp->len) : lp->len;
+    if (wl < 1.0)
+        wl = 1.0;
+    if (on != v->on)
+        v->snrfade = 0.0;
+    if (on && v->on && ((ws != v->ws) || (wl != v->wl)))
+        v->snrfade = 0.0;
+    if (on && !v->on)
+        v->head = (v->speed < 0.0) ? (wl - 1.0) : 0.0;
+    j = atomic_load_explicit(&v->jump, memory_order_relaxed);    // no RMW on quiet vectors
+    if (j >= 0.0 && (j = atomic_exchange_explicit(&v->jump, -1.0, memory_order_acquire)) >= 0.0) {
+        v->head = ((j < 1.0) ? j : 0.0) * wl;
+        if (on)
+            v->snrfade = 0.0;
+    }
+    if (v->head >= wl)
+        v->head = 0.0;
+    v->ws = ws;
+    v->wl = wl;
+    v->on = on;
+    v->gnext = v->gain;
+    if (lp->snrstep == 0.0)
+        v->snrfade = 1.0;
+}
+
+#if defined(KARMA_IPOKE_SSE2)
+// The kernels on a pair of channels, in the scalar macros' operation order --
+// including their float subtractions (y - x of two samples is float in C).
+typedef __m128 voice_f2;                    // two samples (low lanes)
+typedef __m128d voice_d2;
+#define voice_load2(p)      _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)(p)))
+#define voice_wide(a)       _mm_cvtps_pd(a)
+#define voice_subf(a, b)    _mm_sub_ps(a, b)
+#define voice_add(a, b)     _mm_add_pd(a, b)
+#define voice_sub(a, b)     _mm_sub_pd(a, b)
+#define voice_mul(a, b)     _mm_mul_pd(a, b)
+#define voice_set(k)        _mm_set1_pd(k)
+#elif defined(KARMA_IPOKE_NEON)
+typedef float32x2_t voice_f2;
+typedef float64x2_t voice_d2;
+#define voice_load2(p)      vld1_f32(p)
+#define voice_wide(a)       vcvt_f64_f32(a)
+#define voice_subf(a, b)    vsub_f32(a, b)
+#define voice_add(a, b)     vaddq_f64(a, b)
+#define voice_sub(a, b)     vsubq_f64(a, b)
+#define voice_mul(a, b)     vmulq_f64(a, b)
+#define voice_set(k)        vdupq_n_f64(k)
+#endif
+
+#if defined(KARMA_IPOKE_SSE2) || defined(KARMA_IPOKE_NEON)
+static inline voice_d2 voice_linear2(voice_d2 f, voice_f2 x, voice_f2 y)
+{
+    return voice_add(voice_wide(x), voice_mul(f, voice_wide(voice_subf(y, x))));
+}
+
+static inline voice_d2 voice_cubic2(voice_d2 f, voice_f2 w, voice_f2 x, voice_f2 y, voice_f2 z)
+{
+    voice_d2 wd = voice_wide(w), xd = voice_wide(x), yd = voice_wide(y), zd = voice_wide(z);
+    voice_d2 c3 = voice_add(voice_mul(voice_set(0.5), voice_wide(voice_subf(z, w))), voice_mul(voice_set(1.5), voice_wide(voice_subf(x, y))));
+    voice_d2 c2 = voice_sub(voice_add(voice_add(voice_sub(wd, voice_mul(voice_set(2.5), xd)), yd), yd), voice_mul(voice_set(0.5), zd));
+    voice_d2 c1 = voice_mul(voice_set(0.5), voice_wide(voice_subf(y, w)));
+    return voice_add(voice_mul(voice_add(voice_mul(voice_add(voice_mul(c3, f), c2), f), c1), f), xd);
+}
+
+static inline voice_d2 voice_spline2(voice_d2 f, voice_f2 w, voice_f2 x, voice_f2 y, voice_f2 z)
+{
+    voice_d2 wd = voice_wide(w), xd = voice_wide(x), yd = voice_wide(y), zd = voice_wide(z);
+    voice_d2 c3 = voice_add(voice_sub(voice_add(voice_mul(voice_set(-0.5), wd), voice_mul(voice_set(1.5), xd)), voice_mul(voice_set(1.5), yd)), voice_mul(voice_set(0.5), zd));
+    voice_d2 c2 = voice_sub(voice_add(voice_add(voice_sub(wd, voice_mul(voice_set(2.5), xd)), yd), yd), voice_mul(voice_set(0.5), zd));
+    voice_d2 c1 = voice_add(voice_mul(voice_set(-0.5), wd), voice_mul(voice_set(0.5), yd));
+    return voice_add(voice_add(voice_add(voice_mul(voice_mul(voice_mul(c3, f), f), f), voice_mul(voice_mul(c2, f), f)), voice_mul(c1, f)), xd);
+}
+#endif
+
+// sv[c][i] = the kernel at taps t0..t3 (frame offsets) and frac fr, for the
+// nproc channels (2 and 4: a pair of channels per operation with SSE2 / NEON)
+static inline void voice_read(double sv[][KARMA_VOICES_BLOCK], const float *b, int64_t nproc, int64_t interp,
+                              const int64_t *t0, const int64_t *t1, const int64_t *t2, const int64_t *t3, const double *fr, long n)
+{
+    int64_t c;
+    long i;
+
+#if defined(KARMA_IPOKE_SSE2) || defined(KARMA_IPOKE_NEON)
+    if ((nproc == 2) || (nproc == 4)) {
+        for (c = 0; c < nproc; c += 2) {
+            const float *bc = b + c;
+            for (i = 0; i < n; i++) {
+                voice_d2 f = voice_set(fr[i]), r;
+                if (interp == 0)
+                    r = voice_linear2(f, voice_load2(bc + t1[i]), voice_load2(bc + t2[i]));
+                else if (interp == 2)
+                    r = voice_spline2(f, voice_load2(bc + t0[i]), voice_load2(bc + t1[i]), voice_load2(bc + t2[i]), voice_load2(bc + t3[i]));
+                else
+                    r = voice_cubic2(f, voice_load2(bc + t0[i]), voice_load2(bc + t1[i]), voice_load2(bc + t2[i]), voice_load2(bc + t3[i]));
+#if defined(KARMA_IPOKE_SSE2)
+                _mm_storel_pd(&sv[c][i], r);
+                _mm_storeh_pd(&sv[c + 1][i], r);
+#else
+                sv[c][i] = vgetq_lane_f64(r, 0);
+                sv[c + 1][i] = vgetq_lane_f64(r, 1);
+#endif
+            }
+        }
+        return;
+    }
+#endif
+    for (c = 0; c < nproc; c++) {
+        const float *bc = b + c;
+        if (interp == 0)
+            for (i = 0; i < n; i++)
+                sv[c][i] = LINEAR_INTERP(fr[i], bc[t1[i]], bc[t2[i]]);
+        else if (interp == 2)
+            for (i = 0; i < n; i++)
+                sv[c][i] = SPLINE_INTERP(fr[i], bc[t0[i]], bc[t1[i]], bc[t2[i]], bc[t3[i]]);
+        else
+            for (i = 0; i < n; i++)
+                sv[c][i] = CUBIC_INTERP(fr[i], bc[t0[i]], bc[t1[i]], bc[t2[i]], bc[t3[i]]);
+    }
+}
+
+// n (<= KARMA_VOICES_BLOCK) samples of voice v added into mix[c][0 .. n-1];
+// g / dg: gain at the first sample and its per-sample step. In three passes
+// over the block: the head's positions (taps and frac, and where a ramp
+// restarts), then one kernel loop per channel, then the ramp and the mix.
+// (The voice and loop are copied to locals: stores to mix could otherwise
+// alias them.)
+static void voice_render(karma_voice *v, const karma_voice_loop *lp, double mix[][KARMA_VOICES_BLOCK], long n, double g, double dg)
+{
+    int64_t t0[KARMA_VOICES_BLOCK], t1[KARMA_VOICES_BLOCK], t2[KARMA_VOICES_BLOCK], t3[KARMA_VOICES_BLOCK];
+    double fr[KARMA_VOICES_BLOCK], fade[KARMA_VOICES_BLOCK], sv[4][KARMA_VOICES_BLOCK];
+    const float *b = lp->b;
+    const karma_multiply_state *mul = lp->mul;
+    double pos, rp, x, op, od, gi;
+    double head = v->head, ws = v->ws, wl = v->wl, snrfade = v->snrfade;
+    double len = lp->len, base = lp->base, snrstep = lp->snrstep, step = v->speed * lp->srscale;
+    int64_t ph, c, interp = v->interp, nproc = lp->nproc, stride = lp->stride;
+    int64_t maxloop = lp->maxloop, fm1 = lp->fm1, snrtype = lp->snrtype;
+    int64_t lo = (lp->directionorig >= 0) ? 0 : (fm1 - maxloop), hi = (lp->directionorig >= 0) ? maxloop : fm1;
+    t_bool on = v->on, seam = (wl < len) && (snrstep != 0.0), ramp = 0;
+    char directionorig = lp->directionorig;
+    long i;
+
+    if (!on && (snrfade >= 1.0)) {      // silent
+        for (c = 0; c < nproc; c++)
+            v->oprev[c] = 0.0;
+        return;
+    }
+    for (i = 0; i < n; i++) {           // positions, and the ramp's progress
+        if (snrfade < 1.0) {
+            ramp = 1;
+            fade[i] = snrfade;
+            snrfade += snrstep;
+        } else {
+            fade[i] = 1.0;
+        }
+        if (!on)
+            continue;
+        rp = ws + head;
+        if (rp >= len)
+            rp -= len;
+        pos = base + rp;
+        ph = (int64_t)pos;              // forward from floor(pos) at either speed's sign:
+        fr[i] = pos - (double)ph;       // the taps and frac place the read exactly at pos
+        if ((ph - 2 >= lo) && (ph + 2 <= hi)) {
+            t0[i] = ph - 1; t1[i] = ph; t2[i] = ph + 1; t3[i] = ph + 2;
+        } else {
+            interp_index(ph, &t0[i], &t1[i], &t2[i], &t3[i], 1, directionorig, maxloop, fm1);
+        }
+        if (mul) {
+            t0[i] = mul_resolve(mul, t0[i]);
+            t1[i] = mul_resolve(mul, t1[i]);
+            t2[i] = mul_resolve(mul, t2[i]);
+            t3[i] = mul_resolve(mul, t3[i]);
+        }
+        t0[i] *= stride; t1[i] *= stride; t2[i] *= stride; t3[i] *= stride;
+        head += step;
+        if ((head >= wl) || (head < 0.0)) {
+            head -= wl * floor(head / wl);
+            if (head >= wl)
+                head = 0.0;
+            if (seam)
+                snrfade = 0.0;          // the window's seam is a cut: ramp over it
+        }
+    }
+    if (on)
+        voice_read(sv, b, nproc, interp, t0, t1, t2, t3, fr, n);
+    else                                // ramping out to silence
+        memset(sv, 0, sizeof(sv));
+    for (c = 0; c < nproc; c++) {
+        if (ramp) {
+            op = v->oprev[c];
+            od = v->odif[c];
+            for (i = 0, gi = g; i < n; i++, gi += dg) {
+                x = sv[c][i];
+                if (fade[i] < 1.0) {
+                    if (fade[i] == 0.0)
+                        od = op - x;
+                    x += ease_switchramp(od, fade[i], snrtype);
+                }
+                op = x;
+                mix[c][i] += gi * x;
+            }
+            v->oprev[c] = op;
+            v->odif[c] = od;
+        } else {
+            for (i = 0, gi = g; i < n; i++, gi += dg)
+                mix[c][i] += gi * sv[c][i];
+            v->oprev[c] = sv[c][n - 1];
+        }
+    }
+    v->head = head;
+    v->snrfade = snrfade;
+}
+
+#endif // KARMA_VOICES_H
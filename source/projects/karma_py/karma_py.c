@@ -0,0 +1,419 @@
+// karma : a thin CPython extension over the host-agnostic karma_core DSP.
+//
+// For prototyping looping behaviours and rendering datasets offline. One
+// karma.Looper is one karma_core instance:
+//
+//   buf = numpy.zeros((frames, chans), numpy.float32)
+//   lp  = karma.Looper(buf, samplerate=48000)
+//   lp.record(); out = lp.process(inputs, speed=1.0); lp.play(); ...
+//
+//   - The loop buffer is any writable, C-contiguous float32 object exposing the
+//     buffer protocol (a NumPy array, array.array('f'), ...), 1-D for mono or
+//     (frames, chans) interleaved -- the layout the core reads. The looper holds
+//     the buffer view for its whole life: the core records straight into the
+//     caller's memory (no copies either way), and the exporter can't resize or
+//     free it underneath.
+//   - process(inputs, speed, out) takes planar float32 or float64 audio, 1-D for
+//     one output or (outputs, n), and a constant speed or an n-sample speed
+//     signal of the same type. float32 runs through the core's float32 entry
+//     point (karma_perform32), float64 through the perform64 one: no conversions.
+//     It runs the core in vectorsize chunks, like a real host, with the GIL
+//     released, so loopers render in parallel from a thread pool. out (same
+//     shape as inputs) is allocated with numpy when not given.
+//   - Control methods mirror the karma~ messages and take effect at the next
+//     chunk, as they would between two Max vectors.
+//
+// Build: `pip install .` at the repo root (setup.py), or `make py` in tests/.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include "karma_core.h"       // the Max-free core (standalone build config)
+
+#define KARMA_PY_MAXVS 4096
+
+typedef struct {
+    PyObject_HEAD
+    t_karma    core;
+    Py_buffer  view;          // the loop buffer (held for the looper's life)
+    PyObject  *buffer;        // ... and its exporter
+    double    *speedvec;      // vs samples of constant speed (as float, for float32 I/O)
+    long       vs;
+    t_bool     busy;          // a process() call is running (GIL released)
+} LooperObject;
+
+static const char *const kpy_states[] = { "stop", "play", "record", "overdub", "append", "initial" };
+
+// ---------------------------------------------------------------------------
+// the caller's buffer, exposed to the core through the host interface
+// ---------------------------------------------------------------------------
+static void *kpy_buf_lock(void *ctx)     { return ((LooperObject *)ctx)->view.buf; }
+static void  kpy_buf_unlock(void *ctx)   { (void)ctx; }
+static void  kpy_buf_setdirty(void *ctx) { (void)ctx; }
+
+// a buffer's struct format character ('f', 'd', ...) in native byte order, 0 if
+// it is not a single one
+static char kpy_format(const Py_buffer *v)
+{
+    const char *fmt = v->format ? v->format : "B";
+
+    if ((*fmt == '@') || (*fmt == '='))
+        fmt++;
+    return fmt[1] ? 0 : fmt[0];
+}
+
+// a C-contiguous buffer of the given struct format ('f' / 'd'; 0: either),
+// native byte order
+static int kpy_getbuffer(PyObject *o, Py_buffer *v, char type, int writable, const char *what)
+{
+    char f;
+
+    if (PyObject_GetBuffer(o, v, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0)) < 0)
+        return -1;
+    f = kpy_format(v);
+    if ((type ? (f != type) : ((f != 'f') && (f != 'd'))) || (v->ndim < 1) || (v->ndim > 2)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a 1-D or 2-D %s buffer", what,
+                     !type ? "float32 or float64" : ((type == 'f') ? "float32" : "float64"));
+        PyBuffer_Release(v);
+        return -1;
+    }
+    return 0;
+}
+
+static void kpy_release(LooperObject *self)
+{
+    if (self->buffer) {
+        PyBuffer_Release(&self->view);
+        Py_CLEAR(self->buffer);
+    }
+    PyMem_Free(self->speedvec);
+    self->speedvec = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// lifecycle
+// ---------------------------------------------------------------------------
+static int Looper_init(LooperObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "buffer", "samplerate", "outputs", "buffer_samplerate", "vectorsize", NULL };
+    PyObject *buffer;
+    double sr = 48000.0, bsr = 0.0;
+    long outputs = 0, vs = 64, frames, chans, i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|dldl", kwlist, &buffer, &sr, &outputs, &bsr, &vs))
+        return -1;
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Looper is processing");
+        return -1;
+    }
+    if ((sr <= 0.0) || (bsr < 0.0) || (vs < 1) || (vs > KARMA_PY_MAXVS)) {
+        PyErr_SetString(PyExc_ValueError, "samplerate must be > 0 and vectorsize 1 .. 4096");
+        return -1;
+    }
+    kpy_release(self);
+    if (kpy_getbuffer(buffer, &self->view, 'f', 1, "buffer") < 0)
+        return -1;
+    frames = (long)self->view.shape[0];
+    chans = (self->view.ndim == 2) ? (long)self->view.shape[1] : 1;
+    if ((frames < 2) || (chans < 1)) {
+        PyBuffer_Release(&self->view);
+        PyErr_SetString(PyExc_ValueError, "buffer needs at least 2 frames and 1 channel");
+        return -1;
+    }
+    self->speedvec = (double *)PyMem_Malloc((size_t)vs * sizeof(double));
+    if (!self->speedvec) {
+        PyBuffer_Release(&self->view);
+        PyErr_NoMemory();
+        return -1;
+    }
+    Py_INCREF(buffer);
+    self->buffer = buffer;
+    self->vs = vs;
+
+    if (outputs <= 0)
+        outputs = chans;
+    karma_core_init(&self->core, outputs, sr, (double)vs);
+    self->core.bufio.lock      = kpy_buf_lock;
+    self->core.bufio.unlock    = kpy_buf_unlock;
+    self->core.bufio.set_dirty = kpy_buf_setdirty;
+    self->core.bufio.ctx       = self;
+    self->core.bufio.frames    = frames;
+    self->core.bufio.chans     = chans;
+    self->core.bufio.sr        = (bsr > 0.0) ? bsr : sr;
+    karma_core_set_dims(&self->core);
+    self->core.speedconnect = 1;            // speed always arrives as a signal
+    self->core.initinit     = 1;            // DSP on: enables jump / stop
+    for (i = 0; i < vs; i++)
+        self->speedvec[i] = 1.0;
+    return 0;
+}
+
+static void Looper_dealloc(LooperObject *self)
+{
+    kpy_release(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// ---------------------------------------------------------------------------
+// process
+// ---------------------------------------------------------------------------
+static PyObject *Looper_process(LooperObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "inputs", "speed", "out", NULL };
+    PyObject *inobj, *speedobj = NULL, *outobj = NULL, *np;
+    Py_buffer in, sp, out;
+    t_karma *x = &self->core;
+    long ochans = (long)x->ochans, vs = self->vs, n, pos, m, c;
+    double speedconst = 1.0;
+    void *ins[5], *outs[4];
+    const char *ip, *spd = NULL;
+    char *op, type;
+    size_t sz;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OO", kwlist, &inobj, &speedobj, &outobj))
+        return NULL;
+    if (!self->buffer) {
+        PyErr_SetString(PyExc_RuntimeError, "Looper not initialised");
+        return NULL;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Looper is already processing in another thread");
+        return NULL;
+    }
+    if (kpy_getbuffer(inobj, &in, 0, 0, "inputs") < 0)
+        return NULL;
+    type = kpy_format(&in);                 // the speed signal and out follow the inputs
+    sz = (type == 'f') ? sizeof(float) : sizeof(double);
+    if (((in.ndim == 1) && (ochans != 1)) || ((in.ndim == 2) && (in.shape[0] != ochans))) {
+        PyErr_Format(PyExc_ValueError, "inputs must be (%ld, n)%s", ochans, (ochans == 1) ? " or 1-D" : "");
+        goto fail_in;
+    }
+    n = (long)in.shape[in.ndim - 1];
+
+    sp.obj = NULL;
+    if (speedobj && (speedobj != Py_None)) {
+        if (PyNumber_Check(speedobj) && !PyObject_CheckBuffer(speedobj)) {
+            speedconst = PyFloat_AsDouble(speedobj);
+            if (PyErr_Occurred())
+                goto fail_in;
+        } else {
+            if (kpy_getbuffer(speedobj, &sp, type, 0, "speed") < 0)
+                goto fail_in;
+            if ((sp.ndim != 1) || (sp.shape[0] != n)) {
+                PyErr_SetString(PyExc_ValueError, "a speed signal must be 1-D, as long as the inputs");
+                goto fail_sp;
+            }
+            spd = (const char *)sp.buf;
+        }
+    }
+
+    if (!outobj || (outobj == Py_None)) {
+        np = PyImport_ImportModule("numpy");
+        if (!np)
+            goto fail_sp;
+        outobj = (in.ndim == 1) ? PyObject_CallMethod(np, "empty", "(ns)", (Py_ssize_t)n, (type == 'f') ? "float32" : "float64")
+                                : PyObject_CallMethod(np, "empty", "((nn)s)", (Py_ssize_t)ochans, (Py_ssize_t)n, (type == 'f') ? "float32" : "float64");
+        Py_DECREF(np);
+        if (!outobj)
+            goto fail_sp;
+    } else {
+        Py_INCREF(outobj);
+    }
+    if (kpy_getbuffer(outobj, &out, type, 1, "out") < 0)
+        goto fail_out;
+    if ((out.ndim != in.ndim) || (out.shape[0] != in.shape[0]) || (out.shape[out.ndim - 1] != n)) {
+        PyErr_SetString(PyExc_ValueError, "out must have the inputs' shape");
+        PyBuffer_Release(&out);
+        goto fail_out;
+    }
+
+    self->busy = 1;
+    ip = (const char *)in.buf;
+    op = (char *)out.buf;
+    Py_BEGIN_ALLOW_THREADS
+    if (!spd) {
+        for (m = 0; m < vs; m++) {
+            if (type == 'f')
+                ((float *)self->speedvec)[m] = (float)speedconst;
+            else
+                self->speedvec[m] = speedconst;
+        }
+    }
+    for (pos = 0; pos < n; pos += m) {
+        m = (n - pos < vs) ? (n - pos) : vs;
+        for (c = 0; c < ochans; c++) {
+            ins[c] = (void *)(ip + (size_t)(c * n + pos) * sz);
+            outs[c] = op + (size_t)(c * n + pos) * sz;
+        }
+        ins[ochans] = spd ? (void *)(spd + (size_t)pos * sz) : (void *)self->speedvec;
+        if (type == 'f') {
+            karma_perform32(x, (float **)ins, (float **)outs, m);
+            continue;
+        }
+        switch (ochans) {
+            case 1:  karma_mono_perform(x, NULL, (double **)ins, ochans + 1, (double **)outs, ochans, m, 0, NULL);   break;
+            case 2:  karma_stereo_perform(x, NULL, (double **)ins, ochans + 1, (double **)outs, ochans, m, 0, NULL); break;
+            default: karma_quad_perform(x, NULL, (double **)ins, ochans + 1, (double **)outs, ochans, m, 0, NULL);   break;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+
+    PyBuffer_Release(&out);
+    if (sp.obj)
+        PyBuffer_Release(&sp);
+    PyBuffer_Release(&in);
+    return outobj;
+
+fail_out:
+    Py_DECREF(outobj);
+fail_sp:
+    if (sp.obj)
+        PyBuffer_Release(&sp);
+fail_in:
+    PyBuffer_Release(&in);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// control (names mirror the karma~ messages)
+// ---------------------------------------------------------------------------
+#define KPY_READY(self)                                                     \
+    if (!(self)->buffer) {                                                  \
+        PyErr_SetString(PyExc_RuntimeError, "Looper not initialised");      \
+        return NULL;                                                        \
+    }
+
+static PyObject *Looper_record(LooperObject *self, PyObject *unused) { (void)unused; KPY_READY(self); karma_record(&self->core); Py_RETURN_NONE; }
+static PyObject *Looper_play(LooperObject *self, PyObject *unused)   { (void)unused; KPY_READY(self); karma_play(&self->core);   Py_RETURN_NONE; }
+static PyObject *Looper_stop(LooperObject *self, PyObject *unused)   { (void)unused; KPY_READY(self); karma_stop(&self->core);   Py_RETURN_NONE; }
+static PyObject *Looper_append(LooperObject *self, PyObject *unused) { (void)unused; KPY_READY(self); karma_append(&self->core); Py_RETURN_NONE; }
+
+// one float argument -> f(core, value)
+static PyObject *kpy_float(LooperObject *self, PyObject *arg, void (*f)(t_karma *, double))
+{
+    double v;
+
+    KPY_READY(self);
+    v = PyFloat_AsDouble(arg);
+    if ((v == -1.0) && PyErr_Occurred())
+        return NULL;
+    f(&self->core, v);
+    Py_RETURN_NONE;
+}
+
+static PyObject *Looper_overdub(LooperObject *self, PyObject *arg)  { return kpy_float(self, arg, karma_overdub); }
+static PyObject *Looper_jump(LooperObject *self, PyObject *arg)     { return kpy_float(self, arg, karma_jump); }
+static PyObject *Looper_position(LooperObject *self, PyObject *arg) { return kpy_float(self, arg, karma_select_start); }
+static PyObject *Looper_window(LooperObject *self, PyObject *arg)   { return kpy_float(self, arg, karma_select_size); }
+
+static PyObject *Looper_setloop(LooperObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "low", "high", "units", NULL };
+    const char *units = "phase";
+    double low, high;
+    long flag;
+
+    KPY_READY(self);
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "dd|s", kwlist, &low, &high, &units))
+        return NULL;
+    if (!strcmp(units, "phase"))
+        flag = 0;
+    else if (!strcmp(units, "samples"))
+        flag = 1;
+    else if (!strcmp(units, "ms"))
+        flag = 2;
+    else {
+        PyErr_SetString(PyExc_ValueError, "units must be 'phase', 'samples' or 'ms'");
+        return NULL;
+    }
+    karma_core_set_loop(&self->core, low, high, flag);
+    Py_RETURN_NONE;
+}
+
+// ---------------------------------------------------------------------------
+// attributes
+// ---------------------------------------------------------------------------
+static PyObject *Looper_get_state(LooperObject *self, void *closure)
+{
+    int s = self->core.statehuman;
+    (void)closure;
+
+    return PyUnicode_FromString(((s >= 0) && (s <= 5)) ? kpy_states[s] : "stop");
+}
+
+static PyObject *Looper_get_loop(LooperObject *self, void *closure)
+{
+    (void)closure;
+    return Py_BuildValue("(LL)", (long long)self->core.startloop, (long long)self->core.endloop);
+}
+
+static PyMethodDef Looper_methods[] = {
+    { "process",  (PyCFunction)(void (*)(void))Looper_process, METH_VARARGS | METH_KEYWORDS,
+      "process(inputs, speed=1.0, out=None) -> out\n\n"
+      "Run len(inputs) frames (float32 or float64, 1-D or (outputs, n)) through the\n"
+      "looper at a constant speed or a speed signal of the same type, with the GIL\n"
+      "released. out (allocated when not given) has the inputs' shape and type." },
+    { "record",   (PyCFunction)Looper_record,   METH_NOARGS, "record()" },
+    { "play",     (PyCFunction)Looper_play,     METH_NOARGS, "play()" },
+    { "stop",     (PyCFunction)Looper_stop,     METH_NOARGS, "stop()" },
+    { "append",   (PyCFunction)Looper_append,   METH_NOARGS, "append()" },
+    { "overdub",  (PyCFunction)Looper_overdub,  METH_O,      "overdub(amplitude 0 .. 1)" },
+    { "jump",     (PyCFunction)Looper_jump,     METH_O,      "jump(phase 0 .. 1)" },
+    { "position", (PyCFunction)Looper_position, METH_O,      "position(phase 0 .. 1): window start" },
+    { "window",   (PyCFunction)Looper_window,   METH_O,      "window(phase 0 .. 1): window size" },
+    { "setloop",  (PyCFunction)(void (*)(void))Looper_setloop, METH_VARARGS | METH_KEYWORDS,
+      "setloop(low, high, units='phase'|'samples'|'ms')" },
+    { NULL }
+};
+
+static PyMemberDef Looper_members[] = {
+    { "buffer", T_OBJECT, offsetof(LooperObject, buffer), READONLY, "the loop buffer (shared, not copied)" },
+    { NULL }
+};
+
+static PyGetSetDef Looper_getset[] = {
+    { "state", (getter)Looper_get_state, NULL, "'stop', 'play', 'record', 'overdub', 'append' or 'initial'", NULL },
+    { "loop",  (getter)Looper_get_loop,  NULL, "(start, end) of the loop in frames", NULL },
+    { NULL }
+};
+
+static PyTypeObject LooperType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "karma.Looper",
+    .tp_doc       = "Looper(buffer, samplerate=48000, outputs=0, buffer_samplerate=0, vectorsize=64)\n\n"
+                    "A karma looper recording into / playing from `buffer` (writable float32,\n"
+                    "(frames,) or (frames, chans), shared without copying). outputs 0 = the\n"
+                    "buffer's channels (1, 2 or 4); buffer_samplerate 0 = samplerate.",
+    .tp_basicsize = sizeof(LooperObject),
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_new       = PyType_GenericNew,
+    .tp_init      = (initproc)Looper_init,
+    .tp_dealloc   = (destructor)Looper_dealloc,
+    .tp_methods   = Looper_methods,
+    .tp_members   = Looper_members,
+    .tp_getset    = Looper_getset,
+};
+
+static struct PyModuleDef karma_module = {
+    PyModuleDef_HEAD_INIT, "karma", "karma_core looper bindings.", -1, NULL, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_karma(void)
+{
+    PyObject *m;
+
+    if (PyType_Ready(&LooperType) < 0)
+        return NULL;
+    m = PyModule_Create(&karma_module);
+    if (!m)
+        return NULL;
+    Py_INCREF(&LooperType);
+    if (PyModule_AddObject(m, "Looper", (PyObject *)&LooperType) < 0) {
+        Py_DECREF(&LooperType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -7,26 +7,39 @@
 // and the per-vector perform call are forwarded to the core.
 //
 // Scope note: covers transport (record/play/stop/overdub/append/jump), speed,
-// selection (position/window), loop points (setloop/resetloop), and buffer
-// association (set). Still unimplemented from the reference: 'multiply' and
-// 'offset' (not extracted into the core yet).
+// selection (position/window), loop points (setloop/resetloop), buffer
+// association (set), buffer channel offset, one-shot playback (@loop), modulo
+// outputs (@modout), sinc interpolation (@interp 3, @sinctaps), mip-mapped
+// high-speed playback (@mipmap), a resampled shadow for buffer~s at another
+// rate (@shadow), undo / redo, multiply, capture from a pre-record ring
+// (@prerec), and buffer~ switches at a vector boundary while DSP runs, with an
+// optional crossfade (@xfade).
 
 #include "ext.h"
 #include "ext_obex.h"
 #include "ext_buffer.h"
 #include "z_dsp.h"
 
+#include <string.h>           // memcpy
+
 #include "karma_core_api.h"   // the Max-free core (after the c74 headers)
 
+#define KRE_SET_POLL  2       // ms between looks at the crossfade a 'set' waits for
+
 // ---------------------------------------------------------------------------
 typedef struct _karma_re {
     t_pxobject     ob;
     t_karma        core;          // the DSP engine (by value)
 
     t_buffer_ref  *buf;
+    t_buffer_ref  *buf_temp;      // the other side of a switch: looked up before it, read by its crossfade
     t_symbol      *bufname;
+    karma_switch   sw;            // the buffer~ switch handed to the core (sw.done: the last one is over)
+    long           xfade;         // @xfade: crossfade of a 'set' while DSP runs (samples, 0 = cut)
+    t_symbol      *setnext;       // a 'set' that came during the crossfade, made once it is over
     void          *messout;       // data/list outlet
     void          *tclock;        // report clock
+    void          *setclock;      // polls for the end of the crossfade while setnext waits
     t_bool         buf_modified;
     t_bool         clockgo;       // shell-owned report-clock arming flag. NOT core.clockgo:
                                   // the core's verbatim perform tail still toggles its own
@@ -34,6 +47,21 @@ typedef struct _karma_re {
                                   // its own or the report clock never arms during playback.
     long           syncoutlet;    // @syncout attribute (instantiation-time)
     long           reportlist;    // report interval in ms
+    long           undopages;     // @undo: undo pool size in 1024-frame pages (0 = off)
+    long           undoshape[3];  // frames / chans / pages the current history was built for
+    long           mulshape[2];   // frames / chans the multiply state was built for
+    long           mipmap;        // @mipmap: decimated reads at >= 2x (0 = off)
+    long           mipshape[2];   // frames / chans the pyramid was built for
+    long           shadow;        // @shadow: resampled copy when buffer~ and DSP rates differ (0 = off)
+    long           shadowshape[2];// frames / chans the shadow was built for
+    double         shadowscale;   // ... and its srscale
+    double         prerec;        // @prerec: pre-record ring length in seconds (0 = off)
+    double         prerecshape[2];// seconds / DSP rate the ring was built for
+    long           prerecchans;   // ... and its channels
+    struct {                      // the same for the extensions in sw, the core's once it is made
+        long       undo[3], mul[2], mip[2], shadow[2], prerecchans;
+        double     shadowscale, prerec[2];
+    } swshape;
 } t_karma_re;
 
 static t_class  *karma_re_class = NULL;
@@ -43,25 +71,36 @@ static t_symbol *ps_phase, *ps_samples, *ps_milliseconds, *ps_reset;
 // ---------------------------------------------------------------------------
 // buffer~ access exposed to the core through the host interface
 // ---------------------------------------------------------------------------
+// (ctx is the buffer reference: during a switch's crossfade the core reads the
+// old buffer~ through the other one)
 static void *kre_buf_lock(void *ctx)
 {
-    t_karma_re *x = (t_karma_re *)ctx;
-    t_buffer_obj *b = buffer_ref_getobject(x->buf);
+    t_buffer_obj *b = buffer_ref_getobject((t_buffer_ref *)ctx);
     return b ? buffer_locksamples(b) : NULL;
 }
 static void kre_buf_unlock(void *ctx)
 {
-    t_karma_re *x = (t_karma_re *)ctx;
-    t_buffer_obj *b = buffer_ref_getobject(x->buf);
+    t_buffer_obj *b = buffer_ref_getobject((t_buffer_ref *)ctx);
     if (b) buffer_unlocksamples(b);
 }
 static void kre_buf_setdirty(void *ctx)
 {
-    t_karma_re *x = (t_karma_re *)ctx;
-    t_buffer_obj *b = buffer_ref_getobject(x->buf);
+    t_buffer_obj *b = buffer_ref_getobject((t_buffer_ref *)ctx);
     if (b) buffer_setdirty(b);
 }
 
+static void kre_buf_iface(karma_buffer_iface *io, t_buffer_ref *ref, t_buffer_obj *b)
+{
+    io->lock      = kre_buf_lock;
+    io->unlock    = kre_buf_unlock;
+    io->set_dirty = kre_buf_setdirty;
+    io->set_dirty_range = NULL;             // buffer~ only has whole-buffer dirty
+    io->ctx       = ref;
+    io->frames    = (long)buffer_getframecount(b);
+    io->chans     = (long)buffer_getchannelcount(b);
+    io->sr        = buffer_getsamplerate(b);
+}
+
 // Point the core at our buffer~ and (re)query its dimensions.
 static void kre_buf_setup(t_karma_re *x, t_symbol *s)
 {
@@ -74,16 +113,208 @@ static void kre_buf_setup(t_karma_re *x, t_symbol *s)
     t_buffer_obj *b = buffer_ref_getobject(x->buf);
     if (!b) { x->buf = 0; return; }
 
-    x->core.bufio.lock      = kre_buf_lock;
-    x->core.bufio.unlock    = kre_buf_unlock;
-    x->core.bufio.set_dirty = kre_buf_setdirty;
-    x->core.bufio.ctx       = x;
-    x->core.bufio.frames    = (long)buffer_getframecount(b);
-    x->core.bufio.chans     = (long)buffer_getchannelcount(b);
-    x->core.bufio.sr        = buffer_getsamplerate(b);
+    kre_buf_iface(&x->core.bufio, x->buf, b);
     karma_core_set_dims(&x->core);
 }
 
+// Look s up on the spare reference and describe it in x->sw, leaving the
+// buffer~ the core plays alone. 0 if there is no such buffer~.
+static t_bool kre_buf_prepare(t_karma_re *x, t_symbol *s)
+{
+    if (!x->buf_temp)
+        x->buf_temp = buffer_ref_new((t_object *)x, s);
+    else
+        buffer_ref_set(x->buf_temp, s);
+
+    t_buffer_obj *b = buffer_ref_getobject(x->buf_temp);
+    if (!b) return false;
+
+    kre_buf_iface(&x->sw.bufio, x->buf_temp, b);
+    x->sw.fade = x->xfade;
+    return true;
+}
+
+// The undo history for a buffer of frames x chans (the view's) with pages of
+// pool: the current one if it was built for that, else a new one (NULL with
+// pages 0). shape gets what it is built for. Shared by dsp64 and a switch.
+static struct karma_undo *kre_undo_for(t_karma_re *x, long frames, long chans, long pages, long shape[3])
+{
+    struct karma_undo *u = x->core.undo;
+
+    if (frames != x->undoshape[0] || chans != x->undoshape[1] || pages != x->undoshape[2])
+        u = (pages > 0) ? karma_undo_new(frames, chans, pages) : NULL;
+    shape[0] = frames;
+    shape[1] = chans;
+    shape[2] = u ? pages : 0;
+    return u;
+}
+
+// Same for the multiply state (a page bitmap: small, so always allocated).
+static struct karma_multiply *kre_multiply_for(t_karma_re *x, long frames, long chans, long shape[2])
+{
+    struct karma_multiply *m = x->core.mul;
+
+    if (frames != x->mulshape[0] || chans != x->mulshape[1])
+        m = (frames > 0) ? karma_multiply_new(frames, chans) : NULL;
+    shape[0] = m ? frames : 0;
+    shape[1] = m ? chans : 0;
+    return m;
+}
+
+// Same for the mip-map pyramid (frames 0 while @mipmap is off).
+static struct karma_mipmap *kre_mipmap_for(t_karma_re *x, long frames, long chans, long shape[2])
+{
+    struct karma_mipmap *p = x->core.mip;
+
+    if (frames != x->mipshape[0] || chans != x->mipshape[1])
+        p = (frames > 0) ? karma_mipmap_new(frames, chans) : NULL;
+    shape[0] = p ? frames : 0;
+    shape[1] = p ? chans : 0;
+    return p;
+}
+
+// Same for the resampled shadow (frames 0 while @shadow is off or the rates
+// match).
+static struct karma_shadow *kre_shadow_for(t_karma_re *x, long frames, long chans, double srscale, long shape[2], double *scale)
+{
+    struct karma_shadow *r = x->core.shadow;
+
+    if (frames != x->shadowshape[0] || chans != x->shadowshape[1] || srscale != x->shadowscale)
+        r = (frames > 0) ? karma_shadow_new(frames, chans, srscale) : NULL;
+    shape[0] = r ? frames : 0;
+    shape[1] = r ? chans : 0;
+    *scale   = srscale;
+    return r;
+}
+
+// Same for the pre-record ring, seconds long at the DSP rate.
+static struct karma_prerec *kre_prerec_for(t_karma_re *x, double seconds, long chans, double shape[2], long *pchans)
+{
+    struct karma_prerec *q = x->core.prerec;
+
+    if (seconds != x->prerecshape[0] || x->core.ssr != x->prerecshape[1] || chans != x->prerecchans)
+        q = (seconds > 0.0) ? karma_prerec_new(seconds, x->core.ssr, chans) : NULL;
+    shape[0] = q ? seconds : 0.0;
+    shape[1] = x->core.ssr;
+    *pchans  = q ? chans : 0;
+    return q;
+}
+
+// (Re)allocate the undo history when the buffer's dimensions or @undo changed
+// (kept otherwise, so DSP restarts don't lose it). Called from dsp64; a history
+// that no longer matches the view (after 'offset') is ignored by the core until
+// then.
+static void kre_undo_setup(t_karma_re *x)
+{
+    struct karma_undo *u = kre_undo_for(x, (long)x->core.bframes, karma_core_view_chans(&x->core),
+                                        x->buf ? x->undopages : 0, x->undoshape);
+    if (u != x->core.undo) {
+        karma_undo_free(x->core.undo);
+        x->core.undo = u;
+    }
+}
+
+// Same for the multiply state.
+static void kre_multiply_setup(t_karma_re *x)
+{
+    struct karma_multiply *m = kre_multiply_for(x, x->buf ? (long)x->core.bframes : 0,
+                                                karma_core_view_chans(&x->core), x->mulshape);
+    if (m != x->core.mul) {
+        karma_multiply_free(x->core.mul);
+        x->core.mul = m;
+    }
+}
+
+// Same for the mip-map pyramid, allocated while @mipmap is on.
+static void kre_mipmap_setup(t_karma_re *x)
+{
+    struct karma_mipmap *p = kre_mipmap_for(x, (x->buf && x->mipmap) ? (long)x->core.bframes : 0,
+                                            karma_core_view_chans(&x->core), x->mipshape);
+    if (p != x->core.mip) {
+        karma_mipmap_free(x->core.mip);
+        x->core.mip = p;
+    }
+}
+
+// Same for the resampled shadow, allocated while @shadow is on and the buffer~'s
+// rate differs from the DSP's.
+static void kre_shadow_setup(t_karma_re *x)
+{
+    long frames = (x->buf && x->shadow && (x->core.srscale != 1.0)) ? (long)x->core.bframes : 0;
+    struct karma_shadow *r = kre_shadow_for(x, frames, karma_core_view_chans(&x->core), x->core.srscale,
+                                            x->shadowshape, &x->shadowscale);
+    if (r != x->core.shadow) {
+        karma_shadow_free(x->core.shadow);
+        x->core.shadow = r;
+    }
+}
+
+// Same for the pre-record ring, allocated while @prerec is on, for the DSP rate.
+static void kre_prerec_setup(t_karma_re *x)
+{
+    struct karma_prerec *q = kre_prerec_for(x, x->buf ? x->prerec : 0.0, karma_core_view_chans(&x->core),
+                                            x->prerecshape, &x->prerecchans);
+    if (q != x->core.prerec) {
+        karma_prerec_free(x->core.prerec);
+        x->core.prerec = q;
+    }
+}
+
+// The extensions for the buffer~ described in x->sw, as the setups above will
+// want them once the core runs on it: the current ones where the size does not
+// change, new ones where it does. Their shapes wait in x->swshape.
+static void kre_switch_exts(t_karma_re *x)
+{
+    karma_switch *w = &x->sw;
+    long   frames   = (long)w->bufio.frames, chans = karma_core_switch_chans(&x->core, w);
+    double srscale  = w->bufio.sr / x->core.ssr;
+
+    w->undo   = kre_undo_for(x, frames, chans, x->undopages, x->swshape.undo);
+    w->mul    = kre_multiply_for(x, frames, chans, x->swshape.mul);
+    w->mip    = kre_mipmap_for(x, x->mipmap ? frames : 0, chans, x->swshape.mip);
+    w->shadow = kre_shadow_for(x, (x->shadow && (srscale != 1.0)) ? frames : 0, chans, srscale,
+                               x->swshape.shadow, &x->swshape.shadowscale);
+    w->prerec = kre_prerec_for(x, x->prerec, chans, x->swshape.prerec, &x->swshape.prerecchans);
+    w->exts   = 1;
+}
+
+// Free what x->sw holds that the core does not run on: the extensions it had
+// if the switch was made, else the new ones it never took.
+static void kre_switch_release(t_karma_re *x)
+{
+    karma_switch *w = &x->sw;
+
+    if (w->undo != x->core.undo)     karma_undo_free(w->undo);
+    if (w->mul != x->core.mul)       karma_multiply_free(w->mul);
+    if (w->mip != x->core.mip)       karma_mipmap_free(w->mip);
+    if (w->shadow != x->core.shadow) karma_shadow_free(w->shadow);
+    if (w->prerec != x->core.prerec) karma_prerec_free(w->prerec);
+    w->undo   = NULL;
+    w->mul    = NULL;
+    w->mip    = NULL;
+    w->shadow = NULL;
+    w->prerec = NULL;
+    w->exts   = 0;
+}
+
+// Once the last switch is done: the shapes of what the core now runs on, and
+// the rest freed. (A switch still pending keeps its extensions.)
+static void kre_switch_collect(t_karma_re *x)
+{
+    if (!x->sw.exts || !atomic_load_explicit(&x->sw.done, memory_order_acquire))
+        return;
+    if (x->sw.made) {
+        memcpy(x->undoshape, x->swshape.undo, sizeof(x->undoshape));
+        memcpy(x->mulshape, x->swshape.mul, sizeof(x->mulshape));
+        memcpy(x->mipshape, x->swshape.mip, sizeof(x->mipshape));
+        memcpy(x->shadowshape, x->swshape.shadow, sizeof(x->shadowshape));
+        memcpy(x->prerecshape, x->swshape.prerec, sizeof(x->prerecshape));
+        x->shadowscale = x->swshape.shadowscale;
+        x->prerecchans = x->swshape.prerecchans;
+    }
+    kre_switch_release(x);
+}
+
 // ---------------------------------------------------------------------------
 // report list outlet (ported from the reference karma_clock_list)
 // ---------------------------------------------------------------------------
@@ -130,6 +361,18 @@ void karma_re_overdub(t_karma_re *x, double amp)  { karma_overdub(&x->core, amp)
 void karma_re_jump(t_karma_re *x, double pos)     { karma_jump(&x->core, pos); }
 void karma_re_position(t_karma_re *x, double p)   { karma_select_start(&x->core, p); }
 void karma_re_window(t_karma_re *x, double w)     { karma_select_size(&x->core, w); }
+void karma_re_undo(t_karma_re *x)                 { karma_undo(&x->core); }
+void karma_re_redo(t_karma_re *x)                 { karma_redo(&x->core); }
+void karma_re_multiply(t_karma_re *x, long f)     { karma_multiply(&x->core, f); }
+void karma_re_capture(t_karma_re *x, double sec)  { karma_capture(&x->core, sec); x->clockgo = 1; }
+
+// 'offset <first channel> [<channel count>]': zero-indexed, count 0 = the rest
+// of the buffer~. Undo / multiply / mip-map / shadow / the pre-record ring
+// follow the new width at the next dsp64.
+void karma_re_offset(t_karma_re *x, long offset, long count)
+{
+    karma_core_set_channels(&x->core, offset, count);
+}
 
 // 'speed' float arrives on the last inlet; mirror the reference gate.
 void karma_re_float(t_karma_re *x, double f)
@@ -199,17 +442,57 @@ void karma_re_resetloop(t_karma_re *x)
     karma_core_set_loop(&x->core, (double)x->core.initiallow, (double)x->core.initialhigh, 1);
 }
 
-// associate / change the buffer~ (resets the loop window to the new buffer)
+// associate / change the buffer~ (resets the loop window to the new buffer).
+// With DSP running the new buffer~ is looked up first (a missing one leaves
+// playback alone) and the core moves onto it at the start of its next vector,
+// crossfading over @xfade samples -- perform never sees half a change. The
+// undo / multiply / mip-map / shadow / pre-record state for the new buffer~ go
+// with the switch; the ones they replace are freed at the next 'set' or dsp64.
+// A 'set' during a crossfade waits for it to end (the latest one wins).
+static void kre_set_buffer(t_karma_re *x, t_symbol *name)
+{
+    x->setnext = NULL;
+    if (!sys_getdspobjdspstate((t_object *)x)) {
+        clock_unset(x->setclock);
+        kre_buf_setup(x, name);
+        kre_switch_collect(x);
+        if (!x->buf)
+            object_warn((t_object *)x, "set: no buffer~ named %s", name->s_name);
+        return;
+    }
+    // the spare reference is still the crossfade's
+    if (!atomic_load_explicit(&x->sw.done, memory_order_acquire)) {
+        x->setnext = name;
+        clock_delay(x->setclock, KRE_SET_POLL);
+        return;
+    }
+    kre_switch_collect(x);
+    if (!kre_buf_prepare(x, name)) {
+        object_warn((t_object *)x, "set: no buffer~ named %s", name->s_name);
+        return;
+    }
+    kre_switch_exts(x);
+    t_buffer_ref *old = x->buf;     // the crossfade reads it until sw.done
+    x->buf      = x->buf_temp;
+    x->buf_temp = old;
+    x->bufname  = name;
+    karma_core_switch(&x->core, &x->sw);
+}
+
+// setclock: the waiting 'set', once the crossfade is over (else look again)
+void karma_re_setnext(t_karma_re *x)
+{
+    if (x->setnext)
+        kre_set_buffer(x, x->setnext);
+}
+
 void karma_re_set(t_karma_re *x, t_symbol *s, short ac, t_atom *av)
 {
     if (ac < 1 || atom_gettype(av) != A_SYM) {
         object_error((t_object *)x, "%s requires a buffer~ name", s->s_name);
         return;
     }
-    t_symbol *name = atom_getsym(av);
-    kre_buf_setup(x, name);
-    if (!x->buf)
-        object_warn((t_object *)x, "set: no buffer~ named %s", name->s_name);
+    kre_set_buffer(x, atom_getsym(av));
 }
 
 // ---------------------------------------------------------------------------
@@ -249,6 +532,14 @@ void karma_re_dsp64(t_karma_re *x, t_object *dsp64, short *count, double srate,
 
     if (x->bufname) {
         kre_buf_setup(x, x->bufname);
+        kre_switch_collect(x);
+        if (!x->sw.exts) {      // (a switch still pending brings its own)
+            kre_undo_setup(x);
+            kre_multiply_setup(x);
+            kre_mipmap_setup(x);
+            kre_shadow_setup(x);
+            kre_prerec_setup(x);
+        }
         x->core.syncoutlet  = x->syncoutlet;
 
         long ochans = (long)x->core.ochans;
@@ -275,6 +566,8 @@ t_max_err karma_re_notify(t_karma_re *x, t_symbol *s, t_symbol *msg, void *sende
 {
     if (msg == ps_buffer_modified)
         x->buf_modified = true;
+    if (x->buf_temp)
+        buffer_ref_notify(x->buf_temp, s, msg, sender, data);
     return buffer_ref_notify(x->buf, s, msg, sender, data);
 }
 
@@ -302,15 +595,19 @@ void *karma_re_new(t_symbol *s, short argc, t_atom *argv)
     x->bufname    = bufname;
     x->reportlist = 50;
     x->buf        = 0;
+    atomic_init(&x->sw.done, 1);    // no switch pending
 
     x->messout = listout(x);
     x->tclock  = clock_new((t_object *)x, (method)karma_re_clock_list);
+    x->setclock = clock_new((t_object *)x, (method)karma_re_setnext);
     attr_args_process(x, argc, argv);
 
     long n = (x->syncoutlet ? 1 : 0) + chans;
     for (long i = 0; i < n; i++) outlet_new(x, "signal");
 
-    x->ob.z_misc |= Z_NO_INPLACE;
+    // no Z_NO_INPLACE: the core reads all of a sample's inputs (the speed signal
+    // included) before it writes that sample's outputs, so MSP may hand the
+    // outlets the inlets' vectors
     return x;
 }
 
@@ -318,7 +615,15 @@ void karma_re_free(t_karma_re *x)
 {
     dsp_free((t_pxobject *)x);
     if (x->buf)     object_free(x->buf);
+    if (x->buf_temp) object_free(x->buf_temp);
     if (x->tclock)  object_free(x->tclock);
+    if (x->setclock) object_free(x->setclock);
+    kre_switch_release(x);
+    karma_undo_free(x->core.undo);
+    karma_multiply_free(x->core.mul);
+    karma_mipmap_free(x->core.mip);
+    karma_shadow_free(x->core.shadow);
+    karma_prerec_free(x->core.prerec);
 }
 
 // ---------------------------------------------------------------------------
@@ -339,6 +644,11 @@ void ext_main(void *r)
     class_addmethod(c, (method)karma_re_setloop,  "setloop",  A_GIMME, 0);
     class_addmethod(c, (method)karma_re_resetloop,"resetloop",         0);
     class_addmethod(c, (method)karma_re_set,      "set",      A_GIMME, 0);
+    class_addmethod(c, (method)karma_re_undo,     "undo",              0);
+    class_addmethod(c, (method)karma_re_redo,     "redo",              0);
+    class_addmethod(c, (method)karma_re_multiply, "multiply", A_LONG,  0);
+    class_addmethod(c, (method)karma_re_capture,  "capture",  A_FLOAT, 0);
+    class_addmethod(c, (method)karma_re_offset,   "offset",   A_LONG, A_DEFLONG, 0);
 
     class_addmethod(c, (method)karma_re_dsp64,       "dsp64",     A_CANT, 0);
     class_addmethod(c, (method)karma_re_assist,      "assist",    A_CANT, 0);
@@ -354,6 +664,31 @@ void ext_main(void *r)
     CLASS_ATTR_FILTER_MIN(c, "report", 0);
     CLASS_ATTR_LABEL(c, "report", 0, "Report Time (ms) for data outlet");
 
+    // undo pool is allocated at DSP start for the buffer's size -> shell field.
+    CLASS_ATTR_LONG(c, "undo", 0, t_karma_re, undopages);
+    CLASS_ATTR_FILTER_MIN(c, "undo", 0);
+    CLASS_ATTR_LABEL(c, "undo", 0, "Undo Pool (1024-frame pages, 0 = off)");
+
+    // likewise the mip-map pyramid
+    CLASS_ATTR_LONG(c, "mipmap", 0, t_karma_re, mipmap);
+    CLASS_ATTR_FILTER_CLIP(c, "mipmap", 0, 1);
+    CLASS_ATTR_LABEL(c, "mipmap", 0, "Decimated playback above 2x off / on");
+
+    // and the resampled shadow
+    CLASS_ATTR_LONG(c, "shadow", 0, t_karma_re, shadow);
+    CLASS_ATTR_FILTER_CLIP(c, "shadow", 0, 1);
+    CLASS_ATTR_LABEL(c, "shadow", 0, "Resampled copy for a buffer~ at another rate off / on");
+
+    // and the pre-record ring (seconds at the DSP rate)
+    CLASS_ATTR_DOUBLE(c, "prerec", 0, t_karma_re, prerec);
+    CLASS_ATTR_FILTER_MIN(c, "prerec", 0);
+    CLASS_ATTR_LABEL(c, "prerec", 0, "Pre-record Ring for capture (seconds, 0 = off)");
+
+    // and the crossfade of a buffer~ switch ('set' while DSP runs)
+    CLASS_ATTR_LONG(c, "xfade", 0, t_karma_re, xfade);
+    CLASS_ATTR_FILTER_MIN(c, "xfade", 0);
+    CLASS_ATTR_LABEL(c, "xfade", 0, "Crossfade on set while DSP runs (samples, 0 = cut)");
+
     // DSP params live in the core and are read by the perform routines, so map
     // these attributes directly onto the embedded core fields.
     CLASS_ATTR_LONG(c, "ramp", 0, t_karma_re, core.globalramp);
@@ -370,10 +705,22 @@ void ext_main(void *r)
     CLASS_ATTR_LABEL(c, "snrcurv", 0, "Switch&Ramp Curve");
 
     CLASS_ATTR_LONG(c, "interp", 0, t_karma_re, core.interpflag);
-    CLASS_ATTR_FILTER_CLIP(c, "interp", 0, 2);
-    CLASS_ATTR_ENUMINDEX(c, "interp", 0, "Linear Cubic Spline");
+    CLASS_ATTR_FILTER_CLIP(c, "interp", 0, 3);
+    CLASS_ATTR_ENUMINDEX(c, "interp", 0, "Linear Cubic Spline Sinc");
     CLASS_ATTR_LABEL(c, "interp", 0, "Playback Interpolation");
 
+    CLASS_ATTR_LONG(c, "sinctaps", 0, t_karma_re, core.sinctaps);
+    CLASS_ATTR_FILTER_CLIP(c, "sinctaps", 8, 32);
+    CLASS_ATTR_LABEL(c, "sinctaps", 0, "Sinc Interpolation Taps (8 / 16 / 32)");
+
+    CLASS_ATTR_LONG(c, "loop", 0, t_karma_re, core.islooped);
+    CLASS_ATTR_FILTER_CLIP(c, "loop", 0, 1);
+    CLASS_ATTR_LABEL(c, "loop", 0, "Loop off / on");
+
+    CLASS_ATTR_LONG(c, "modout", 0, t_karma_re, core.moduloout);
+    CLASS_ATTR_FILTER_CLIP(c, "modout", 0, 1);
+    CLASS_ATTR_LABEL(c, "modout", 0, "Modulo playback channel outputs off / on");
+
     class_dspinit(c);
     class_register(CLASS_BOX, c);
     karma_re_class = c;
@@ -1,7 +1,51 @@
 // Perform-only microbenchmark for the unified karma_core routine.
 // Fills an initial loop, then times steady-state playback+overdub perform calls
 // and reports ns per output sample for 1 / 2 / 4 output channels. Compare against
-// bench_ref (the reference's unrolled routines) to judge the loop overhead.
+// bench_ref (the reference's unrolled routines) to judge the loop overhead. The
+// same run at 8x record speed exercises the ipoke span fill (7 skipped frames
+// interpolated per sample).
+//
+// The decay bench runs a long silent overdub at amplitude 0.9: the loop decays
+// every pass, crosses into the float subnormal range after ~800 passes and stays
+// there for ~150 more without the core's FTZ / flush guard. Per-vector cost
+// should stay flat from the first block of passes to the last.
+//
+// The persist bench runs a 1x overdub pass with set_dirty_range feeding a
+// karma_persist writer (10 ms period) and reports the perform-side cost next to
+// the plain run, plus what the writer did: frames written and the worst lag.
+//
+// The sinc lines play with @interp 3 at 8 / 16 / 32 taps: at 1.5x the kernel is
+// its nominal length, at 4x it is stretched to 4x the taps (anti-aliasing).
+// The 5.5x lines play the same loop from the buffer and from a mip-map pyramid.
+// The 44.1k lines play a 44.1 kHz buffer at 1x in a 48 kHz session, from the
+// buffer (interpolating every sample) and from a resampled shadow.
+//
+// The silent-overdub lines record a 1x pass at unity overdub with no input
+// (overdub left armed), alone and feeding the persist writer.
+//
+// The idle lines run NIDLE stopped instances on one buffer (each with a take,
+// played, then stopped and settled) and report the perform call's cost per
+// instance per vector: a patch full of loopers that are not playing.
+//
+// The float32 lines play at 1x with float host audio: converted to double around
+// the double entry point (what the CLAP / Python hosts did) and straight through
+// karma_perform32.
+//
+// The pre-record lines add a 1 s ring (karma_prerec_new) that takes the input
+// every vector: playing at 1x (ns per sample) and idle (ns per vector per
+// instance), next to the same runs without it.
+//
+// The layer lines play NLAYER more heads on one loop, at NLAYER different
+// speeds, next to the instance that recorded it: as that many more instances
+// on the buffer, and as voices of the one instance (karma_voices_new). ns per
+// vector for everything.
+//
+// The small-vector lines play at 1x with the host vector at 1, 4 and 16 samples
+// and report ns per perform call: at these sizes the call's fixed cost (state
+// load / store, buffer lock, per-vector services) is most of it.
+//
+// `make bench` runs this twice: the plain build and the PGO build (BENCH_TAG
+// "unified, PGO"), the latter compiled with the profile from `make pgo`.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,52 +54,112 @@
 
 #include "max_stub.h"
 #include "karma_core.h"
+#include "karma_persist.h"
 
 #define BFRAMES 16384
 #define VS      64
 #define WARM    4096          // vectors to establish the loop
+#ifndef ITERS                 // (the PGO training run builds this with fewer)
 #define ITERS   200000        // timed perform calls
+#endif
+#ifndef DPASSES
+#define DPASSES 1200          // decay bench: loop passes (BFRAMES/VS vectors each)
+#endif
+#ifndef BENCH_TAG
+#define BENCH_TAG "unified"   // the PGO build reports itself as such
+#endif
+#define DBLOCK  100           // decay bench: passes per reported block
+#define NIDLE   200           // idle bench: stopped instances
+#define NLAYER  8             // layer bench: extra playheads
 
 static void *bl(void *c){ return ((mock_buffer*)c)->data; }
 static void  bu(void *c){ (void)c; }
 static void  bd(void *c){ (void)c; }
+static karma_persist *g_persist;
+static long g_interp = 1, g_taps = 16;  // mk(): playback interpolation, sinc taps
+static int  g_mip;                      // mk(): attach a mip-map pyramid
+static int  g_shadow;                   // mk(): attach a resampled shadow
+static int  g_prerec;                   // mk(): attach a pre-record ring
+static double g_bsr = 48000.0;          // mk(): buffer sample rate
+static int  g_quiet;                    // bench(): the overdub pass at unity, input silent
+static long g_vs = VS;                  // perform(): host vector size
+static int  g_io;                       // perform(): 0 double, 1 float converted, 2 float32 entry
+static float g_fin[5][VS], g_fout[5][VS];   // perform(): the float32 host's signals (g_io)
+static void  bdr(void *c, long start, long count){ (void)c; karma_persist_note(g_persist, start, count); }
 
 static void perform(t_karma *x, double **ins, double **outs, long chans)
 {
+    float *fins[5] = { g_fin[0], g_fin[1], g_fin[2], g_fin[3], g_fin[4] };
+    float *fouts[5] = { g_fout[0], g_fout[1], g_fout[2], g_fout[3], g_fout[4] };
+    long c, i;
+
+    if (g_io == 2) {
+        karma_perform32(x, fins, fouts, g_vs);
+        return;
+    }
+    if (g_io)                                          // float in -> double
+        for (c = 0; c <= chans; c++)
+            for (i = 0; i < g_vs; i++)
+                ins[c][i] = g_fin[c][i];
     switch (chans) {
-        case 1:  karma_mono_perform(x, NULL, ins, chans+1, outs, chans, VS, 0, NULL);   break;
-        case 2:  karma_stereo_perform(x, NULL, ins, chans+1, outs, chans, VS, 0, NULL); break;
-        default: karma_quad_perform(x, NULL, ins, chans+1, outs, chans, VS, 0, NULL);   break;
+        case 1:  karma_mono_perform(x, NULL, ins, chans+1, outs, chans, g_vs, 0, NULL);   break;
+        case 2:  karma_stereo_perform(x, NULL, ins, chans+1, outs, chans, g_vs, 0, NULL); break;
+        default: karma_quad_perform(x, NULL, ins, chans+1, outs, chans, g_vs, 0, NULL);   break;
     }
+    if (g_io)                                          // double out -> float
+        for (c = 0; c < chans; c++)
+            for (i = 0; i < g_vs; i++)
+                g_fout[c][i] = (float)outs[c][i];
 }
 
-static t_karma *mk(long chans)
+// an instance on the installed buffer (on a cache line, as its perform state expects)
+static t_karma *mk_on(long chans)
 {
-    float *data = (float*)calloc((size_t)(BFRAMES*chans), sizeof(float));
-    mock_buffer_install(data, BFRAMES, chans, 48000.0);
-    t_karma *x = (t_karma*)malloc(sizeof(t_karma));
-    karma_core_init(x, chans, 48000.0, VS);
+    t_karma *x = (t_karma*)aligned_alloc(64, (sizeof(t_karma) + 63) & ~(size_t)63);
+    karma_core_init(x, chans, 48000.0, (double)g_vs);
     x->bufio.lock=bl; x->bufio.unlock=bu; x->bufio.set_dirty=bd;
-    x->bufio.ctx=mock_buffer_get(); x->bufio.frames=BFRAMES; x->bufio.chans=chans; x->bufio.sr=48000.0;
+    x->bufio.ctx=mock_buffer_get(); x->bufio.frames=BFRAMES; x->bufio.chans=chans; x->bufio.sr=g_bsr;
     karma_core_set_dims(x);
     x->speedconnect=1; x->speedfloat=1.0; x->initinit=1;
+    x->interpflag=g_interp; x->sinctaps=g_taps;
+    x->mip = g_mip ? karma_mipmap_new(BFRAMES, chans) : NULL;
+    x->shadow = g_shadow ? karma_shadow_new(BFRAMES, chans, x->srscale) : NULL;
+    x->prerec = g_prerec ? karma_prerec_new(1.0, 48000.0, chans) : NULL;
     return x;
 }
 
-static double bench(long chans)
+static t_karma *mk(long chans)
+{
+    float *data = (float*)calloc((size_t)(BFRAMES*chans), sizeof(float));
+    mock_buffer_install(data, BFRAMES, chans, g_bsr);
+    return mk_on(chans);
+}
+
+static double bench(long chans, double speed, int record, int persist)
 {
     t_karma *x = mk(chans);
+    if (persist) {
+        x->bufio.set_dirty_range = bdr;
+        g_persist = karma_persist_open("bench_persist.wav", &x->bufio, 10);
+    }
     double in_a[4][VS], in_s[VS], out_a[4][VS];
     double *ins[5], *outs[5];
     for (long c=0;c<chans;c++){ ins[c]=in_a[c]; outs[c]=out_a[c]; }
     ins[chans]=in_s;
     double ph=0;
-    for (int i=0;i<VS;i++){ in_s[i]=1.0; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+    for (int i=0;i<VS;i++){ in_s[i]=record?1.0:speed; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+    for (long c=0;c<=chans;c++) for (int i=0;i<VS;i++) g_fin[c][i]=(float)ins[c][i];
 
     karma_record(x);                                   // record initial loop
     for (long v=0; v<WARM; v++) perform(x, ins, outs, chans);
     karma_play(x);                                     // steady-state playback
-    karma_overdub(x, 0.5);
+    karma_overdub(x, g_quiet ? 1.0 : 0.5);
+    if (record) {                                      // overdub pass at `speed`
+        x->speedfloat = speed;
+        karma_record(x);
+    }
+    if (g_quiet)
+        for (int i=0;i<VS;i++) for(long c=0;c<chans;c++) in_a[c][i]=0.0;
     for (long v=0; v<WARM; v++) perform(x, ins, outs, chans);
 
     struct timespec t0,t1;
@@ -64,14 +168,232 @@ static double bench(long chans)
     clock_gettime(CLOCK_MONOTONIC, &t1);
     double ns = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
     double samples = (double)ITERS * VS * chans;
+    if (g_persist) {
+        karma_persist_stats st;
+        karma_persist_flush(g_persist);
+        karma_persist_get_stats(g_persist, &st);
+        printf("  %ld-ch persist: %llu frames in %llu passes (%.1f MB/s), max lag %.1f ms\n", chans,
+               (unsigned long long)st.frames, (unsigned long long)st.passes,
+               (double)st.frames * chans * 4 / (ns * 1e-3), st.max_lag_ms);
+        karma_persist_close(g_persist);
+        g_persist = NULL;
+        remove("bench_persist.wav");
+    }
+    karma_mipmap_free(x->mip);
+    karma_shadow_free(x->shadow);
+    karma_prerec_free(x->prerec);
     free(mock_buffer_get()->data); free(x);
     return ns / samples;
 }
 
+// Long decaying overdub (silent input, amp 0.9): ns per vector, per block of passes.
+static void bench_decay(long chans)
+{
+    t_karma *x = mk(chans);
+    double in_a[4][VS], in_s[VS], out_a[4][VS];
+    double *ins[5], *outs[5];
+    for (long c=0;c<chans;c++){ ins[c]=in_a[c]; outs[c]=out_a[c]; }
+    ins[chans]=in_s;
+    double ph=0;
+    for (int i=0;i<VS;i++){ in_s[i]=1.0; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+
+    karma_record(x);                                   // record the loop with signal
+    for (long v=0; v<WARM; v++) perform(x, ins, outs, chans);
+    karma_play(x);
+    for (long v=0; v<WARM; v++) perform(x, ins, outs, chans);
+    for (int i=0;i<VS;i++) for(long c=0;c<chans;c++) in_a[c][i]=0.0;
+    karma_overdub(x, 0.9);                             // then overdub silence: -0.9 dB per pass
+    karma_record(x);
+
+    long vpp = BFRAMES / VS;                           // vectors per loop pass
+    printf("  %ld-ch decay (ns/vector per %d passes):", chans, DBLOCK);
+    for (long p=0; p<DPASSES; p+=DBLOCK) {
+        struct timespec t0,t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (long v=0; v<DBLOCK*vpp; v++) perform(x, ins, outs, chans);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double ns = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
+        printf(" %.0f", ns / (double)(DBLOCK*vpp));
+    }
+    printf("\n");
+    free(mock_buffer_get()->data); free(x);
+}
+
+// NIDLE stopped instances on one buffer: ns per instance per vector
+static double bench_idle(long chans)
+{
+    static t_karma *xs[NIDLE];
+    t_karma *x = mk(chans);
+    double in_a[4][VS], in_s[VS], out_a[4][VS];
+    double *ins[5], *outs[5];
+    for (long c=0;c<chans;c++){ ins[c]=in_a[c]; outs[c]=out_a[c]; }
+    ins[chans]=in_s;
+    double ph=0;
+    for (int i=0;i<VS;i++){ in_s[i]=1.0; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+
+    for (long k=0; k<NIDLE; k++) {
+        xs[k] = k ? mk_on(chans) : x;
+        karma_record(xs[k]);                           // a take, played, then stopped
+        for (long v=0; v<200; v++) perform(xs[k], ins, outs, chans);
+        karma_play(xs[k]);
+        for (long v=0; v<20; v++) perform(xs[k], ins, outs, chans);
+        karma_stop(xs[k]);
+        for (long v=0; v<20; v++) perform(xs[k], ins, outs, chans);
+    }
+
+    long sweeps = ITERS / NIDLE;
+    struct timespec t0,t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long v=0; v<sweeps; v++)
+        for (long k=0; k<NIDLE; k++) perform(xs[k], ins, outs, chans);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
+    for (long k=0; k<NIDLE; k++) { karma_prerec_free(xs[k]->prerec); free(xs[k]); }
+    free(mock_buffer_get()->data);
+    return ns / ((double)sweeps * NIDLE);
+}
+
+// the loop plus NLAYER heads reading it, as instances or as voices: ns per vector
+static double bench_layers(long chans, int voices)
+{
+    static t_karma *xs[NLAYER + 1];
+    t_karma *x = mk(chans);
+    double in_a[4][VS], in_s[VS], out_a[4][VS];
+    double *ins[5], *outs[5];
+    for (long c=0;c<chans;c++){ ins[c]=in_a[c]; outs[c]=out_a[c]; }
+    ins[chans]=in_s;
+    double ph=0;
+    for (int i=0;i<VS;i++){ in_s[i]=1.0; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+
+    karma_record(x);
+    for (long v=0; v<WARM; v++) perform(x, ins, outs, chans);
+    karma_play(x);
+    xs[0] = x;
+    if (voices) {
+        x->voices = karma_voices_new(NLAYER, chans);
+        for (long k=0; k<NLAYER; k++) {
+            karma_voice_speed(x, k, 0.5 + 0.25 * k);
+            karma_voice_play(x, k);
+        }
+    } else {
+        for (long k=1; k<=NLAYER; k++) {
+            xs[k] = mk_on(chans);
+            xs[k]->speedconnect = 0;
+            xs[k]->speedfloat = 0.5 + 0.25 * (k - 1);
+            karma_play(xs[k]);
+        }
+    }
+    long n = voices ? 1 : NLAYER + 1, vecs = ITERS / 4;
+    for (long v=0; v<WARM; v++)
+        for (long k=0; k<n; k++) perform(xs[k], ins, outs, chans);
+
+    struct timespec t0,t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long v=0; v<vecs; v++)
+        for (long k=0; k<n; k++) perform(xs[k], ins, outs, chans);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
+    karma_voices_free(x->voices);
+    for (long k=1; k<n; k++) free(xs[k]);
+    free(mock_buffer_get()->data); free(x);
+    return ns / (double)vecs;
+}
+
+// 1x playback at host vector size g_vs: ns per perform call
+static double bench_call(long chans)
+{
+    t_karma *x = mk(chans);
+    double in_a[4][VS], in_s[VS], out_a[4][VS];
+    double *ins[5], *outs[5];
+    for (long c=0;c<chans;c++){ ins[c]=in_a[c]; outs[c]=out_a[c]; }
+    ins[chans]=in_s;
+    double ph=0;
+    for (int i=0;i<VS;i++){ in_s[i]=1.0; for(long c=0;c<chans;c++){ in_a[c][i]=0.25*sin(ph); } ph+=0.01; }
+
+    long warm = WARM * VS / g_vs, calls = ITERS * (VS / 4) / g_vs;
+    karma_record(x);
+    for (long v=0; v<warm; v++) perform(x, ins, outs, chans);
+    karma_play(x);
+    for (long v=0; v<warm; v++) perform(x, ins, outs, chans);
+
+    struct timespec t0,t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long v=0; v<calls; v++) perform(x, ins, outs, chans);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
+    free(mock_buffer_get()->data); free(x);
+    return ns / (double)calls;
+}
+
 int main(void)
 {
-    printf("=== karma_core (unified) perform-only ===\n");
+    printf("=== karma_core (" BENCH_TAG ") perform-only ===\n");
+    for (long c=1;c<=4;c*=2)
+        printf("  %ld-ch: %.3f ns/sample\n", c, bench(c, 1.0, 0, 0));
+    for (long c=1;c<=4;c*=2)                           // off-frame: every sample interpolates
+        printf("  %ld-ch 1.5x play: %.3f ns/sample\n", c, bench(c, 1.5, 0, 0));
+    g_interp = 3;
+    for (g_taps=8;g_taps<=32;g_taps*=2)
+        for (long c=1;c<=4;c*=2)
+            printf("  %ld-ch sinc %ld: 1.5x %.3f ns/sample, 4x %.3f ns/sample\n", c, g_taps, bench(c, 1.5, 0, 0), bench(c, 4.0, 0, 0));
+    g_interp = 1; g_taps = 16;
+    for (long c=1;c<=4;c*=2) {
+        double plain = bench(c, 5.5, 0, 0);
+        g_mip = 1;
+        printf("  %ld-ch 5.5x play: %.3f ns/sample, mip-map: %.3f ns/sample\n", c, plain, bench(c, 5.5, 0, 0));
+        g_mip = 0;
+    }
+    g_bsr = 44100.0;
+    for (long c=1;c<=4;c*=2) {
+        double plain = bench(c, 1.0, 0, 0);
+        g_shadow = 1;
+        printf("  %ld-ch 44.1k buffer: %.3f ns/sample, shadow: %.3f ns/sample\n", c, plain, bench(c, 1.0, 0, 0));
+        g_shadow = 0;
+    }
+    g_bsr = 48000.0;
+    for (long c=1;c<=4;c*=2)
+        printf("  %ld-ch 8x record: %.3f ns/sample\n", c, bench(c, 8.0, 1, 0));
+    for (long c=1;c<=4;c*=2) {
+        double plain = bench(c, 1.0, 1, 0), ns = bench(c, 1.0, 1, 1);
+        printf("  %ld-ch 1x record: %.3f ns/sample, + persist: %.3f ns/sample\n", c, plain, ns);
+    }
+    g_quiet = 1;
+    for (long c=1;c<=4;c*=2) {
+        double plain = bench(c, 1.0, 1, 0), ns = bench(c, 1.0, 1, 1);
+        printf("  %ld-ch 1x silent overdub: %.3f ns/sample, + persist: %.3f ns/sample\n", c, plain, ns);
+    }
+    g_quiet = 0;
+    for (long c=1;c<=4;c*=2) {
+        double ns[2];
+        for (g_io=1; g_io<=2; g_io++)
+            ns[g_io-1] = bench(c, 1.0, 0, 0);
+        g_io = 0;
+        printf("  %ld-ch float32 I/O: converted %.3f ns/sample, karma_perform32 %.3f ns/sample\n", c, ns[0], ns[1]);
+    }
+    for (long c=1;c<=4;c*=2)
+        printf("  %ld-ch idle x%d: %.1f ns/vector per instance\n", c, NIDLE, bench_idle(c));
+    for (long c=1;c<=4;c*=2) {
+        double play = bench(c, 1.0, 0, 0), idle = bench_idle(c), ns[2];
+        g_prerec = 1;
+        ns[0] = bench(c, 1.0, 0, 0);
+        ns[1] = bench_idle(c);
+        g_prerec = 0;
+        printf("  %ld-ch pre-record ring: 1x play %.3f -> %.3f ns/sample, idle %.1f -> %.1f ns/vector\n", c, play, ns[0], idle, ns[1]);
+    }
+    for (long c=1;c<=4;c*=2) {
+        double inst = bench_layers(c, 0), voic = bench_layers(c, 1);
+        printf("  %ld-ch loop + %d layers: as instances %.0f ns/vector, as voices %.0f ns/vector\n", c, NLAYER, inst, voic);
+    }
+    for (long c=1;c<=4;c*=2) {
+        double ns[3];
+        for (int k=0; k<3; k++) {
+            g_vs = 1L << (2*k);                        // 1, 4, 16
+            ns[k] = bench_call(c);
+        }
+        g_vs = VS;
+        printf("  %ld-ch VS 1 / 4 / 16: %.1f / %.1f / %.1f ns/call\n", c, ns[0], ns[1], ns[2]);
+    }
     for (long c=1;c<=4;c*=2)
-        printf("  %ld-ch: %.3f ns/sample\n", c, bench(c));
+        bench_decay(c);
     return 0;
 }
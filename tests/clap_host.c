@@ -0,0 +1,219 @@
+// Minimal offline CLAP host for the karma_clap plugin.
+//
+// Loads build/karma_re.clap (or argv[1]) through its clap_entry, activates it at
+// 48 kHz and drives a scripted session through process() with parameter events
+// placed inside the blocks:
+//
+//   record at frame REC_AT, play at PLAY_AT (neither on a block boundary), then
+//   a speed change.
+//
+// Checks:
+//   - the entry / factory / audio-ports / params plumbing;
+//   - sample accuracy: play closes the initial loop RAMP frames after its event
+//     (the core's record-off fade) and then plays it from the start, so the
+//     output is silent up to PLAY_AT + RAMP, the loop is exactly
+//     PLAY_AT - REC_AT + RAMP frames long, and it holds the input from REC_AT on;
+//   - block-size independence: the same script at host blocks of 512, 97 and 1
+//     frames produces identical output (events land on the same frame however
+//     the host slices the stream);
+//   - smoothing: across the speed change the played-back sine's per-sample step
+//     changes gradually (an unsmoothed 1x -> 0.5x jump halves it at once).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dlfcn.h>
+
+#include <clap/clap.h>
+
+#define SR        48000.0
+#define TOTAL     96000           // frames per run
+#define REC_AT    1137
+#define PLAY_AT   25345
+#define SPEED_AT  60056           // a zero crossing of the played-back sine
+#define FREQ      220.0
+#define RAMP      256             // the core's default globalramp
+
+static int g_pass, g_fail;
+
+static void check(int ok, const char *what)
+{
+    if (ok) {
+        g_pass++;
+    } else {
+        g_fail++;
+        printf("  FAIL: %s\n", what);
+    }
+}
+
+// --- event list ------------------------------------------------------------
+typedef struct {
+    clap_event_param_value_t ev[8];
+    uint32_t n;
+} evlist;
+
+static uint32_t ev_size(const clap_input_events_t *l)                   { return ((const evlist *)l->ctx)->n; }
+static const clap_event_header_t *ev_get(const clap_input_events_t *l, uint32_t i) { return &((const evlist *)l->ctx)->ev[i].header; }
+static bool ev_push(const clap_output_events_t *l, const clap_event_header_t *e) { (void)l; (void)e; return true; }
+
+static void ev_add(evlist *l, uint32_t time, clap_id id, double value)
+{
+    clap_event_param_value_t *e = &l->ev[l->n++];
+
+    memset(e, 0, sizeof(*e));
+    e->header.size = sizeof(*e);
+    e->header.time = time;
+    e->header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+    e->header.type = CLAP_EVENT_PARAM_VALUE;
+    e->param_id = id;
+    e->note_id = -1;
+    e->port_index = e->channel = e->key = -1;
+    e->value = value;
+}
+
+// --- host ------------------------------------------------------------------
+static const void *host_ext(const clap_host_t *h, const char *id) { (void)h; (void)id; return NULL; }
+static void host_req(const clap_host_t *h)                         { (void)h; }
+
+static const clap_host_t g_host = {
+    CLAP_VERSION_INIT, NULL, "karma clap_host", "karma", "", "1.0",
+    host_ext, host_req, host_req, host_req
+};
+
+static float g_in[2][TOTAL];
+
+// one full session in host blocks of `block` frames; out: the left output
+static int run(const clap_plugin_factory_t *f, const char *id, uint32_t block, float *out)
+{
+    const clap_plugin_t *p = f->create_plugin(f, &g_host, id);
+    static float o[2][TOTAL];
+    uint32_t t, n, i;
+
+    if (!p || !p->init(p) || !p->activate(p, SR, 1, block) || !p->start_processing(p))
+        return 0;
+    for (t = 0; t < TOTAL; t += n) {
+        evlist ev = { .n = 0 };
+        clap_input_events_t in_ev = { &ev, ev_size, ev_get };
+        clap_output_events_t out_ev = { NULL, ev_push };
+        float *ip[2] = { g_in[0] + t, g_in[1] + t }, *op[2] = { o[0] + t, o[1] + t };
+        clap_audio_buffer_t ai = { ip, NULL, 2, 0, 0 }, ao = { op, NULL, 2, 0, 0 };
+        clap_process_t pr;
+
+        n = (TOTAL - t < block) ? (TOTAL - t) : block;
+        if (REC_AT >= t && REC_AT < t + n)     ev_add(&ev, REC_AT - t, 0, 2.0);     // State: record
+        if (PLAY_AT >= t && PLAY_AT < t + n)   ev_add(&ev, PLAY_AT - t, 0, 1.0);    // State: play
+        if (SPEED_AT >= t && SPEED_AT < t + n) ev_add(&ev, SPEED_AT - t, 1, 0.5);   // Speed: 0.5x
+        memset(&pr, 0, sizeof(pr));
+        pr.steady_time = t;
+        pr.frames_count = n;
+        pr.audio_inputs = &ai;
+        pr.audio_inputs_count = 1;
+        pr.audio_outputs = &ao;
+        pr.audio_outputs_count = 1;
+        pr.in_events = &in_ev;
+        pr.out_events = &out_ev;
+        if (p->process(p, &pr) != CLAP_PROCESS_CONTINUE)
+            return 0;
+    }
+    for (i = 0; i < TOTAL; i++)
+        out[i] = o[0][i];
+    p->stop_processing(p);
+    p->deactivate(p);
+    p->destroy(p);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "karma_re.clap";
+    static float a[TOTAL], b[TOTAL];
+    void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    const clap_plugin_entry_t *entry;
+    const clap_plugin_factory_t *f;
+    const clap_plugin_descriptor_t *d;
+    const clap_plugin_t *p;
+    const clap_plugin_audio_ports_t *ports;
+    const clap_plugin_params_t *params;
+    clap_audio_port_info_t pi;
+    clap_param_info_t info;
+    double v, maxd, dstep;
+    long i, len = PLAY_AT - REC_AT + RAMP;
+    int ok;
+
+    printf("=== CLAP host (karma_clap) ===\n");
+    if (!lib) {
+        printf("  FAIL: dlopen %s: %s\n", path, dlerror());
+        return 1;
+    }
+    entry = (const clap_plugin_entry_t *)dlsym(lib, "clap_entry");
+    check(entry && clap_version_is_compatible(entry->clap_version), "clap_entry exported");
+    if (!entry || !entry->init(path))
+        return 1;
+    f = (const clap_plugin_factory_t *)entry->get_factory(CLAP_PLUGIN_FACTORY_ID);
+    check(f && f->get_plugin_count(f) == 1, "one plugin in the factory");
+    if (!f)
+        return 1;
+    d = f->get_plugin_descriptor(f, 0);
+
+    // plumbing
+    p = f->create_plugin(f, &g_host, d->id);
+    check(p && p->init(p), "create + init");
+    ports = (const clap_plugin_audio_ports_t *)p->get_extension(p, CLAP_EXT_AUDIO_PORTS);
+    params = (const clap_plugin_params_t *)p->get_extension(p, CLAP_EXT_PARAMS);
+    check(ports && ports->count(p, true) == 1 && ports->count(p, false) == 1, "one input and one output port");
+    check(ports && ports->get(p, 0, false, &pi) && pi.channel_count == 2, "stereo output");
+    check(params && params->count(p) == 5, "five parameters");
+    check(params && params->get_info(p, 1, &info) && !strcmp(info.name, "Speed") && info.default_value == 1.0, "Speed info");
+    check(params && params->get_value(p, 2, &v) && v == 1.0, "Overdub default");
+    p->destroy(p);
+
+    for (i = 0; i < TOTAL; i++) {
+        g_in[0][i] = (float)(0.5 * sin(2.0 * M_PI * FREQ * (double)i / SR));
+        g_in[1][i] = (float)(0.5 * cos(2.0 * M_PI * FREQ * (double)i / SR));
+    }
+
+    ok = run(f, d->id, 512, a);
+    check(ok, "session at 512-frame blocks");
+
+    // silent until the loop closes, then the input from the record frame on
+    maxd = 0.0;
+    for (i = 0; i <= PLAY_AT + RAMP; i++)
+        maxd = fmax(maxd, fabs(a[i]));
+    check(maxd == 0.0, "silent until the loop closes");
+    check(a[PLAY_AT + RAMP + 1] != 0.0f, "playing from the loop start");
+    maxd = 0.0;
+    for (i = 2048; i < len - 2048; i++)                 // clear of the loop-edge fades
+        maxd = fmax(maxd, fabs(a[PLAY_AT + RAMP + i] - g_in[0][REC_AT + i]));
+    check(maxd == 0.0, "loop = the input from the record event");
+    maxd = 0.0;
+    for (i = 2048; i < SPEED_AT - (PLAY_AT + RAMP + len); i++)     // second pass, up to the speed change
+        maxd = fmax(maxd, fabs(a[PLAY_AT + RAMP + len + i] - g_in[0][REC_AT + i]));
+    check(maxd == 0.0, "loop is PLAY_AT - REC_AT + RAMP frames long");
+
+    // second difference of the output across the speed change
+    maxd = 0.0;
+    for (i = SPEED_AT - 100; i < SPEED_AT + 2000; i++) {
+        dstep = fabs((double)a[i] - 2.0 * (double)a[i - 1] + (double)a[i - 2]);
+        maxd = fmax(maxd, dstep);
+    }
+    check(maxd < 1e-3, "speed change is smoothed");
+
+    ok = run(f, d->id, 97, b);
+    check(ok, "session at 97-frame blocks");
+    maxd = 0.0;
+    for (i = 0; i < TOTAL; i++)
+        maxd = fmax(maxd, fabs(a[i] - b[i]));
+    check(maxd == 0.0, "97-frame blocks == 512-frame blocks");
+    ok = run(f, d->id, 1, b);
+    check(ok, "session at 1-frame blocks");
+    maxd = 0.0;
+    for (i = 0; i < TOTAL; i++)
+        maxd = fmax(maxd, fabs(a[i] - b[i]));
+    check(maxd == 0.0, "1-frame blocks == 512-frame blocks");
+
+    entry->deinit();
+    dlclose(lib);
+    printf("%d passed, %d failed\n", g_pass, g_fail);
+    return g_fail ? 1 : 0;
+}
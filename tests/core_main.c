@@ -8,6 +8,10 @@
 #include "karma_core.h"   // the Max-free core (defines t_karma, control + perform)
 #include "scenarios.h"
 
+#ifndef CORE_TAG
+#define CORE_TAG "core"   // output prefix (the PGO build writes pgo_*.bin)
+#endif
+
 // Host buffer interface backed by the same mock buffer scenarios.h reads.
 static void *core_lock(void *ctx)     { return ((mock_buffer *)ctx)->data; }
 static void  core_unlock(void *ctx)   { (void)ctx; }
@@ -47,7 +51,7 @@ static void perform(t_karma *x, double **ins, long nins, double **outs, long nou
 int main(void)
 {
     printf("=== karma_core ===\n");
-    run_all_scenarios(construct, perform, NULL, "core", 4);   // core has no report outlet
+    run_all_scenarios(construct, perform, NULL, CORE_TAG, 4);   // core has no report outlet
     printf("OK\n");
     return 0;
 }
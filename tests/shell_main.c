@@ -17,6 +17,10 @@
 #define SCN_DATA_ONLY
 #include "scenarios.h"        // scenario catalogue (data only)
 
+#ifndef SHELL_TAG
+#define SHELL_TAG "shell"     // output prefix (the PGO build writes shellpgo_*.bin)
+#endif
+
 static t_karma_re *construct(long frames, long bchans, long ochans, double sr)
 {
     static int classed = 0;
@@ -116,6 +120,58 @@ static void run_one(t_karma_re *x, const scenario *sc, FILE *out)
     fwrite(rep, sizeof(double), (size_t)nr, out);
 }
 
+// 'set' with DSP running: a crossfaded switch, and a second 'set' during it that
+// waits for its end and is then made (the stub's buffer refs are all one buffer)
+static int set_switching(void)
+{
+    const long chans = 2, frames = 48000;
+    double in_audio[2][SCN_VS], in_speed[SCN_VS], out_audio[2][SCN_VS];
+    double *ins[3] = { in_audio[0], in_audio[1], in_speed }, *outs[2] = { out_audio[0], out_audio[1] };
+    t_symbol *b1 = gensym("other"), *b2 = gensym("third");
+    t_atom a;
+    long v, n;
+    int ok = 1, finite = 1;
+    t_karma_re *x = construct(frames, chans, chans, 48000.0);
+    if (!x) return 0;
+
+    x->xfade = 8 * SCN_VS;
+    for (v = 0; v < 200; v++) {
+        if (v == 0)   karma_re_record(x);
+        if (v == 100) karma_re_play(x);
+        for (int i = 0; i < SCN_VS; i++) {
+            in_audio[0][i] = 0.3 * sin(0.01 * (v * SCN_VS + i));
+            in_audio[1][i] = 0.2 * cos(0.013 * (v * SCN_VS + i));
+            in_speed[i] = 1.0;
+        }
+        if (v == 150) {
+            atom_setsym(&a, b1);
+            karma_re_set(x, gensym("set"), 1, &a);
+            ok &= !x->sw.done && (x->bufname == b1);
+        }
+        perform(x, ins, 3, outs, 2, SCN_VS);
+        if (v == 150) {                             // fading: a second set waits, the clock too
+            ok &= (x->core.fading == &x->sw) && x->sw.made;
+            atom_setsym(&a, b2);
+            karma_re_set(x, gensym("set"), 1, &a);
+            karma_re_setnext(x);
+            ok &= (x->setnext == b2) && (x->bufname == b1) && !x->sw.done;
+        }
+        for (int i = 0; i < SCN_VS; i++)
+            finite &= isfinite(out_audio[0][i]) && isfinite(out_audio[1][i]);
+    }
+    ok &= x->sw.done && !x->core.fading;
+    karma_re_setnext(x);                            // over: the waiting set is made
+    ok &= (x->setnext == NULL) && (x->bufname == b2) && !x->sw.done;
+    for (n = 0; (n < 20) && !atomic_load(&x->sw.done); n++, v++)
+        perform(x, ins, 3, outs, 2, SCN_VS);
+    ok &= x->sw.done && x->sw.made && (n == 8);     // served at the next vector, faded over 8
+    ok &= finite;
+    printf("  set while switching: %s\n", ok ? "ok" : "FAIL");
+    free(mock_buffer_get()->data);
+    free(x);
+    return ok;
+}
+
 int main(void)
 {
     printf("=== karma_re~ shell ===\n");
@@ -124,7 +180,7 @@ int main(void)
         const scenario *sc = &g_scenarios[s];
         t_karma_re *x = construct(sc->frames, scn_bchans(sc), sc->chans, sc->sr);
         if (!x) continue;
-        snprintf(path, sizeof(path), "shell_%s.bin", sc->name);
+        snprintf(path, sizeof(path), "%s_%s.bin", SHELL_TAG, sc->name);
         FILE *f = fopen(path, "wb");
         if (!f) continue;
         run_one(x, sc, f);
@@ -133,6 +189,8 @@ int main(void)
         free(mock_buffer_get()->data);
         free(x);
     }
+    if (!set_switching())
+        return 1;
     printf("OK\n");
     return 0;
 }
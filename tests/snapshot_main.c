@@ -0,0 +1,165 @@
+// karma_snapshot check: take a snapshot of a recording / overdubbing instance at
+// a vector boundary, write it, let the instance move on, then recall the file
+// (mapped, and copied into a host buffer) and verify the instance continues
+// exactly like a twin copied at the snapshot -- output and buffer, sample for
+// sample -- while the file itself never changes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "karma_core.h"
+#include "karma_snapshot.h"
+
+#define FRAMES  24000
+#define CHANS   2
+#define VS      64
+#define PATH    "snapshot_test.ksnap"
+
+static float g_buf[FRAMES * CHANS], g_twin[FRAMES * CHANS], g_saved[FRAMES * CHANS];
+static int   g_fail;
+
+static void *lk(void *c)  { return c; }
+static void  ul(void *c)  { (void)c; }
+static void  sd(void *c)  { (void)c; }
+
+static void expect(int cond, const char *what)
+{
+    printf("  %-46s %s\n", what, cond ? "ok" : "FAIL");
+    if (!cond) g_fail++;
+}
+
+static void setup(t_karma *x, float *buf)
+{
+    karma_core_init(x, CHANS, 48000.0, VS);
+    x->bufio.lock = lk; x->bufio.unlock = ul; x->bufio.set_dirty = sd;
+    x->bufio.ctx = buf; x->bufio.frames = FRAMES; x->bufio.chans = CHANS; x->bufio.sr = 48000.0;
+    karma_core_set_dims(x);
+    x->speedconnect = 1; x->initinit = 1;
+}
+
+// vector v of the session (controls first), into x
+static void run(t_karma *x, long v, double *o0, double *o1)
+{
+    double in0[VS], in1[VS], insp[VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+
+    if (v == 0)   karma_record(x);
+    if (v == 300) karma_play(x);
+    if (v == 350) karma_select_size(x, 0.6);
+    if (v == 400) { karma_overdub(x, 0.7); karma_record(x); }
+    if (v == 700) karma_jump(x, 0.25);
+    if (v == 800) karma_play(x);
+    for (int i = 0; i < VS; i++) {
+        in0[i]  = 0.3 * sin(0.01 * (v * VS + i));
+        in1[i]  = 0.2 * cos(0.013 * (v * VS + i));
+        insp[i] = (v < 500) ? 1.0 : 0.8;
+    }
+    karma_stereo_perform(x, NULL, ins, 3, outs, 2, VS, 0, NULL);
+}
+
+// x and its twin from vector `from` to `to`: 0 if any output sample differs
+static int same_run(t_karma *x, t_karma *twin, long from, long to)
+{
+    double a0[VS], a1[VS], b0[VS], b1[VS];
+    int same = 1;
+
+    for (long v = from; v < to; v++) {
+        run(x, v, a0, a1);
+        run(twin, v, b0, b1);
+        same &= !memcmp(a0, b0, sizeof(a0)) && !memcmp(a1, b1, sizeof(a1));
+    }
+    return same;
+}
+
+static int file_buffer_is(const float *want)
+{
+    karma_snapshot *s = karma_core_load(PATH, NULL);
+    int ok = s && !memcmp(karma_snapshot_snap(s)->bufio.lock(karma_snapshot_snap(s)->bufio.ctx), want, FRAMES * CHANS * sizeof(float));
+
+    karma_snapshot_free(s);
+    return ok;
+}
+
+int main(void)
+{
+    t_karma *x = (t_karma *)malloc(sizeof(t_karma)), *twin = (t_karma *)malloc(sizeof(t_karma));
+    t_karma *saved = (t_karma *)malloc(sizeof(t_karma));
+    double o0[VS], o1[VS];
+    karma_snap r;
+    karma_snapshot *s, *s2;
+    karma_buffer_iface io;
+    long v;
+
+    printf("=== karma_snapshot ===\n");
+    setup(x, g_buf);
+    for (v = 0; v < 600; v++)
+        run(x, v, o0, o1);
+
+    karma_core_snap(x, &r);                         // taken at the end of vector 600
+    expect(!r.done, "snap waits for the vector boundary");
+    run(x, v++, o0, o1);
+    expect(r.done && !x->snapreq, "snap served at the end of the vector");
+    expect(!memcmp(&r.st, &x->st, sizeof(r.st)), "snap holds the perform state");
+    expect(karma_core_save(&r, PATH) == 0, "save");
+    memcpy(g_saved, g_buf, sizeof(g_buf));
+    *saved = *x;
+    {                                               // one pending: a second displaces the first
+        karma_snap r2, r3;
+        karma_core_snap(x, &r2);
+        expect((karma_core_snap(x, &r3) == &r2) && r2.done && !r3.done, "a second snap displaces the first, done");
+        run(x, v++, o0, o1);
+        expect(r3.done && !x->snapreq && (r3.st.playhead == x->playhead), "the second is served");
+    }
+
+    for (; v < 900; v++)                            // the instance moves on
+        run(x, v, o0, o1);
+    karma_select_start(x, 0.2);                     // (and is set up otherwise)
+    karma_select_size(x, 0.3);
+    karma_overdub(x, 0.2);
+    x->speedfloat = -1.0;
+
+    *twin = *saved;                                 // the reference: a copy at the snapshot
+    memcpy(g_twin, g_saved, sizeof(g_twin));
+    twin->bufio.ctx = g_twin;
+    s = karma_core_load(PATH, NULL);
+    expect(s != NULL, "load (mapped)");
+    if (!s) return 1;
+    karma_core_recall(x, karma_snapshot_snap(s));
+    expect(!karma_snapshot_snap(s)->done, "recall waits for the vector boundary");
+    expect(same_run(x, twin, 601, 1000), "recalled instance plays on like the twin");
+    expect((x->selstart == twin->selstart) && (x->selection == twin->selection) && (x->speedfloat == twin->speedfloat),
+           "recall restores the window and speed");
+    expect(karma_snapshot_snap(s)->done && !x->recall && (x->bufio.ctx == (void *)s), "recall swapped in the mapped buffer");
+    expect(!memcmp(x->bufio.lock(x->bufio.ctx), g_twin, sizeof(g_twin)), "mapped buffer recorded like the twin's");
+    expect(file_buffer_is(g_saved), "file unchanged by recording on the mapping");
+
+    io = saved->bufio;                              // into a host buffer instead
+    s2 = karma_core_load(PATH, &io);
+    expect(s2 != NULL, "load (into a host buffer)");
+    if (!s2) return 1;
+    expect(!memcmp(g_buf, g_saved, sizeof(g_buf)), "host buffer holds the snapshot");
+    karma_core_recall(x, karma_snapshot_snap(s2));
+    *twin = *saved;
+    memcpy(g_twin, g_saved, sizeof(g_twin));
+    twin->bufio.ctx = g_twin;
+    expect(same_run(x, twin, 601, 1000), "recalled onto the host buffer, plays on alike");
+    expect((x->bufio.ctx == (void *)g_buf) && !memcmp(g_buf, g_twin, sizeof(g_buf)), "host buffer recorded like the twin's");
+    karma_snapshot_free(s);                         // (the instance left the mapping)
+    karma_snapshot_free(s2);
+
+    io.frames = FRAMES / 2;                         // refused: other dimensions, other version
+    expect(karma_core_load(PATH, &io) == NULL, "load refuses a buffer of other size");
+    {
+        FILE *f = fopen(PATH, "r+b");
+        unsigned char ver = KARMA_SNAPSHOT_VERSION + 1;
+        if (f) { fseek(f, 8, SEEK_SET); fwrite(&ver, 1, 1, f); fclose(f); }
+    }
+    expect(karma_core_load(PATH, NULL) == NULL, "load refuses another version");
+
+    remove(PATH);
+    free(x); free(twin); free(saved);
+    printf("%s\n", g_fail ? "SNAPSHOT FAILED" : "SNAPSHOT OK");
+    return g_fail ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+# Python bindings (karma_py.c): zero-copy buffer, process(), the GIL released.
+#
+# Run by `make py` (PYTHONPATH = the build dir holding the extension). Checks:
+#   - the looper records straight into the caller's NumPy array, which can't be
+#     resized (nor an array.array grown) while a looper holds it;
+#   - record / play reach the core on the frame they are called at: the loop
+#     plays back the input exactly, and chunking process() calls differently
+#     gives identical output;
+#   - a speed signal and a constant speed agree;
+#   - float32 audio (the core's float32 entry point) gives the float64 output
+#     rounded to float32, and records the same loop;
+#   - loopers rendered from a thread pool match the same loopers rendered one
+#     after another (and report the parallel speedup), and another Python
+#     thread keeps running while process() works;
+#   - bad buffers are refused.
+
+import array
+import os
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+import karma
+
+SR = 48000.0
+RAMP = 256                      # the core's default globalramp (record-off fade)
+passed = failed = 0
+
+
+def check(ok, what):
+    global passed, failed
+    if ok:
+        passed += 1
+    else:
+        failed += 1
+        print("  FAIL: " + what)
+
+
+def sine(n, chans, f=220.0, start=0):
+    t = np.arange(start, start + n) / SR
+    return np.array([0.5 * np.sin(2 * np.pi * f * (c + 1) * t) for c in range(chans)])
+
+
+def session(buf, chunk, rec=4000, play=28000, total=80000):
+    """record at frame `rec`, play at `play`; process() in pieces of at most `chunk`"""
+    lp = karma.Looper(buf, samplerate=SR)
+    x = sine(total, buf.shape[1])
+    out = np.empty_like(x)
+    pos = 0
+    while pos < total:
+        if pos == rec:
+            lp.record()
+        if pos == play:
+            lp.play()
+        end = min(pos + chunk, total, *[e for e in (rec, play) if e > pos])
+        out[:, pos:end] = lp.process(np.ascontiguousarray(x[:, pos:end]), 1.0)
+        pos = end
+    return lp, x, out
+
+
+print("=== karma Python bindings ===")
+
+# zero copy + pinning
+buf = np.zeros((48000, 2), np.float32)
+lp, x, out = session(buf, 64)
+check(lp.buffer is buf, "looper.buffer is the caller's array")
+check(np.abs(buf).max() > 0.1, "recorded into the caller's array")
+check(lp.state == "play", "state after play")
+try:
+    buf.resize((10, 2))
+    check(False, "numpy array can't be resized while a looper holds it")
+except ValueError:
+    check(True, "numpy array can't be resized while a looper holds it")
+arr = array.array("f", bytes(4 * 4096))
+alp = karma.Looper(arr)
+try:
+    arr.append(0.0)
+    check(False, "array.array can't grow while a looper holds it")
+except BufferError:
+    check(True, "array.array can't grow while a looper holds it")
+del alp
+arr.append(0.0)                 # released with the looper
+
+# the loop: the input from the record frame on, RAMP frames past the play call
+L = 28000 - 4000 + RAMP
+got = out[:, 28000 + RAMP + 2048:28000 + RAMP + L - 2048]
+want = x[:, 4000 + 2048:4000 + L - 2048].astype(np.float32).astype(np.float64)
+check(np.array_equal(got, want), "loop plays back the input from the record call")
+check(lp.loop == (0, L - 1), "loop is %d frames (the play call + RAMP)" % L)
+
+# chunking: 64-frame calls vs 4000-frame calls (control on the same frames)
+_, _, out2 = session(np.zeros((48000, 2), np.float32), 4000)
+check(np.array_equal(out, out2), "4000-frame process() calls == 64-frame calls")
+
+# speed signal vs constant
+def halfspeed(signal):
+    b = np.zeros((48000, 1), np.float32)
+    lp = karma.Looper(b, samplerate=SR)
+    x = sine(30000, 1)
+    lp.record()
+    lp.process(x[:, :20000])
+    lp.play()
+    if signal:
+        return lp.process(x[:, 20000:], np.full(10000, 0.5))
+    return lp.process(x[:, 20000:], 0.5)
+check(np.array_equal(halfspeed(True), halfspeed(False)), "speed signal == constant speed")
+# float32 I/O vs float64 I/O on the same (float32) samples
+def typed(dtype):
+    b = np.zeros((48000, 2), np.float32)
+    lp = karma.Looper(b, samplerate=SR)
+    x = sine(40000, 2).astype(np.float32).astype(dtype)
+    lp.record()
+    o1 = lp.process(np.ascontiguousarray(x[:, :20000]))
+    lp.play()
+    lp.overdub(0.6)
+    lp.record()
+    o2 = lp.process(np.ascontiguousarray(x[:, 20000:]), np.linspace(1.5, -0.75, 20000).astype(np.float32).astype(dtype))
+    return np.concatenate((o1, o2), axis=1), b
+o32, b32 = typed(np.float32)
+o64, b64 = typed(np.float64)
+check(o32.dtype == np.float32 and np.array_equal(o32, o64.astype(np.float32)), "float32 process() == float64 process() rounded")
+check(np.array_equal(b32, b64), "float32 process() records the same loop")
+for kw, what in (({"speed": np.ones(64)}, "float64 speed with float32 inputs"),
+                 ({"out": np.empty((2, 64))}, "float64 out with float32 inputs")):
+    try:
+        karma.Looper(np.zeros((100, 2), np.float32)).process(np.zeros((2, 64), np.float32), **kw)
+        check(False, what + " refused")
+    except TypeError:
+        check(True, what + " refused")
+mono = karma.Looper(np.zeros(4096, np.float32)).process(np.zeros(100))
+check(mono.shape == (100,), "1-D buffer and inputs for mono")
+
+# thread pool: same results as serial, GIL released
+def render(seed):
+    b = np.zeros((96000, 2), np.float32)
+    lp = karma.Looper(b, samplerate=SR)
+    x = sine(400000, 2, f=110.0 + seed)
+    lp.record()
+    lp.process(np.ascontiguousarray(x[:, :30000]))
+    lp.play()
+    lp.overdub(0.7)
+    lp.record()
+    return lp.process(np.ascontiguousarray(x[:, 30000:]), np.linspace(0.5, 2.0, 370000))
+
+N = 8
+t0 = time.perf_counter()
+serial = [render(i) for i in range(N)]
+t1 = time.perf_counter()
+with ThreadPoolExecutor(max_workers=min(N, os.cpu_count() or 1)) as pool:
+    parallel = list(pool.map(render, range(N)))
+t2 = time.perf_counter()
+check(all(np.array_equal(a, b) for a, b in zip(serial, parallel)), "thread pool renders == serial renders")
+print("  %d loopers: serial %.2f s, thread pool %.2f s (%.1fx on %d cpus)"
+      % (N, t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1), os.cpu_count() or 1))
+
+# the GIL is released inside process(): this thread keeps running meanwhile
+b = np.zeros((96000, 2), np.float32)
+glp = karma.Looper(b, vectorsize=1)       # one core call per frame: a long process()
+gx = sine(1000000, 2)
+span = []
+def work():
+    t = time.perf_counter()
+    glp.process(gx, 1.5)
+    span.extend((t, time.perf_counter()))
+worker = threading.Thread(target=work)
+ticks = []
+worker.start()
+while worker.is_alive():
+    now = time.perf_counter()
+    if not ticks or now - ticks[-1] > 0.001:
+        ticks.append(now)
+worker.join()
+inside = sum(1 for t in ticks if span[0] < t < span[1])
+check(inside > 250 * (span[1] - span[0]), "the GIL is released while processing (%d ticks in %.3f s)" % (inside, span[1] - span[0]))
+
+# refused buffers
+for bad, what in ((np.zeros((100, 2)), "float64 buffer"),
+                  (np.zeros((100, 2), np.float32)[::2], "strided buffer"),
+                  (bytes(400), "read-only buffer")):
+    try:
+        karma.Looper(bad)
+        check(False, what + " refused")
+    except (TypeError, ValueError, BufferError):
+        check(True, what + " refused")
+try:
+    karma.Looper(np.zeros((100, 2), np.float32)).process(np.zeros((1, 64)))
+    check(False, "wrong input shape refused")
+except ValueError:
+    check(True, "wrong input shape refused")
+
+print("%d passed, %d failed" % (passed, failed))
+sys.exit(1 if failed else 0)
@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <stddef.h>
 #include "karma_core.c"
 
 static int g_pass = 0, g_fail = 0;
@@ -120,7 +121,7 @@ static void test_ease_bufoff(void)
     for (int i = 0; i < N; i++) b[i] = 1.0f;
 
     long mark = 10, ramp = 4;
-    ease_bufoff(/*framesm1*/ N - 1, b, /*pchans*/ 1, mark, /*dir*/ 1, (double)ramp);
+    ease_bufoff(/*framesm1*/ N - 1, b, /*pstride*/ 1, /*pchans*/ 1, mark, /*dir*/ 1, (double)ramp);
 
     CHECK_EQ(b[9],  1.0, 1e-6);   // before mark: untouched
     CHECK_EQ(b[10], 0.5 * (1.0 - cos(0.0 * PI / ramp)), 1e-6);          // i=0 -> 0
@@ -131,7 +132,7 @@ static void test_ease_bufoff(void)
 
     // out-of-range mark must not crash or write
     for (int i = 0; i < N; i++) b[i] = 1.0f;
-    ease_bufoff(N - 1, b, 1, /*mark past end*/ N + 100, 1, (double)ramp);
+    ease_bufoff(N - 1, b, 1, 1, /*mark past end*/ N + 100, 1, (double)ramp);
     int unchanged = 1;
     for (int i = 0; i < N; i++) if (b[i] != 1.0f) unchanged = 0;
     CHECK(unchanged);
@@ -168,6 +169,1406 @@ static void test_set_loop(void)
     CHECK(x.minloop == keepmin && x.maxloop == keepmax);
 }
 
+// ipoke span fill: the (possibly SIMD) kernels must match the reference's
+// per-channel scalar loops bit-for-bit, in both directions, and a fill split
+// in two at a loop wrap must equal one continuous fill.
+static void naive_fill(float *b, long pchans, long nproc, long first, long count,
+                       long step, double *writeval, const double *recin, double recplaydif)
+{
+    double coeff[4];
+    for (long ch = 0; ch < nproc; ch++)
+        coeff[ch] = (recin[ch] - writeval[ch]) / recplaydif;
+    for (long k = 0, i = first; k < count; k++, i += step)
+        for (long ch = 0; ch < nproc; ch++) {
+            if (step > 0) writeval[ch] += coeff[ch];
+            else          writeval[ch] -= coeff[ch];
+            b[i * pchans + ch] = writeval[ch];
+        }
+}
+
+static void test_ipoke_fill(void)
+{
+    enum { N = 96, PCH = 4 };
+    float  ref[N * PCH], got[N * PCH];
+    const double recin[4] = { 0.7, -0.31, 0.123456789, -0.9 };
+    double coeff[4];
+
+    for (int nproc = 1; nproc <= 4; nproc++) {
+        for (int step = -1; step <= 1; step += 2) {
+            double wr[4] = { 0.1, 0.2, -0.3, 0.45 }, wg[4];
+            double rpd   = (step > 0) ? 37.0 : -37.0;
+            long   first = (step > 0) ? 5 : 80, count = 36;
+            memcpy(wg, wr, sizeof(wr));
+            for (int i = 0; i < N * PCH; i++) ref[i] = got[i] = -2.0f;
+
+            naive_fill(ref, PCH, nproc, first, count, step, wr, recin, rpd);
+            ipoke_slope(coeff, recin, wg, nproc, rpd, step);
+            ipoke_fill(got, PCH, nproc, first, count, step, wg, coeff);
+            CHECK(memcmp(ref, got, sizeof(ref)) == 0);
+            CHECK(memcmp(wr, wg, nproc * sizeof(double)) == 0);
+
+            // same span split at a wrap: continue from the writeval left behind
+            double ws[4] = { 0.1, 0.2, -0.3, 0.45 };
+            for (int i = 0; i < N * PCH; i++) got[i] = -2.0f;
+            ipoke_slope(coeff, recin, ws, nproc, rpd, step);
+            ipoke_fill(got, PCH, nproc, first, 11, step, ws, coeff);
+            ipoke_fill(got, PCH, nproc, first + 11 * step, count - 11, step, ws, coeff);
+            CHECK(memcmp(ref, got, sizeof(ref)) == 0);
+        }
+
+        // commit: average over pokesteps, store, reset
+        double w[4] = { 3.0, 6.0, -9.0, 1.5 };
+        for (int i = 0; i < N * PCH; i++) got[i] = -2.0f;
+        double ps = ipoke_commit(got, PCH, nproc, 7, w, 3.0);
+        CHECK(ps == 1.0);
+        CHECK_EQ(got[7 * PCH], 1.0, EPS);
+        CHECK(got[7 * PCH + nproc - 1] == (float)w[nproc - 1]);
+        CHECK(nproc == 4 || got[7 * PCH + nproc] == -2.0f);     // untouched past nproc
+    }
+
+    // zero-length fill writes nothing and keeps writeval
+    double w0[1] = { 0.25 }, d0[1] = { 1.0 };
+    got[0] = -2.0f;
+    ipoke_fill(got, 1, 1, 0, 0, 1, w0, d0);
+    CHECK(got[0] == -2.0f && w0[0] == 0.25);
+}
+
+// dirty-range list: merge / overflow / coalesce, then a live perform run where
+// every frame that changed in a vector must lie inside a range reported for it.
+enum { DR_FRAMES = 8192, DR_CH = 2, DR_VS = 64 };
+static float   dr_buf[DR_FRAMES * DR_CH];
+static long    dr_lo[8], dr_cnt[8];
+static int     dr_n, dr_whole;
+static void   *dr_lock(void *c)      { (void)c; return dr_buf; }
+static void    dr_unlock(void *c)    { (void)c; }
+static void    dr_setdirty(void *c)  { (void)c; dr_whole++; }
+static void    dr_range(void *c, long start, long count)
+{
+    (void)c;
+    if (dr_n < 8) { dr_lo[dr_n] = start; dr_cnt[dr_n] = count; }
+    dr_n++;
+}
+
+static void test_dirty_ranges(void)
+{
+    karma_dirty d = { 0 };
+    karma_dirty_add(&d, 10, 12);
+    karma_dirty_add(&d, 13, 20);                    // abuts -> extends
+    CHECK(d.n == 1 && d.lo[0] == 10 && d.hi[0] == 20);
+    karma_dirty_add(&d, 100, 100);
+    karma_dirty_add(&d, 200, 210);
+    karma_dirty_add(&d, 50, 60);
+    CHECK(d.n == 4);
+    karma_dirty_add(&d, 95, 96);                    // full: joins nearest (100)
+    CHECK(d.n == 4 && d.lo[1] == 95 && d.hi[1] == 100);
+    karma_dirty_add(&d, 21, 49);                    // bridges 10..20 and 50..60
+    CHECK(karma_dirty_finish(&d) == 3);
+    CHECK(d.lo[0] == 10 && d.hi[0] == 49 + 11);     // 10..60
+    CHECK(d.lo[1] == 95 && d.lo[2] == 200 && d.hi[2] == 210);
+    karma_dirty_fade(&d, 1023, 3, -1, 8);           // clipped at frame 0
+    CHECK(d.n == 4 && d.lo[3] == 0 && d.hi[3] == 3);
+
+    t_karma x;
+    karma_core_init(&x, DR_CH, 48000.0, DR_VS);
+    x.bufio.lock = dr_lock; x.bufio.unlock = dr_unlock;
+    x.bufio.set_dirty = dr_setdirty; x.bufio.set_dirty_range = dr_range;
+    x.bufio.ctx = dr_buf; x.bufio.frames = DR_FRAMES; x.bufio.chans = DR_CH; x.bufio.sr = 48000.0;
+    karma_core_set_dims(&x);
+    x.speedconnect = 1; x.initinit = 1;
+
+    static float before[DR_FRAMES * DR_CH];
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o0[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    const double speeds[] = { 1.0, 1.0, 2.5, -1.3, 0.6, 7.0 };
+    int covered = 1, ordered = 1, bounded = 1, whole0 = dr_whole;
+    long reported = 0, writes = 0;
+    long v, f;
+
+    for (v = 0; v < 1200; v++) {
+        long phase = v / 200;
+        if (v == 0)   karma_record(&x);             // initial loop
+        if (v == 200) { karma_overdub(&x, 0.8); karma_record(&x); }   // close loop -> overdub
+        if (v == 1100) karma_stop(&x);
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.2 * cos(0.013 * (v * DR_VS + i));
+            insp[i] = speeds[phase];
+        }
+        memcpy(before, dr_buf, sizeof(dr_buf));
+        dr_n = 0;
+        karma_stereo_perform(&x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        if (dr_n > KARMA_DIRTY_MAX) bounded = 0;
+        reported += dr_n;
+        for (int k = 1; k < dr_n && k < 8; k++)
+            if (dr_lo[k] <= dr_lo[k - 1] + dr_cnt[k - 1]) ordered = 0;
+        for (f = 0; f < DR_FRAMES; f++) {
+            if (before[f * DR_CH] == dr_buf[f * DR_CH] && before[f * DR_CH + 1] == dr_buf[f * DR_CH + 1])
+                continue;
+            int in = 0;
+            writes++;
+            for (int k = 0; k < dr_n && k < 8; k++)
+                if (f >= dr_lo[k] && f < dr_lo[k] + dr_cnt[k]) in = 1;
+            if (!in) { covered = 0; printf("  vector %ld: frame %ld written, not reported\n", v, f); break; }
+        }
+    }
+    CHECK(writes > 0 && reported > 0);
+    CHECK(covered);
+    CHECK(ordered);
+    CHECK(bounded);
+    CHECK(dr_whole == whole0);                      // range hosts never get set_dirty
+}
+
+// copy-on-write undo: two overdub layers over an initial take, then undo /
+// redo must restore each state bit-exactly; recording after an undo drops the
+// redo; a layer larger than the pool is lost and will not undo.
+static void undo_run(t_karma *x, long from, long to, double amp)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o0[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    for (long v = from; v < to; v++) {
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = amp * sin(0.01 * (v * DR_VS + i));
+            in1[i] = amp * cos(0.017 * (v * DR_VS + i));
+            insp[i] = 1.0;
+        }
+        karma_stereo_perform(x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+    }
+}
+
+static void test_undo(void)
+{
+    static float s0[DR_FRAMES * DR_CH], s1[DR_FRAMES * DR_CH], s2[DR_FRAMES * DR_CH];
+    t_karma x;
+
+    memset(dr_buf, 0, sizeof(dr_buf));
+    karma_core_init(&x, DR_CH, 48000.0, DR_VS);
+    x.bufio.lock = dr_lock; x.bufio.unlock = dr_unlock; x.bufio.set_dirty = dr_setdirty;
+    x.bufio.ctx = dr_buf; x.bufio.frames = DR_FRAMES; x.bufio.chans = DR_CH; x.bufio.sr = 48000.0;
+    karma_core_set_dims(&x);
+    x.speedconnect = 1; x.initinit = 1;
+    x.undo = karma_undo_new(DR_FRAMES, DR_CH, 64);
+    CHECK(x.undo != NULL);
+    if (!x.undo) return;
+
+    karma_record(&x);               undo_run(&x, 0, 100, 0.3);     // initial take (6400 frames)
+    karma_play(&x);                 undo_run(&x, 100, 150, 0.3);
+    memcpy(s0, dr_buf, sizeof(dr_buf));
+    karma_overdub(&x, 0.7);
+    karma_record(&x);               undo_run(&x, 150, 300, 0.2);    // layer 1
+    karma_record(&x);               undo_run(&x, 300, 320, 0.0);
+    memcpy(s1, dr_buf, sizeof(dr_buf));
+    karma_record(&x);               undo_run(&x, 320, 420, 0.4);    // layer 2 (part of the loop)
+    karma_record(&x);               undo_run(&x, 420, 440, 0.0);
+    memcpy(s2, dr_buf, sizeof(dr_buf));
+    CHECK(memcmp(s0, s1, sizeof(s0)) != 0 && memcmp(s1, s2, sizeof(s1)) != 0);
+    CHECK(x.undo->head - x.undo->tail <= 3 * 7);    // pages touched, not buffer length
+
+    karma_undo(&x);  undo_run(&x, 440, 441, 0.0);
+    CHECK(memcmp(dr_buf, s1, sizeof(s1)) == 0);
+    karma_undo(&x);  undo_run(&x, 441, 442, 0.0);
+    CHECK(memcmp(dr_buf, s0, sizeof(s0)) == 0);
+    karma_redo(&x);  undo_run(&x, 442, 443, 0.0);
+    CHECK(memcmp(dr_buf, s1, sizeof(s1)) == 0);
+    karma_redo(&x);  undo_run(&x, 443, 444, 0.0);
+    CHECK(memcmp(dr_buf, s2, sizeof(s2)) == 0);
+    karma_redo(&x);  undo_run(&x, 444, 445, 0.0);  // nothing left to redo
+    CHECK(memcmp(dr_buf, s2, sizeof(s2)) == 0);
+
+    // new layer after an undo discards the redo history
+    karma_undo(&x);  undo_run(&x, 445, 446, 0.0);
+    karma_record(&x);               undo_run(&x, 446, 500, 0.1);
+    karma_record(&x);               undo_run(&x, 500, 520, 0.0);
+    memcpy(s2, dr_buf, sizeof(dr_buf));
+    karma_redo(&x);  undo_run(&x, 520, 521, 0.0);
+    CHECK(memcmp(dr_buf, s2, sizeof(s2)) == 0);
+    karma_undo(&x);  undo_run(&x, 521, 522, 0.0);
+    CHECK(memcmp(dr_buf, s1, sizeof(s1)) == 0);
+    karma_undo_free(x.undo);
+
+    // pool of 2 pages: a whole-loop layer cannot be kept -> undo refuses
+    x.undo = karma_undo_new(DR_FRAMES, DR_CH, 2);
+    karma_record(&x);               undo_run(&x, 522, 680, 0.25);
+    karma_record(&x);               undo_run(&x, 680, 700, 0.0);
+    memcpy(s2, dr_buf, sizeof(dr_buf));
+    karma_undo(&x);  undo_run(&x, 700, 701, 0.0);
+    CHECK(memcmp(dr_buf, s2, sizeof(s2)) == 0);
+    karma_undo_free(x.undo);
+}
+
+// loop multiply: a virtual extension must play, overdub and undo exactly like a
+// loop copied out by hand, and end up as the same buffer once materialized.
+enum { MU_FRAMES = 262144 };
+static float    mu_a[MU_FRAMES * DR_CH], mu_b[MU_FRAMES * DR_CH];
+static void    *mu_lock(void *c)     { return c; }
+
+static void mu_setup(t_karma *x, float *buf)
+{
+    karma_core_init(x, DR_CH, 48000.0, DR_VS);
+    x->bufio.lock = mu_lock; x->bufio.unlock = dr_unlock; x->bufio.set_dirty = dr_setdirty;
+    x->bufio.ctx = buf; x->bufio.frames = MU_FRAMES; x->bufio.chans = DR_CH; x->bufio.sr = 48000.0;
+    karma_core_set_dims(x);
+    x->speedconnect = 1; x->initinit = 1;
+    x->undo = karma_undo_new(MU_FRAMES, DR_CH, 256);
+}
+
+// run both instances on the same input; 0 if any output sample differs
+static int mu_run(t_karma *a, t_karma *b, long from, long to, double amp, double speed)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], oa0[DR_VS], oa1[DR_VS], ob0[DR_VS], ob1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outa[2] = { oa0, oa1 }, *outb[2] = { ob0, ob1 };
+    int same = 1;
+    for (long v = from; v < to; v++) {
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = amp * sin(0.01 * (v * DR_VS + i));
+            in1[i] = amp * cos(0.017 * (v * DR_VS + i));
+            insp[i] = speed;
+        }
+        karma_stereo_perform(a, NULL, ins, 3, outa, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(b, NULL, ins, 3, outb, 2, DR_VS, 0, NULL);
+        if (memcmp(oa0, ob0, sizeof(oa0)) || memcmp(oa1, ob1, sizeof(oa1)))
+            same = 0;
+    }
+    return same;
+}
+
+// what multiply stands in for: copy the loop out, then move the end
+static void mu_copy(t_karma *x, float *buf, long factor)
+{
+    int64_t period = x->maxloop - x->minloop, f;
+    for (f = x->minloop + period + 1; f <= x->minloop + factor * period; f++)
+        memcpy(buf + f * DR_CH, buf + (x->minloop + 1 + (f - x->minloop - 1) % period) * DR_CH, DR_CH * sizeof(float));
+    x->maxloop = x->minloop + factor * period;
+    karma_select_size(x, x->selection);
+    karma_select_start(x, x->selstart);
+}
+
+static void test_multiply(void)
+{
+    t_karma a, b;
+    int same = 1;
+
+    memset(mu_a, 0, sizeof(mu_a));
+    memset(mu_b, 0, sizeof(mu_b));
+    mu_setup(&a, mu_a);
+    mu_setup(&b, mu_b);
+    a.mul = karma_multiply_new(MU_FRAMES, DR_CH);
+    CHECK(a.mul != NULL);
+    if (!a.mul) return;
+
+    karma_multiply(&a, 3);                          // no loop yet: refused
+    CHECK(a.mul->request == 0);
+
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 0, 400, 0.3, 1.0);       // initial take (~25000 frames)
+    karma_play(&a); karma_play(&b);
+    same &= mu_run(&a, &b, 400, 410, 0.0, 1.0);
+    karma_overdub(&a, 0.6); karma_overdub(&b, 0.6);
+    karma_record(&a); karma_record(&b);             // a layer from before the multiply
+    same &= mu_run(&a, &b, 410, 430, 0.25, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 430, 440, 0.0, 1.0);
+
+    karma_multiply(&a, 3);
+    mu_copy(&b, mu_b, 3);
+    same &= mu_run(&a, &b, 440, 441, 0.0, 1.0);
+    CHECK(a.maxloop == b.maxloop && a.mul->levels == 1);
+    CHECK(memcmp(mu_a, mu_b, sizeof(mu_a)) != 0);   // O(1): the copy hasn't happened
+    karma_undo(&a); karma_undo(&b);                 // reverts the source, not the copies
+    same &= mu_run(&a, &b, 441, 442, 0.0, 1.0);
+
+    karma_jump(&a, 0.99); karma_jump(&b, 0.99);     // overdub the page holding the end
+    same &= mu_run(&a, &b, 442, 452, 0.0, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 452, 462, 0.25, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 462, 472, 0.0, 1.0);
+
+    karma_multiply(&a, 2);                          // stack (extension still virtual): 6x
+    mu_copy(&b, mu_b, 2);
+    same &= mu_run(&a, &b, 472, 473, 0.0, 1.0);
+    CHECK(a.maxloop == b.maxloop && a.mul->levels == 2);
+    karma_jump(&a, 0.85); karma_jump(&b, 0.85);     // overdub pages the fill hasn't reached
+    same &= mu_run(&a, &b, 473, 483, 0.0, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 483, 495, 0.2, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 495, 505, 0.0, 1.0);
+    karma_undo(&a); karma_undo(&b);
+    same &= mu_run(&a, &b, 505, 508, 0.0, -1.0);
+    karma_jump(&a, 0.97); karma_jump(&b, 0.97);
+    same &= mu_run(&a, &b, 508, 518, 0.0, 1.0);
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 518, 540, 0.2, 2.5);
+    CHECK(a.mul->levels == 2);                      // all of that ran on the virtual path
+    karma_record(&a); karma_record(&b);
+    same &= mu_run(&a, &b, 540, 550, 0.0, 1.0);
+    CHECK(same);
+
+    same = mu_run(&a, &b, 550, 750, 0.0, 1.0);      // background fill finishes
+    CHECK(same);
+    CHECK(a.mul->levels == 0);
+    CHECK(memcmp(mu_a, mu_b, (size_t)(a.maxloop + 1) * DR_CH * sizeof(float)) == 0);
+
+    karma_multiply_free(a.mul);
+    karma_undo_free(a.undo);
+    karma_undo_free(b.undo);
+}
+
+// channel view: two stereo instances on channels 0-1 and 2-3 of one 4-channel
+// buffer must play, record, undo and multiply exactly like two on their own
+// stereo buffers -- and neither may touch the other's channels.
+enum { CH_FRAMES = 16384, CH_WIDE = 4 };
+static float    ch_wide[CH_FRAMES * CH_WIDE], ch_ref[2][CH_FRAMES * DR_CH];
+
+static void ch_setup(t_karma *x, float *buf, long chans, long offset)
+{
+    karma_core_init(x, DR_CH, 48000.0, DR_VS);
+    x->bufio.lock = mu_lock; x->bufio.unlock = dr_unlock; x->bufio.set_dirty = dr_setdirty;
+    x->bufio.ctx = buf; x->bufio.frames = CH_FRAMES; x->bufio.chans = chans; x->bufio.sr = 48000.0;
+    karma_core_set_dims(x);
+    karma_core_set_channels(x, offset, DR_CH);
+    x->speedconnect = 1; x->initinit = 1;
+    x->undo = karma_undo_new(CH_FRAMES, karma_core_view_chans(x), 32);
+    x->mul = karma_multiply_new(CH_FRAMES, karma_core_view_chans(x));
+}
+
+// xs[0..1] on the wide buffer, xs[2..3] their references; instance k % 2
+// hears its own input. 0 if a wide instance's output differs from its reference
+static int ch_run(t_karma **xs, long from, long to)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[4][2][DR_VS];
+    double *ins[3] = { in0, in1, insp };
+    int same = 1;
+    for (long v = from; v < to; v++) {
+        for (int k = 0; k < 4; k++) {
+            double *outs[2] = { o[k][0], o[k][1] };
+            for (int i = 0; i < DR_VS; i++) {
+                in0[i] = (0.2 + 0.1 * (k % 2)) * sin((0.01 + 0.003 * (k % 2)) * (v * DR_VS + i));
+                in1[i] = 0.15 * cos(0.017 * (v * DR_VS + i) + (k % 2));
+                insp[i] = 1.0;
+            }
+            karma_stereo_perform(xs[k], NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        }
+        if (memcmp(o[0], o[2], sizeof(o[0])) || memcmp(o[1], o[3], sizeof(o[1])))
+            same = 0;
+    }
+    return same;
+}
+
+static void test_channels(void)
+{
+    t_karma a, b, ra, rb;
+    t_karma *xs[4] = { &a, &b, &ra, &rb };
+    long f, c;
+    int same = 1, match = 1;
+
+    for (f = 0; f < CH_FRAMES; f++)
+        for (c = 0; c < CH_WIDE; c++)
+            ch_wide[f * CH_WIDE + c] = ch_ref[c / DR_CH][f * DR_CH + c % DR_CH] = (float)(0.01 * (c + 1) * sin(0.3 * f));
+    ch_setup(&a, ch_wide, CH_WIDE, 0);
+    ch_setup(&b, ch_wide, CH_WIDE, 2);
+    ch_setup(&ra, ch_ref[0], DR_CH, 0);
+    ch_setup(&rb, ch_ref[1], DR_CH, 0);
+    CHECK(karma_core_view_chans(&b) == 2 && a.undo && b.undo && a.mul && b.mul);
+    if (!a.undo || !b.undo || !a.mul || !b.mul) return;
+
+    karma_record(&a); karma_record(&ra);            // a's take
+    same &= ch_run(xs, 0, 40);
+    karma_play(&a); karma_play(&ra);
+    same &= ch_run(xs, 40, 60);
+    karma_record(&b); karma_record(&rb);            // b's initial clear leaves a's channels
+    same &= ch_run(xs, 60, 85);
+    karma_play(&b); karma_play(&rb);                // (both loops come out at the 4096 minimum)
+    same &= ch_run(xs, 85, 130);
+    karma_overdub(&a, 0.7); karma_overdub(&ra, 0.7);
+    karma_record(&a); karma_record(&ra);
+    same &= ch_run(xs, 130, 180);
+    karma_record(&a); karma_record(&ra);
+    same &= ch_run(xs, 180, 190);
+    karma_undo(&a); karma_undo(&ra);
+    karma_multiply(&b, 2); karma_multiply(&rb, 2);
+    same &= ch_run(xs, 190, 200);
+    karma_overdub(&b, 0.5); karma_overdub(&rb, 0.5);
+    karma_record(&b); karma_record(&rb);            // overdub the still-virtual extension
+    same &= ch_run(xs, 200, 260);
+    karma_record(&b); karma_record(&rb);
+    same &= ch_run(xs, 260, 300);
+    CHECK(same);
+    CHECK(b.maxloop > a.maxloop && b.mul->levels == 0);
+
+    for (f = 0; f < CH_FRAMES; f++)
+        for (c = 0; c < CH_WIDE; c++)
+            if (ch_wide[f * CH_WIDE + c] != ch_ref[c / DR_CH][f * DR_CH + c % DR_CH])
+                match = 0;
+    CHECK(match);
+
+    for (int k = 0; k < 4; k++) {
+        karma_undo_free(xs[k]->undo);
+        karma_multiply_free(xs[k]->mul);
+    }
+}
+
+// one-shot (@loop 0): plays exactly what the looping instance plays up to the
+// end of the window, then the same faded out -- the loop read on through the
+// wrap, as after 'stop', not a held frame -- then stops (SH_STOP) and stays
+// silent until 'play' starts it over.
+static void os_run(t_karma *x, long from, long to, double *o0)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    for (long v = from; v < to; v++, outs[0] += DR_VS) {
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.0;
+            insp[i] = 1.0;
+        }
+        karma_stereo_perform(x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+    }
+}
+
+static void test_oneshot(void)
+{
+    static double oa[250 * DR_VS], ob[250 * DR_VS];
+    t_karma a, b;
+    long i, end = -1, last = 0;
+    double step, stepa = 0.0, stepb = 0.0, g, gprev = 1.0;
+    int faded = 1;
+
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    b.islooped = 0;
+    karma_record(&a); karma_record(&b);             // same take on both
+    os_run(&a, 0, 70, oa); os_run(&b, 0, 70, ob);
+    karma_select_size(&a, 0.5); karma_select_size(&b, 0.5);    // window ends mid-take
+    karma_play(&a); karma_play(&b);
+    os_run(&a, 70, 250, oa + 70 * DR_VS); os_run(&b, 70, 250, ob + 70 * DR_VS);
+    CHECK(a.go && !b.go && b.statehuman == SH_STOP);
+
+    for (i = 1; i < 250 * DR_VS; i++) {
+        if (ob[i] != oa[i] && end < 0) end = i;     // first sample past the window end
+        if (ob[i] != 0.0) last = i;
+        step = fabs(oa[i] - oa[i - 1]); if (step > stepa) stepa = step;
+        step = fabs(ob[i] - ob[i - 1]); if (step > stepb) stepb = step;
+    }
+    CHECK(end > 70 * DR_VS + a.maxloop / 2);        // the whole (half-loop) window first
+    CHECK(last < end + 256 && last >= end + 250);   // then one 256-sample fade and silence
+    CHECK(stepb <= stepa);                          // no click at the end
+    for (i = end; i <= last; i++)                   // the loop itself under a falling gain
+        if (fabs(oa[i]) > 1e-3) {
+            g = ob[i] / oa[i];
+            faded &= (g >= 0.0) && (g <= gprev + 1e-12);
+            gprev = g;
+        }
+    CHECK(faded && (gprev < 0.1));
+
+    karma_play(&b);                                 // starts over, ends again
+    os_run(&b, 250, 350, ob);
+    CHECK(ob[20 * DR_VS] != 0.0 && !b.go && b.statehuman == SH_STOP);
+
+    for (i = 0; i < 2; i++) {
+        karma_undo_free((i ? &b : &a)->undo);
+        karma_multiply_free((i ? &b : &a)->mul);
+    }
+}
+
+// @modout: a quad instance on a stereo buffer plays buffer channels 0 1 0 1;
+// without it outputs 2 and 3 stay silent. Channels 0 and 1 are the same either way.
+static void test_modout(void)
+{
+    double in[4][DR_VS], insp[DR_VS], o[2][4][DR_VS];
+    double *ins[5] = { in[0], in[1], in[2], in[3], insp };
+    t_karma x[2];
+    int same = 1, fanned = 1, silent = 1;
+    long v, i;
+
+    for (int k = 0; k < 2; k++) {
+        karma_core_init(&x[k], 4, 48000.0, DR_VS);
+        x[k].bufio.lock = mu_lock; x[k].bufio.unlock = dr_unlock; x[k].bufio.set_dirty = dr_setdirty;
+        x[k].bufio.ctx = ch_ref[k]; x[k].bufio.frames = CH_FRAMES; x[k].bufio.chans = DR_CH; x[k].bufio.sr = 48000.0;
+        karma_core_set_dims(&x[k]);
+        x[k].speedconnect = 1; x[k].initinit = 1;
+    }
+    x[1].moduloout = 1;
+    for (v = 0; v < 200; v++) {
+        if (v == 0)  { karma_record(&x[0]); karma_record(&x[1]); }
+        if (v == 70) { karma_play(&x[0]);   karma_play(&x[1]); }
+        for (i = 0; i < DR_VS; i++) {
+            for (int c = 0; c < 4; c++)
+                in[c][i] = 0.2 * sin((0.01 + 0.004 * c) * (v * DR_VS + i));
+            insp[i] = (v < 120) ? 1.0 : -0.7;
+        }
+        for (int k = 0; k < 2; k++) {
+            double *outs[4] = { o[k][0], o[k][1], o[k][2], o[k][3] };
+            karma_quad_perform(&x[k], NULL, ins, 5, outs, 4, DR_VS, 0, NULL);
+        }
+        if (memcmp(o[0][0], o[1][0], sizeof(o[0][0])) || memcmp(o[0][1], o[1][1], sizeof(o[0][1])))
+            same = 0;
+        if (memcmp(o[1][2], o[1][0], sizeof(o[1][0])) || memcmp(o[1][3], o[1][1], sizeof(o[1][1])))
+            fanned = 0;
+        for (i = 0; i < DR_VS; i++)
+            if (o[0][2][i] != 0.0 || o[0][3][i] != 0.0)
+                silent = 0;
+    }
+    CHECK(same);
+    CHECK(fanned);
+    CHECK(silent);
+    CHECK(memcmp(ch_ref[0], ch_ref[1], sizeof(ch_ref[0])) == 0);   // records the same channels
+}
+
+// on-frame reads: at integral forward speeds the perform loop reads b[playhead]
+// instead of interpolating; the output must still be exactly the kernel's value
+// at frac 0, including the sign of -0.0 frames (which depends on the neighbours).
+static void test_onframe(void)
+{
+    static double o[2][40 * DR_VS];
+    double in0[DR_VS] = { 0 }, in1[DR_VS] = { 0 }, insp[DR_VS] = { 0 };
+    double *ins[3] = { in0, in1, insp };
+    t_karma x;
+    long v, k, f, h, checked = 0;
+    int exact = 1;
+
+    ch_setup(&x, ch_ref[0], DR_CH, 0);
+    for (v = 0; v < 110; v++) {                     // a ~4500-frame loop, then stopped
+        double *outs[2] = { o[0], o[1] };
+        if (v == 0)  karma_record(&x);
+        if (v == 70) karma_play(&x);
+        if (v == 90) karma_stop(&x);
+        karma_stereo_perform(&x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+    }
+    for (f = 0; f < CH_FRAMES; f++) {               // distinct non-zero frames, every 7th -0.0
+        float g = (f % 7 == 3) ? -0.0f : (float)((f + 1) * 1e-4 * ((f % 3) ? 1 : -1));
+        ch_ref[0][f * DR_CH] = g;
+        ch_ref[0][f * DR_CH + 1] = -g;
+    }
+    for (int interp = 1; interp <= 2; interp++) {   // cubic at 1x, spline at 2x
+        double speed = interp;
+        x.interpflag = interp;
+        karma_play(&x);
+        for (v = 0; v < 40; v++) {
+            double *outs[2] = { o[0] + v * DR_VS, o[1] + v * DR_VS };
+            for (k = 0; k < DR_VS; k++) insp[k] = speed;
+            karma_stereo_perform(&x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        }
+        for (k = 10 * DR_VS; o[0][k] == 0.0; k++) ;   // find the head from a non-zero frame
+        for (h = 1; h < x.maxloop - 2 && ch_ref[0][h * DR_CH] != (float)o[0][k]; h++) ;
+        for (; (k < 40 * DR_VS) && (h + 2 < x.maxloop); k++, h += (long)speed) {   // (short of the wrap)
+            for (int c = 0; c < DR_CH; c++) {
+                float *p = ch_ref[0] + c;
+                double want = (interp == 1)
+                    ? CUBIC_INTERP(0.0, p[(h - 1) * DR_CH], p[h * DR_CH], p[(h + 1) * DR_CH], p[(h + 2) * DR_CH])
+                    : SPLINE_INTERP(0.0, p[(h - 1) * DR_CH], p[h * DR_CH], p[(h + 1) * DR_CH], p[(h + 2) * DR_CH]);
+                if (memcmp(&want, &o[c][k], sizeof(want)))
+                    exact = 0;
+                checked++;
+            }
+        }
+        karma_stop(&x);
+        for (v = 0; v < 10; v++) {
+            double *outs[2] = { o[0], o[1] };
+            karma_stereo_perform(&x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        }
+    }
+    CHECK(checked > 2 * 2 * 1000);
+    CHECK(exact);
+    karma_undo_free(x.undo);
+    karma_multiply_free(x.mul);
+}
+
+// windowed sinc (interp 3): unity-gain coefficients, accurate in band,
+// low-passed above 1x, SIMD frames == scalar, and in the perform loop tracks
+// cubic on band-limited material in both directions
+static void test_sinc(void)
+{
+    static float sb[512 * 4];
+    static double o[2][2][30 * DR_VS];
+    double c[KARMA_SINC_MAXN], out[4], want, sum, err, errc, amp1, amp4, cyc;
+    int64_t idx[KARMA_SINC_MAXN];
+    int n, k0, k, t, same = 1, finite = 1;
+    double in0[DR_VS] = { 0 }, in1[DR_VS] = { 0 }, insp[DR_VS] = { 0 };
+    double *ins[3] = { in0, in1, insp };
+    t_karma a, b;
+    long v, f;
+
+    karma_sinc_init();
+    for (t = 8; t <= 32; t *= 2) {
+        for (k = 0; k < 4; k++) {
+            n = sinc_coeffs(c, t, 0.25 * k, (k & 1) ? 2.5 : 1.0, &k0);
+            CHECK(n == ((k & 1) ? 5 * t / 2 : t) && k0 == -(n / 2 - 1));   // stretched by 1 / fc
+            for (sum = 0.0, f = 0; f < n; f++) sum += c[f];
+            CHECK_EQ(sum, 1.0, 1e-12);
+        }
+    }
+    for (f = 0; f < 512; f++)                       // in band (0.05 cycles / frame), 4 channels
+        for (k = 0; k < 4; k++)
+            sb[f * 4 + k] = (float)sin(2.0 * PI * 0.05 * f + k);
+    err = errc = 0.0;
+    for (k = 0; k < 16; k++) {
+        double pos = 200.0 + k / 16.0, e;
+        sinc_read(out, sb, 4, 1, 32, pos, 200, 1.0, 1, 1, 511, 511, NULL);
+        e = fabs(out[0] - sin(2.0 * PI * 0.05 * pos));
+        if (e > err) err = e;
+        e = fabs(CUBIC_INTERP(k / 16.0, sb[199 * 4], sb[200 * 4], sb[201 * 4], sb[202 * 4]) - sin(2.0 * PI * 0.05 * pos));
+        if (e > errc) errc = e;
+    }
+    CHECK(err < 1e-3 && err < errc);
+    for (t = 2; t <= 4; t += 2) {                   // the SSE2 / NEON frame paths match the scalar sum
+        n = sinc_coeffs(c, 16, 0.3, 1.7, &k0);
+        for (k = 0; k < n; k++) idx[k] = 300 + k0 + k;
+        sinc_dot(out, sb, 4, t, idx, c, n);
+        for (f = 0; f < t; f++) {
+            for (want = 0.0, k = 0; k < n; k++) want += c[k] * sb[idx[k] * 4 + f];
+            CHECK_EQ(out[f], want, 1e-12);
+        }
+    }
+    for (f = 0; f < 512; f++)                       // 0.4 cycles / frame: passes at 1x, stopped at 4x
+        sb[f] = (float)sin(2.0 * PI * 0.4 * f);
+    amp1 = amp4 = 0.0;
+    for (k = 0; k < 16; k++) {
+        sinc_read(out, sb, 1, 1, 16, 250.0 + k / 16.0, 250, 1.0, 1, 1, 511, 511, NULL);
+        if (fabs(out[0]) > amp1) amp1 = fabs(out[0]);
+        sinc_read(out, sb, 1, 1, 16, 250.0 + k / 16.0, 250, 4.0, 1, 1, 511, 511, NULL);
+        if (fabs(out[0]) > amp4) amp4 = fabs(out[0]);
+    }
+    CHECK(amp1 > 0.5);
+    CHECK(amp4 < 0.01);
+
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    for (v = 0; v < 110; v++) {                     // the same ~4500-frame loop in both, stopped
+        double *oa[2] = { o[0][0], o[0][1] }, *ob[2] = { o[1][0], o[1][1] };
+        if (v == 0)  { karma_record(&a); karma_record(&b); }
+        if (v == 70) { karma_play(&a); karma_play(&b); }
+        if (v == 90) { karma_stop(&a); karma_stop(&b); }
+        karma_stereo_perform(&a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+    }
+    CHECK(a.maxloop == b.maxloop);
+    cyc = round(0.02 * (a.maxloop + 1));           // ~0.02 cycles / frame: linear would be off by ~1e-3
+    for (f = 0; f < CH_FRAMES * DR_CH; f++)          // seamless over the loop
+        ch_ref[0][f] = ch_ref[1][f] = (float)(0.5 * sin(2.0 * PI * cyc * (f / DR_CH) / (a.maxloop + 1) + f % DR_CH));
+    a.interpflag = 1;
+    b.interpflag = 3;
+    for (t = 0; t < 2; t++) {                       // 1.5x forward, then 0.75x reverse
+        karma_play(&a); karma_play(&b);
+        for (v = 0; v < 30; v++) {
+            double *oa[2] = { o[0][0] + v * DR_VS, o[0][1] + v * DR_VS }, *ob[2] = { o[1][0] + v * DR_VS, o[1][1] + v * DR_VS };
+            for (k = 0; k < DR_VS; k++) insp[k] = t ? -0.75 : 1.5;
+            karma_stereo_perform(&a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+            karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        }
+        for (k = 0; k < 2; k++)
+            for (f = 0; f < 30 * DR_VS; f++) {
+                if (!isfinite(o[1][k][f])) finite = 0;
+                if (fabs(o[0][k][f] - o[1][k][f]) > 2e-4) same = 0;
+            }
+        karma_stop(&a); karma_stop(&b);
+        for (v = 0; v < 10; v++) {
+            double *oa[2] = { o[0][0], o[0][1] }, *ob[2] = { o[1][0], o[1][1] };
+            karma_stereo_perform(&a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+            karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        }
+    }
+    CHECK(finite);
+    CHECK(same);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// mip-map pyramid: filled in the background after attach, kept equal to a
+// from-scratch build through overdubs and undo, and at 8x a tone far above
+// the output's Nyquist plays (nearly) silent where the buffer read aliases
+static float mm_lv[KARMA_MIPMAP_LEVELS + 1][CH_FRAMES * DR_CH];
+
+static void mm_run(t_karma *x, long vecs, double amp, double speed, double *out0)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o0[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    for (long v = 0; v < vecs; v++) {
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = amp * sin(0.01 * (v * DR_VS + i));
+            in1[i] = amp * cos(0.017 * (v * DR_VS + i));
+            insp[i] = speed;
+        }
+        karma_stereo_perform(x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        if (out0)
+            memcpy(out0 + v * DR_VS, o0, sizeof(o0));
+    }
+}
+
+// 1 if every level equals a from-scratch build of the buffer
+static int mm_same(const karma_mipmap_state *m, const float *buf)
+{
+    int64_t len = CH_FRAMES, L, j, k, c, t;
+    float *s;
+
+    memcpy(mm_lv[0], buf, sizeof(mm_lv[0]));
+    for (L = 1; L <= KARMA_MIPMAP_LEVELS; L++, len = (len - 1) / 2 + 1) {
+        s = mm_lv[L - 1];
+        for (j = 0; j < (len - 1) / 2 + 1; j++)
+            for (c = 0; c < DR_CH; c++) {
+                float a[5];
+                for (k = 0; k < 5; k++) {
+                    t = CLAMP(2 * j - 2 + k, 0, len - 1);
+                    a[k] = s[t * DR_CH + c];
+                }
+                mm_lv[L][j * DR_CH + c] = (a[0] + 4.0f * a[1] + 6.0f * a[2] + 4.0f * a[3] + a[4]) * 0.0625f;
+            }
+        if ((m->len[L] != (len - 1) / 2 + 1) || memcmp(m->level[L], mm_lv[L], (size_t)m->len[L] * DR_CH * sizeof(float)))
+            return 0;
+    }
+    return 1;
+}
+
+static void test_mipmap(void)
+{
+    static double o[2][60 * DR_VS];
+    double rms[2];
+    t_karma x;
+    long f, k;
+
+    ch_setup(&x, ch_ref[0], DR_CH, 0);
+    x.mip = karma_mipmap_new(CH_FRAMES, DR_CH);
+    CHECK(x.mip != NULL);
+    if (!x.mip) return;
+    karma_record(&x);              mm_run(&x, 70, 0.3, 1.0, NULL);     // initial take (clears: refill)
+    karma_play(&x);                mm_run(&x, 20, 0.3, 1.0, NULL);
+    CHECK(x.mip->slo > x.mip->shi);
+    CHECK(mm_same(x.mip, ch_ref[0]));
+    karma_overdub(&x, 0.7);
+    karma_record(&x);              mm_run(&x, 30, 0.2, 1.0, NULL);     // a layer over part of the loop
+    karma_record(&x);              mm_run(&x, 20, 0.0, 1.0, NULL);
+    CHECK(mm_same(x.mip, ch_ref[0]));
+    karma_undo(&x);                mm_run(&x, 1, 0.0, 1.0, NULL);      // swapped pages go up too
+    CHECK(mm_same(x.mip, ch_ref[0]));
+    karma_stop(&x);                mm_run(&x, 10, 0.0, 1.0, NULL);
+
+    for (f = 0; f < CH_FRAMES * DR_CH; f++)          // 0.3 cycles / frame: 5x the 8x output's Nyquist
+        ch_ref[0][f] = (float)(0.5 * sin(2.0 * PI * 0.3 * (f / DR_CH)));
+    x.mip->reset = 1;                               // (written behind the core's back)
+    karma_select_size(&x, 0.5);                     // a window clear of the buffer's edges, which
+    karma_select_start(&x, 0.25);                   // the levels clamp (not low-passed there)
+    for (k = 0; k < 2; k++) {                       // with the pyramid, then without
+        karma_play(&x);            mm_run(&x, 60, 0.0, 8.0, o[k]);
+        karma_stop(&x);            mm_run(&x, 10, 0.0, 1.0, NULL);
+        for (rms[k] = 0.0, f = 20 * DR_VS; f < 60 * DR_VS; f++)
+            rms[k] += o[k][f] * o[k][f];
+        rms[k] = sqrt(rms[k] / (40 * DR_VS));
+        x.mip->frames = 0;                          // detached (sizes differ)
+    }
+    CHECK(rms[0] < 0.01);
+    CHECK(rms[1] > 0.1);
+    x.mip->frames = CH_FRAMES;
+    karma_mipmap_free(x.mip);
+    karma_undo_free(x.undo);
+    karma_multiply_free(x.mul);
+}
+
+// resampled shadow: a 44.1k buffer in a 48k session plays the same with a
+// shadow as without (to float precision), through a take, an overdub and a
+// rewritten buffer -- and the shadow is what's read: poisoning it shows
+static long sh_run(t_karma *a, t_karma *b, long vecs, double amp, double tol)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[2][2][DR_VS];
+    double *ins[3] = { in0, in1, insp };
+    long bad = 0;
+    for (long v = 0; v < vecs; v++) {
+        double *oa[2] = { o[0][0], o[0][1] }, *ob[2] = { o[1][0], o[1][1] };
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = amp * sin(0.01 * (v * DR_VS + i));
+            in1[i] = amp * cos(0.017 * (v * DR_VS + i));
+            insp[i] = 1.0;
+        }
+        karma_stereo_perform(a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        for (int c = 0; c < 2; c++)
+            for (int i = 0; i < DR_VS; i++)
+                bad += (fabs(o[0][c][i] - o[1][c][i]) > tol);
+    }
+    return bad;
+}
+
+static void test_shadow(void)
+{
+    t_karma a, b;
+    long f;
+
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    a.bufio.sr = b.bufio.sr = 44100.0;
+    karma_core_set_dims(&a);
+    karma_core_set_dims(&b);
+    b.shadow = karma_shadow_new(CH_FRAMES, DR_CH, b.srscale);
+    CHECK(b.shadow != NULL && b.srscale != 1.0);
+    if (!b.shadow) return;
+    karma_record(&a); karma_record(&b);   CHECK(sh_run(&a, &b, 70, 0.3, 1e-6) == 0);     // take
+    karma_play(&a); karma_play(&b);       CHECK(sh_run(&a, &b, 100, 0.3, 1e-6) == 0);
+    CHECK(b.shadow->slo > b.shadow->shi);
+    karma_overdub(&a, 0.6); karma_overdub(&b, 0.6);
+    karma_record(&a); karma_record(&b);   CHECK(sh_run(&a, &b, 80, 0.2, 1e-6) == 0);     // a layer, over the wrap
+    karma_record(&a); karma_record(&b);   CHECK(sh_run(&a, &b, 100, 0.0, 1e-6) == 0);
+    for (f = 0; f < b.shadow->len * DR_CH; f++)
+        b.shadow->s[f] = 9.0f;
+    CHECK(sh_run(&a, &b, 50, 0.0, 1.0) > 50 * DR_VS);     // most samples came from it
+    b.shadow->reset = 1;
+    sh_run(&a, &b, 10, 0.0, 1e-6);
+    CHECK(sh_run(&a, &b, 100, 0.0, 1e-6) == 0);
+    for (f = 0; f < CH_FRAMES * DR_CH; f++)          // rewritten: new content from the next fill
+        ch_ref[0][f] = ch_ref[1][f] = (float)(0.2 * sin(0.05 * f));
+    b.shadow->reset = 1;
+    sh_run(&a, &b, 10, 0.0, 1e-6);
+    CHECK(sh_run(&a, &b, 100, 0.0, 1e-6) == 0);
+    size_t sz = (size_t)(b.shadow->len * DR_CH) * sizeof(float);
+    float *keep = (float *)malloc(sz);
+    for (int e = 0; e < 2; e++) {                   // a write at either end of the loop reaches the
+        int64_t at = e ? b.maxloop - 1 : 0;         // shadow frames whose taps wrap onto it
+        ch_ref[1][at * DR_CH] += 0.5f;
+        ch_ref[1][(at + 1) * DR_CH + 1] -= 0.25f;
+        shadow_update(b.shadow, ch_ref[1], DR_CH, NULL, at, at + 1);
+        memcpy(keep, b.shadow->s, sz);
+        shadow_build(b.shadow, ch_ref[1], DR_CH, NULL, 0, b.shadow->len - 1);
+        CHECK(memcmp(keep, b.shadow->s, sz) == 0);
+    }
+    free(keep);
+    karma_shadow_free(b.shadow);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// a dormant (stopped, settled) instance skips the perform loop and the buffer
+// lock; it must still be exactly the full loop -- outputs, held sync phase, an
+// overdub ramp run while stopped -- and leave it on a direction change or a message
+static long  dm_locks;
+static void *dm_lock(void *c) { dm_locks++; return c; }
+
+static void test_dormant(void)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[2][3][DR_VS];
+    double *ins[3] = { in0, in1, insp };
+    t_karma a, b;
+    long v, idle = 0, woke = 0;
+    int same = 1;
+
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    a.bufio.lock = dm_lock;
+    a.syncoutlet = b.syncoutlet = 1;
+    b.mip = karma_mipmap_new(CH_FRAMES, DR_CH);     // reset every vector: b never goes dormant
+    CHECK(b.mip != NULL);
+    if (!b.mip) return;
+    for (v = 0; v < 260; v++) {
+        double *oa[3] = { o[0][0], o[0][1], o[0][2] }, *ob[3] = { o[1][0], o[1][1], o[1][2] };
+        if (v == 0)   { karma_record(&a);        karma_record(&b); }
+        if (v == 70)  { karma_play(&a);          karma_play(&b); }
+        if (v == 100) { karma_stop(&a);          karma_stop(&b); }
+        if (v == 130) { karma_overdub(&a, 0.37); karma_overdub(&b, 0.37); }
+        if (v == 200) { karma_play(&a);          karma_play(&b); }
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.2 * cos(0.013 * (v * DR_VS + i));
+            insp[i] = ((v == 160) && (i >= 20)) || (v > 160) ? -1.0 : 1.0;  // reversed while stopped
+        }
+        b.mip->reset = 1;
+        dm_locks = 0;
+        karma_stereo_perform(&a, NULL, ins, 3, oa, 3, DR_VS, 0, NULL);
+        karma_stereo_perform(&b, NULL, ins, 3, ob, 3, DR_VS, 0, NULL);
+        if (memcmp(o[0], o[1], sizeof(o[0])))
+            same = 0;
+        if (v == 130)
+            same &= (a.overdubprev == b.overdubprev) && (a.overdubprev != 1.0);   // ramped while dormant
+        if ((v >= 110) && (v < 200)) idle += dm_locks;
+        if (v >= 200) woke += dm_locks;
+    }
+    CHECK(same);
+    CHECK(idle == 1);                               // the vector the direction changed in
+    CHECK(woke == 60);
+    CHECK(a.overdubprev == b.overdubprev && a.snrfade == b.snrfade && a.playhead == b.playhead);
+    karma_mipmap_free(b.mip);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// overdubbing silence at unity: the ipoke store is skipped where it would write
+// back what the frame holds, so the pass writes (and reports) nothing -- except
+// -0.0 frames, which the reference turns into +0.0 (0.0 + -0.0), as it still does
+static void qu_run(t_karma *x, long vecs, double amp, double speed)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o0[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    for (long v = 0; v < vecs; v++) {
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = amp * sin(0.01 * (v * DR_VS + i));
+            in1[i] = amp * cos(0.017 * (v * DR_VS + i));
+            insp[i] = speed;
+        }
+        karma_stereo_perform(x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+    }
+}
+
+static void test_quiet_overdub(void)
+{
+    static float want[CH_FRAMES * DR_CH];
+    const long neg[3] = { 1000, 2000, 3000 };
+    t_karma x;
+    int at = 1;
+
+    ch_setup(&x, ch_ref[0], DR_CH, 0);
+    x.bufio.set_dirty_range = dr_range;
+    x.globalramp = 0;                               // no record fades: the pass may change nothing else
+    karma_record(&x);      qu_run(&x, 70, 0.3, 1.0);     // a take
+    karma_play(&x);        qu_run(&x, 30, 0.3, 1.0);
+    for (int k = 0; k < 3; k++)
+        ch_ref[0][neg[k] * DR_CH + 1] = -0.0f;
+    memcpy(want, ch_ref[0], sizeof(want));
+    for (int k = 0; k < 3; k++)
+        want[neg[k] * DR_CH + 1] = 0.0f;
+    dr_n = 0;
+    dr_whole = 0;
+    karma_record(&x);      qu_run(&x, 160, 0.0, 1.0);    // two passes of silence at unity
+    karma_play(&x);        qu_run(&x, 10, 0.0, 1.0);
+    CHECK(memcmp(ch_ref[0], want, sizeof(want)) == 0);
+    for (int k = 0; k < 3 && k < dr_n; k++)         // just the -0.0 frames (in the head's order)
+        at &= (dr_cnt[k] == 1) && ((dr_lo[k] == neg[0]) || (dr_lo[k] == neg[1]) || (dr_lo[k] == neg[2]));
+    CHECK(dr_n == 3 && at);
+    x.bufio.set_dirty_range = NULL;                 // a whole-buffer host is not told either
+    karma_record(&x);      qu_run(&x, 80, 0.0, 1.0);
+    karma_play(&x);        qu_run(&x, 10, 0.0, 1.0);
+    CHECK(dr_whole == 0);
+    CHECK(memcmp(ch_ref[0], want, sizeof(want)) == 0);
+    karma_record(&x);      qu_run(&x, 20, 0.0, 2.0);     // at 2x the skipped frames are still
+    karma_play(&x);        qu_run(&x, 10, 0.0, 1.0);     // interpolated over, as in the reference
+    CHECK(dr_whole > 0 && memcmp(ch_ref[0], want, sizeof(want)) != 0);
+    memcpy(want, ch_ref[0], sizeof(want));
+    dr_whole = 0;
+    karma_record(&x);      qu_run(&x, 10, 0.1, 1.0);     // and anything heard is written
+    CHECK(dr_whole > 0 && memcmp(ch_ref[0], want, sizeof(want)) != 0);
+    karma_undo_free(x.undo);
+    karma_multiply_free(x.mul);
+}
+
+// the perform state block: whole cache lines at the head of t_karma, and all
+// that perform carries from one vector to the next -- through a session of
+// record / overdub / reverse / jump / stop, no vector changes a byte past it
+static void test_state_block(void)
+{
+    static t_karma x, before;
+    const size_t hot = sizeof(x.st_lines);
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o0[DR_VS], o1[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o0, o1 };
+    long v;
+    int kept = 1;
+
+    CHECK(offsetof(t_karma, st) == 0);
+    CHECK(hot % 64 == 0 && hot >= sizeof(karma_state) && offsetof(t_karma, bufio) == hot);
+    CHECK(&x.playhead == &x.st.playhead && &x.jumpflag == &x.st.jumpflag);
+
+    ch_setup(&x, ch_ref[0], DR_CH, 0);
+    for (v = 0; v < 400; v++) {
+        if (v == 0)   karma_record(&x);
+        if (v == 70)  karma_play(&x);
+        if (v == 100) { karma_overdub(&x, 0.6); karma_record(&x); }
+        if (v == 180) karma_jump(&x, 0.3);
+        if (v == 220) karma_play(&x);
+        if (v == 300) karma_stop(&x);
+        if (v == 340) karma_play(&x);
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.2 * cos(0.013 * (v * DR_VS + i));
+            insp[i] = ((v >= 140) && (v < 260)) ? -1.3 : 1.0;
+        }
+        memcpy(&before, &x, sizeof(x));
+        karma_stereo_perform(&x, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        kept &= (memcmp((char *)&before + hot, (char *)&x + hot, sizeof(x) - hot) == 0);
+    }
+    CHECK(kept);
+    karma_undo_free(x.undo);
+    karma_multiply_free(x.mul);
+}
+
+// float32 host I/O: a session through karma_perform32 gives, sample for sample,
+// the double routine's output rounded to float (sync outlet included) and
+// records the same buffer
+static void test_perform32(void)
+{
+    float  o32[3][DR_VS];
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o64[3][DR_VS];
+    float  f0[DR_VS], f1[DR_VS], fsp[DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[3] = { o64[0], o64[1], o64[2] };
+    float  *fins[3] = { f0, f1, fsp }, *fouts[3] = { o32[0], o32[1], o32[2] };
+    t_karma a, b;
+    int same = 1;
+
+    memcpy(ch_ref[1], ch_ref[0], sizeof(ch_ref[0]));
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    a.syncoutlet = b.syncoutlet = 1;
+    for (long v = 0; v < 300; v++) {
+        if (v == 0)   { karma_record(&a);        karma_record(&b); }
+        if (v == 70)  { karma_play(&a);          karma_play(&b); }
+        if (v == 110) { karma_overdub(&a, 0.7);  karma_overdub(&b, 0.7); karma_record(&a); karma_record(&b); }
+        if (v == 200) { karma_play(&a);          karma_play(&b); }
+        if (v == 250) { karma_stop(&a);          karma_stop(&b); }
+        for (int i = 0; i < DR_VS; i++) {
+            f0[i]  = (float)(0.3 * sin(0.01 * (v * DR_VS + i)));
+            f1[i]  = (float)(0.2 * cos(0.013 * (v * DR_VS + i)));
+            fsp[i] = (v < 140) ? 1.0f : ((v < 180) ? -1.3f : 0.75f);
+            in0[i] = f0[i]; in1[i] = f1[i]; insp[i] = fsp[i];
+        }
+        karma_stereo_perform(&a, NULL, ins, 3, outs, 3, DR_VS, 0, NULL);
+        karma_perform32(&b, fins, fouts, DR_VS);
+        for (int c = 0; c < 3; c++)
+            for (int i = 0; i < DR_VS; i++)
+                same &= (o32[c][i] == (float)o64[c][i]);
+    }
+    CHECK(same);
+    CHECK(memcmp(ch_ref[0], ch_ref[1], sizeof(ch_ref[0])) == 0);
+    CHECK(memcmp(&a.st, &b.st, sizeof(a.st)) == 0);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// in-place I/O: each output vector the same memory as the input of its index
+// (the speed inlet shared with the sync outlet), as Max and CLAP hosts may hand
+// them, gives the output and buffer of separate vectors -- double and float32,
+// through record / overdub / reverse / stop and the dormant vectors after it
+static void test_inplace(void)
+{
+    double d[2][3][DR_VS];
+    float  f[2][3][DR_VS];
+    t_karma a, b;
+    int same = 1;
+
+    for (int f32 = 0; f32 < 2; f32++) {
+        memset(ch_ref, 0, sizeof(ch_ref));
+        ch_setup(&a, ch_ref[0], DR_CH, 0);
+        ch_setup(&b, ch_ref[1], DR_CH, 0);
+        a.syncoutlet = b.syncoutlet = 1;
+        for (long v = 0; v < 300; v++) {
+            if (v == 0)   { karma_record(&a);        karma_record(&b); }
+            if (v == 70)  { karma_play(&a);          karma_play(&b); }
+            if (v == 110) { karma_overdub(&a, 0.7);  karma_overdub(&b, 0.7); karma_record(&a); karma_record(&b); }
+            if (v == 200) { karma_play(&a);          karma_play(&b); }
+            if (v == 250) { karma_stop(&a);          karma_stop(&b); }
+            for (int k = 0; k < 2; k++)         // k 0: inputs, k 1: the in-place vectors
+                for (int i = 0; i < DR_VS; i++) {
+                    d[k][0][i] = f[k][0][i] = (float)(0.3 * sin(0.01 * (v * DR_VS + i)));
+                    d[k][1][i] = f[k][1][i] = (float)(0.2 * cos(0.013 * (v * DR_VS + i)));
+                    d[k][2][i] = f[k][2][i] = (v < 140) ? 1.0f : ((v < 180) ? -1.3f : 0.75f);
+                }
+            if (f32) {
+                float *ins[3] = { f[0][0], f[0][1], f[0][2] }, *io[3] = { f[1][0], f[1][1], f[1][2] };
+                float  o[3][DR_VS];
+                float *outs[3] = { o[0], o[1], o[2] };
+                karma_perform32(&a, ins, outs, DR_VS);
+                karma_perform32(&b, io, io, DR_VS);
+                same &= (memcmp(o, f[1], sizeof(o)) == 0);
+            } else {
+                double *ins[3] = { d[0][0], d[0][1], d[0][2] }, *io[3] = { d[1][0], d[1][1], d[1][2] };
+                double  o[3][DR_VS];
+                double *outs[3] = { o[0], o[1], o[2] };
+                karma_stereo_perform(&a, NULL, ins, 3, outs, 3, DR_VS, 0, NULL);
+                karma_stereo_perform(&b, NULL, io, 3, io, 3, DR_VS, 0, NULL);
+                same &= (memcmp(o, d[1], sizeof(o)) == 0);
+            }
+        }
+        CHECK(same);
+        CHECK(memcmp(ch_ref[0], ch_ref[1], sizeof(ch_ref[0])) == 0);
+        karma_undo_free(a.undo); karma_multiply_free(a.mul);
+        karma_undo_free(b.undo); karma_multiply_free(b.mul);
+    }
+}
+
+// extra voices: the whole-frame kernels match the scalar ones; a voice at speed
+// 1 on the whole loop (linear) reads the loop's frames in order, fades in and
+// out over the ramp, and leaves the buffer and the primary head's state as
+// they are without voices
+static void test_voices(void)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[2][2][DR_VS];
+    double *ins[3] = { in0, in1, insp };
+    double prev = 0.0, jump = 0.0;
+    t_karma a, b;
+    int64_t L = 0, t = 0;
+    int exact = 1, after = 1, ro = 1, kern = 1;
+    static float vb[40 * 4];
+    int64_t t0[KARMA_VOICES_BLOCK], t1[KARMA_VOICES_BLOCK], t2[KARMA_VOICES_BLOCK], t3[KARMA_VOICES_BLOCK];
+    double fr[KARMA_VOICES_BLOCK], sv[4][KARMA_VOICES_BLOCK];
+
+    for (int i = 0; i < 40 * 4; i++)                // the whole-frame kernels = the scalar macros
+        vb[i] = (float)sin(0.37 * i + 0.1 * (i % 4));
+    for (int64_t nproc = 1; nproc <= 4; nproc++)
+        for (int64_t interp = 0; interp < 3; interp++) {
+            for (int i = 0; i < KARMA_VOICES_BLOCK; i++) {
+                t1[i] = (i * 7) % 36 + 1;
+                t0[i] = (t1[i] - 1) * nproc; t2[i] = (t1[i] + 1) * nproc; t3[i] = (t1[i] + 2) * nproc; t1[i] *= nproc;
+                fr[i] = 0.013 * i;
+            }
+            voice_read(sv, vb, nproc, interp, t0, t1, t2, t3, fr, KARMA_VOICES_BLOCK);
+            for (int64_t c = 0; c < nproc; c++)
+                for (int i = 0; i < KARMA_VOICES_BLOCK; i++) {
+                    const float *bc = vb + c;
+                    double r = (interp == 0) ? LINEAR_INTERP(fr[i], bc[t1[i]], bc[t2[i]])
+                             : (interp == 2) ? SPLINE_INTERP(fr[i], bc[t0[i]], bc[t1[i]], bc[t2[i]], bc[t3[i]])
+                             : CUBIC_INTERP(fr[i], bc[t0[i]], bc[t1[i]], bc[t2[i]], bc[t3[i]]);
+                    kern &= (sv[c][i] == r);
+                }
+        }
+    CHECK(kern);
+    {                                               // on a ramp every kernel reads the position itself, either way
+        static float ramp[1000];
+        karma_voice_loop lp = { ramp, 1, 1, 999, 999, NULL, 0.0, 1000.0, 1.0, 0.0, 0, 1 };
+        karma_voice rv;
+        double mix[4][KARMA_VOICES_BLOCK];
+        int at = 1;
+        for (int i = 0; i < 1000; i++)
+            ramp[i] = (float)i;
+        for (int64_t interp = 0; interp < 3; interp++)
+            for (int sgn = -1; sgn <= 1; sgn += 2) {
+                memset(&rv, 0, sizeof(rv));
+                memset(mix, 0, sizeof(mix));
+                rv.speed = 1.5 * sgn; rv.interp = interp; rv.on = 1;
+                rv.head = 500.25; rv.wl = 1000.0; rv.snrfade = 1.0;
+                voice_render(&rv, &lp, mix, KARMA_VOICES_BLOCK, 1.0, 0.0);
+                for (int i = 0; i < KARMA_VOICES_BLOCK; i++)
+                    at &= (mix[0][i] == 500.25 + 1.5 * sgn * i);
+            }
+        CHECK(at);
+    }
+
+    memset(ch_ref, 0, sizeof(ch_ref));
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    b.voices = karma_voices_new(2, DR_CH);
+    CHECK(b.voices != NULL);
+    if (!b.voices) return;
+    karma_voice_interp(&b, 0, 0);
+    karma_voice_speed(&b, 1, -1.7);
+    karma_voice_window(&b, 1, 0.6, 0.1);
+    karma_voice_gain(&b, 1, 0.5);
+    for (long v = 0; v < 260; v++) {
+        double *oa[2] = { o[0][0], o[0][1] }, *ob[2] = { o[1][0], o[1][1] };
+        if (v == 0)   { karma_record(&a);        karma_record(&b); }
+        if (v == 70)  { karma_stop(&a);          karma_stop(&b); }
+        if (v == 100) { karma_voice_play(&b, 0); L = b.maxloop - b.minloop; }
+        if (v == 150) { karma_play(&a);          karma_play(&b);         karma_voice_play(&b, 1); }
+        if (v == 160) { karma_voice_stop(&b, 0); karma_voice_stop(&b, 1); }
+        if (v == 175) { karma_voice_play(&b, 0); karma_voice_play(&b, 1); }
+        if (v == 180) { karma_overdub(&a, 0.8);  karma_overdub(&b, 0.8); karma_record(&a); karma_record(&b); }
+        if (v == 230) { karma_stop(&a);          karma_stop(&b); }
+        if (v == 240) { karma_voice_stop(&b, 0); karma_voice_stop(&b, 1); }
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.2 * cos(0.013 * (v * DR_VS + i));
+            insp[i] = 1.0;
+        }
+        karma_stereo_perform(&a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        ro &= (memcmp(&a.st, &b.st, sizeof(a.st)) == 0);
+        for (int i = 0; i < DR_VS; i++, t++) {
+            if ((v >= 100) && (v < 175)) {          // (not while overdubbing: the write head is an edge in the loop)
+                jump = fmax(jump, fabs(o[1][0][i] - o[0][0][i] - prev));
+                prev = o[1][0][i] - o[0][0][i];
+            }
+            if ((v >= 105) && (v < 150))            // past the fade in: the loop's frames, exactly
+                for (int c = 0; c < DR_CH; c++)
+                    exact &= (o[1][c][i] == ch_ref[1][((t - 100 * DR_VS) % L) * DR_CH + c]);
+            if (v >= 245)                           // faded out: nothing added
+                for (int c = 0; c < DR_CH; c++)
+                    after &= (o[1][c][i] == o[0][c][i]);
+        }
+    }
+    CHECK(L > 0);
+    CHECK(exact);
+    CHECK(after);
+    CHECK(jump < 0.02);                             // declicked: no step at play, wraps or stop
+    CHECK(ro);
+    CHECK(memcmp(ch_ref[0], ch_ref[1], sizeof(ch_ref[0])) == 0);
+    {                                               // a jump is taken once, then cleared
+        double *ob[2] = { o[1][0], o[1][1] };
+        karma_voice_play(&b, 0);
+        karma_voice_jump(&b, 0, 0.5);
+        karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        CHECK(b.voices->v[0].jump < 0.0);
+        CHECK((b.voices->v[0].head >= 0.5 * b.voices->v[0].wl) && (b.voices->v[0].head <= 0.5 * b.voices->v[0].wl + 2 * DR_VS));
+    }
+    karma_voices_free(b.voices);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// pre-record ring: a capture makes the ring's newest frames the loop (from frame
+// 0, padded to the shortest loop), closes it and plays it, declicked; a float32
+// host's ring holds the same and captures the same
+static void pr_in(long v, int i, double *in0, double *in1)
+{
+    *in0 = 0.3 * sin(0.01 * (v * DR_VS + i));
+    *in1 = 0.2 * cos(0.013 * (v * DR_VS + i));
+}
+
+static void test_prerec(void)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[2][DR_VS];
+    double *ins[3] = { in0, in1, insp }, *outs[2] = { o[0], o[1] };
+    float  fin[3][DR_VS], fo[2][DR_VS];
+    float *fins[3] = { fin[0], fin[1], fin[2] }, *fouts[2] = { fo[0], fo[1] };
+    double prev = 0.0, jump = 0.0, x0, x1;
+    t_karma a, b;
+    int64_t n = 0, f, s;
+    int took = 1, plays = 1, pad = 1, same = 1, loop = 1;
+
+    memset(ch_ref, 0, sizeof(ch_ref));
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    a.prerec = karma_prerec_new(0.25, 48000.0, DR_CH);         // 12000 frames
+    b.prerec = karma_prerec_new(0.25, 48000.0, DR_CH);
+    CHECK(a.prerec && b.prerec);
+    if (!a.prerec || !b.prerec) return;
+    for (long v = 0; v < 460; v++) {
+        if (v == 200) { karma_capture(&a, 0.2);  karma_capture(&b, 0.2);  n = 9600; }
+        if (v == 350) { karma_overdub(&a, 0.5);  karma_overdub(&b, 0.5); karma_record(&a); karma_record(&b); }
+        if (v == 400) { karma_capture(&a, 0.05); karma_capture(&b, 0.05); n = 2400; }
+        for (int i = 0; i < DR_VS; i++) {
+            pr_in(v, i, &in0[i], &in1[i]);
+            insp[i] = 1.0;
+            fin[0][i] = (float)in0[i]; fin[1][i] = (float)in1[i]; fin[2][i] = 1.0f;
+        }
+        karma_perform32(&a, fins, fouts, DR_VS);
+        karma_stereo_perform(&b, NULL, ins, 3, outs, 2, DR_VS, 0, NULL);
+        for (int i = 0; i < DR_VS; i++)
+            same &= (fo[0][i] == (float)o[0][i]) && (fo[1][i] == (float)o[1][i]);
+        if ((v == 200) || (v == 400)) {         // the newest n frames, in order (short of the loop-end fade)
+            for (f = 0; f < n - 300; f++) {
+                s = (v + 1) * DR_VS - n + f;
+                pr_in(s / DR_VS, (int)(s % DR_VS), &x0, &x1);
+                took &= (ch_ref[1][f * DR_CH] == (float)x0) && (ch_ref[1][f * DR_CH + 1] == (float)x1);
+            }
+            for (; f <= KARMA_PREREC_MIN; f++)  // a short take: silence up to the shortest loop
+                if (f >= n)
+                    pad &= (ch_ref[1][f * DR_CH] == 0.0f) && (ch_ref[1][f * DR_CH + 1] == 0.0f);
+            loop &= (b.minloop == 0) && (b.maxloop == ((n > KARMA_PREREC_MIN) ? n - 1 : KARMA_PREREC_MIN))
+                 && b.go && !b.record && !b.loopdetermine && (b.statehuman == SH_PLAY);
+        }
+        for (int i = 0; i < DR_VS; i++) {
+            s = (v - 200) * DR_VS + i;          // played from the loop start, past the switch ramp
+            if ((v >= 200) && (v < 350) && (s >= 300) && (s < 9300))
+                plays &= (o[0][i] == ch_ref[1][s * DR_CH]) && (o[1][i] == ch_ref[1][s * DR_CH + 1]);
+            if ((v >= 195) && (v < 210)) {      // from silence into the take
+                jump = fmax(jump, fabs(o[0][i] - prev));
+                prev = o[0][i];
+            }
+        }
+    }
+    CHECK(took);
+    CHECK(pad);
+    CHECK(loop);
+    CHECK(plays);
+    CHECK(jump < 0.02);
+    CHECK(same);
+    CHECK(memcmp(ch_ref[0], ch_ref[1], sizeof(ch_ref[0])) == 0);
+    karma_prerec_free(a.prerec); karma_prerec_free(b.prerec);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+}
+
+// buffer switch: served at the start of the next vector; a cut is set_dims
+// there, and a crossfade is the new buffer's output rising over the old head's
+// (an instance left on the old buffer) falling, then exactly the cut. The undo
+// and multiply handed over with it are the instance's from then on, its old
+// ones left in the switch for the host to free
+enum { SW_FRAMES = 6000, SW_FADE = 1000 };
+static float sw_e[CH_FRAMES * DR_CH], sw_b[SW_FRAMES * DR_CH];
+
+static void test_switch(void)
+{
+    double in0[DR_VS], in1[DR_VS], insp[DR_VS], o[3][2][DR_VS];
+    double *ins[3] = { in0, in1, insp };
+    t_karma a, b, e;
+    karma_switch w, cut;
+    struct karma_undo *au;
+    struct karma_multiply *am;
+    int64_t t = 0;
+    int pending = 1, fading = 1, mixed = 1, after = 1, cutsame = 1, displaced = 0;
+    double g;
+
+    memset(ch_ref, 0, sizeof(ch_ref));
+    memset(sw_e, 0, sizeof(sw_e));
+    for (int f = 0; f < SW_FRAMES * DR_CH; f++)
+        sw_b[f] = (float)(0.25 * cos(0.021 * f));
+    ch_setup(&a, ch_ref[0], DR_CH, 0);
+    ch_setup(&b, ch_ref[1], DR_CH, 0);
+    ch_setup(&e, sw_e, DR_CH, 0);
+    memset(&w, 0, sizeof(w));
+    memset(&cut, 0, sizeof(cut));
+    w.bufio = a.bufio;
+    w.bufio.ctx = sw_b; w.bufio.frames = SW_FRAMES;
+    w.fade = SW_FADE;
+    w.exts = 1;                                     // with undo and multiply for the new buffer
+    w.undo = karma_undo_new(SW_FRAMES, karma_core_switch_chans(&a, &w), 32);
+    w.mul  = karma_multiply_new(SW_FRAMES, karma_core_switch_chans(&a, &w));
+    au = a.undo;
+    am = a.mul;
+    cut.bufio = a.bufio;                            // back onto its own buffer, no fade
+    for (long v = 0; v < 300; v++) {
+        double *oa[2] = { o[0][0], o[0][1] }, *ob[2] = { o[1][0], o[1][1] }, *oe[2] = { o[2][0], o[2][1] };
+        if (v == 0)  { karma_record(&a); karma_record(&b); karma_record(&e); }
+        if (v == 90) { karma_play(&a);   karma_play(&b);   karma_play(&e); }
+        if (v == 150) {
+            karma_core_switch(&a, &w);
+            pending &= !w.done && (a.bufio.ctx == (void *)ch_ref[0]) && (a.undo == au);
+            b.bufio = w.bufio;                      // the twin: set_dims between the vectors
+            karma_core_set_dims(&b);
+            karma_undo_free(b.undo); karma_multiply_free(b.mul);
+            b.undo = karma_undo_new(SW_FRAMES, karma_core_view_chans(&b), 32);
+            b.mul  = karma_multiply_new(SW_FRAMES, karma_core_view_chans(&b));
+            karma_extensions_reset(&b);
+        }
+        if (v == 250) {                             // posted over a pending one: that one is done, never made
+            karma_switch drop;
+            memset(&drop, 0, sizeof(drop));
+            drop.bufio = w.bufio;
+            karma_core_switch(&a, &drop);
+            displaced = (karma_core_switch(&a, &cut) == &drop) && drop.done && !drop.made && !cut.done;
+            b.bufio = cut.bufio;
+            b.bufio.ctx = ch_ref[1];
+            karma_core_set_dims(&b);
+            karma_extensions_reset(&b);
+        }
+        for (int i = 0; i < DR_VS; i++) {
+            in0[i] = 0.3 * sin(0.01 * (v * DR_VS + i));
+            in1[i] = 0.2 * cos(0.013 * (v * DR_VS + i));
+            insp[i] = 1.0;
+        }
+        karma_stereo_perform(&a, NULL, ins, 3, oa, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(&b, NULL, ins, 3, ob, 2, DR_VS, 0, NULL);
+        karma_stereo_perform(&e, NULL, ins, 3, oe, 2, DR_VS, 0, NULL);
+        if (v >= 150) {
+            for (int i = 0; i < DR_VS; i++, t++)
+                for (int c = 0; c < DR_CH; c++) {
+                    g = (double)t / SW_FADE;
+                    if (t < SW_FADE)
+                        mixed &= fabs(o[0][c][i] - (g * o[1][c][i] + (1.0 - g) * o[2][c][i])) < 1e-9;
+                    else
+                        after &= (o[0][c][i] == o[1][c][i]);
+                }
+            if ((v - 150) * DR_VS < SW_FADE - DR_VS)
+                fading &= (a.fading == &w) && !w.done && (a.bufio.ctx == (void *)sw_b);
+        }
+        if (v == 250)
+            cutsame &= cut.done && !a.fading && (a.bufio.ctx == (void *)ch_ref[0]);
+    }
+    CHECK(pending);
+    CHECK(fading && w.done && (a.bframes == CH_FRAMES));
+    CHECK(w.made && (w.undo == au) && (w.mul == am) && a.undo && (a.undo != au) && a.mul && (a.mul != am));
+    CHECK(mixed);
+    CHECK(after);
+    CHECK(cutsame);
+    CHECK(displaced);
+    CHECK(memcmp(&a.st, &b.st, sizeof(a.st)) == 0);
+    karma_undo_free(w.undo); karma_multiply_free(w.mul);
+    karma_undo_free(a.undo); karma_multiply_free(a.mul);
+    karma_undo_free(b.undo); karma_multiply_free(b.mul);
+    karma_undo_free(e.undo); karma_multiply_free(e.mul);
+}
+
 int main(void)
 {
     printf("=== kernel unit tests ===\n");
@@ -178,6 +1579,25 @@ int main(void)
     test_interp_index();
     test_ease_bufoff();
     test_set_loop();
+    test_ipoke_fill();
+    test_dirty_ranges();
+    test_undo();
+    test_multiply();
+    test_channels();
+    test_oneshot();
+    test_modout();
+    test_onframe();
+    test_sinc();
+    test_mipmap();
+    test_shadow();
+    test_dormant();
+    test_quiet_overdub();
+    test_state_block();
+    test_perform32();
+    test_inplace();
+    test_voices();
+    test_prerec();
+    test_switch();
     printf("%d passed, %d failed\n", g_pass, g_fail);
     return g_fail ? 1 : 0;
 }